@@ -1,7 +1,11 @@
+#include "OSAL.h"
 #include "zcl.h"
 #include "zcl_general.h"
-#include "bdb_interface.h"
 #include "debug_print.h"
+#include "energy.h"
+#include "report_batch.h"
+#include "zapp_task.h"
+#include "utils.h"
 
 #include "alarm_reporting.h"
 
@@ -13,19 +17,153 @@
 #define GEN_BASIC_ENDPOINT   1
 #endif /* GEN_BASIC_ENDPOINT */
 
+#define ALARM_NO_TASK        0xFF
+#define ALARM_NO_WAIT        0xFFFFFFFF
+
 /*********************************************************************
  * GLOBAL VARIABLES
  */
 uint8 zclAlarm_Mask = ALARM_MASK_NO_FAULT;
 
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+
+// reports every AlarmMask change right away unless zclAlarm_Init is called
+static const zclAlarmAttr_t zclAlarm_DefaultAttrs[] =
+{
+  {
+    .endpoint = GEN_BASIC_ENDPOINT,
+    .clusterID = ZCL_CLUSTER_ID_GEN_BASIC,
+    .attrID = ATTRID_BASIC_ALARM_MASK,
+    .dataType = ZCL_DATATYPE_BITMAP8,
+    .value = &zclAlarm_Mask
+  }
+};
+
+static uint8  zclAlarm_TaskId = ALARM_NO_TASK;
+static uint16 zclAlarm_Event = 0;
+static const zclAlarmAttr_t *zclAlarm_Attrs = zclAlarm_DefaultAttrs;
+static uint8  zclAlarm_Count = 1;
+static zclAlarmState_t zclAlarm_DefaultState[COUNT_OF(zclAlarm_DefaultAttrs)];
+static zclAlarmState_t *zclAlarm_State = zclAlarm_DefaultState;
+
+/*********************************************************************
+ * LOCAL PROTOTYPES
+ */
+static uint16 zclAlarmValue(const zclAlarmAttr_t *attr);
+static uint32 zclAlarmCheck(uint8 idx, uint32 now);
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      zclAlarmValue
+ *
+ * @brief   Read watched attribute value
+ *
+ * @param   attr - watched attribute
+ *
+ * @return  attribute value
+ */
+static uint16 zclAlarmValue(const zclAlarmAttr_t *attr)
+{
+  if (zclGetDataTypeLength(attr->dataType) == 1)
+    return *(uint8 *)attr->value;
+  return *(uint16 *)attr->value;
+}
+
+/*********************************************************************
+ * @fn      zclAlarmCheck
+ *
+ * @brief   Queue report of the attribute if its change is due
+ *
+ * @param   idx - watched attribute index
+ * @param   now - current system clock
+ *
+ * @return  milliseconds until the attribute has to be checked again,
+ *          ALARM_NO_WAIT if there is nothing pending
+ */
+static uint32 zclAlarmCheck(uint8 idx, uint32 now)
+{
+  const zclAlarmAttr_t *attr = &zclAlarm_Attrs[idx];
+  zclAlarmState_t *state = &zclAlarm_State[idx];
+  uint16 value = zclAlarmValue(attr);
+  uint16 delta;
+  uint32 elapsed;
+
+  if (value != state->pending)
+  {
+    state->pending = value;
+    state->changedAt = now;
+  }
+
+  delta = value > state->reported ? value - state->reported : state->reported - value;
+  if (delta == 0 || delta <= attr->hysteresis)
+    return ALARM_NO_WAIT;
+
+  elapsed = now - state->changedAt;
+  if (elapsed < attr->debounceMs)
+    return attr->debounceMs - elapsed;
+
+  elapsed = now - state->reportedAt;
+  if (elapsed < (uint32)attr->minIntervalS * 1000)
+    return (uint32)attr->minIntervalS * 1000 - elapsed;
+
+  zclReportBatch_Add(ENERGY_MODULE_ALARM | REPORT_BATCH_DEFAULT_RSP, attr->endpoint, attr->clusterID, attr->attrID, attr->dataType, attr->value);
+  state->reported = value;
+  state->reportedAt = now;
+
+  DBG_TRACE(DEBUG_MODULE_ALARM, "ALRM: 0x%04X@%d = %d\r\n", attr->attrID, attr->endpoint, value);
+  return ALARM_NO_WAIT;
+}
+
 /*********************************************************************
  * GLOBAL FUNCTIONS
  */
 
 /*********************************************************************
- * @fn      zclTHPremake_AlarmReport
+ * @fn      zclAlarm_Init
+ *
+ * @brief   Set attributes to watch. Values are taken as reported at
+ *          the time of the call. With debounce or minimum interval
+ *          set, the library task calls zclAlarmReport when pending
+ *          changes are due.
+ *
+ * @param   attrs - watched attributes, has to stay valid
+ * @param   state - state array of count elements, has to stay valid
+ * @param   count - number of attributes
+ *
+ * @return  none
+ */
+void zclAlarm_Init(const zclAlarmAttr_t *attrs, zclAlarmState_t *state, uint8 count)
+{
+  uint32 now = osal_GetSystemClock();
+  uint8 i;
+
+  if (zclAlarm_TaskId == ALARM_NO_TASK)
+  {
+    zclAlarm_TaskId = zAppTask_Id;
+    zclAlarm_Event = zAppTask_AllocEvent(zclAlarmReport);
+  }
+  zclAlarm_Attrs = attrs;
+  zclAlarm_State = state;
+  zclAlarm_Count = count;
+
+  for (i = 0; i < zclAlarm_Count; i++)
+  {
+    zclAlarm_State[i].reported = zclAlarm_State[i].pending = zclAlarmValue(&attrs[i]);
+    zclAlarm_State[i].changedAt = now;
+    zclAlarm_State[i].reportedAt = now - (uint32)attrs[i].minIntervalS * 1000;
+  }
+}
+
+/*********************************************************************
+ * @fn      zclAlarmReport
  *
- * @brief   Report Alarm Mask
+ * @brief   Report changes of the watched attributes, call after
+ *          updating them, pending ones are sent by the library task
  *
  * @param   none
  *
@@ -33,32 +171,18 @@ uint8 zclAlarm_Mask = ALARM_MASK_NO_FAULT;
  */
 void zclAlarmReport(void)
 {
-  static const zclReportCmd_t AlrmReportCmd =
-    {
-      .numAttr = 1,
-      .attrList =
-      {
-        {
-          .attrID = ATTRID_BASIC_ALARM_MASK,
-          .dataType = ZCL_DATATYPE_BITMAP8,
-          .attrData = (void*)(&zclAlarm_Mask)
-        }
-      }
-    };
-  static uint8 alarm_pval = ALARM_MASK_NO_FAULT;
-
-  if (zclAlarm_Mask == alarm_pval)
-    return;
-
-  afAddrType_t dstAddr = {
-    .addrMode = (afAddrMode_t)AddrNotPresent,
-    .addr.shortAddr = 0,
-    .endPoint = GEN_BASIC_ENDPOINT,
-  };
-  zcl_SendReportCmd(GEN_BASIC_ENDPOINT, &dstAddr,
-                    ZCL_CLUSTER_ID_GEN_BASIC, (zclReportCmd_t*)(&AlrmReportCmd),
-                    ZCL_FRAME_SERVER_CLIENT_DIR, FALSE, bdb_getZCLFrameCounter());
-  alarm_pval = zclAlarm_Mask;
-  
-  DBGF("ALRM: %d\r\n", zclAlarm_Mask);
+  uint32 now = osal_GetSystemClock();
+  uint32 wait = ALARM_NO_WAIT;
+  uint8 i;
+
+  for (i = 0; i < zclAlarm_Count; i++)
+  {
+    uint32 w = zclAlarmCheck(i, now);
+
+    if (w < wait)
+      wait = w;
+  }
+
+  if (wait != ALARM_NO_WAIT && zclAlarm_TaskId != ALARM_NO_TASK)
+    osal_start_timerEx(zclAlarm_TaskId, zclAlarm_Event, wait);
 }
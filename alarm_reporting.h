@@ -5,8 +5,38 @@
 
 #define ALARM_MASK_NO_FAULT  0
 
+/*
+ * Alarm-like attribute watched for changes, 8 or 16 bit wide.
+ * A new value has to hold for debounceMs, and the change from the last
+ * reported value has to exceed hysteresis, to be reported. Reports of
+ * the attribute are at least minIntervalS apart, transitions in between
+ * are coalesced into the final value. Any number of attributes can be
+ * watched, the application provides a zclAlarmState_t for each.
+ */
+typedef struct
+{
+  uint8 endpoint;
+  uint16 clusterID;
+  uint16 attrID;
+  uint8 dataType;
+  void *value;
+  uint16 minIntervalS;
+  uint16 debounceMs;
+  uint16 hysteresis;
+} zclAlarmAttr_t;
+
+// run time state of a watched attribute, one per zclAlarmAttr_t
+typedef struct
+{
+  uint16 reported;  // last reported value
+  uint16 pending;   // latest value seen
+  uint32 changedAt; // when pending value was first seen
+  uint32 reportedAt;
+} zclAlarmState_t;
+
 extern uint8 zclAlarm_Mask;
 
+extern void zclAlarm_Init(const zclAlarmAttr_t *attrs, zclAlarmState_t *state, uint8 count);
 extern void zclAlarmReport(void);
 
 #endif /* ALARM_REPORTING_H */
@@ -1,9 +1,16 @@
+#include "OSAL.h"
 #include "hal_adc.h"
 #include "zcl.h"
 #include "zcl_general.h"
 #include "bdb_interface.h"
 #include "utils.h"
+#include "fixedpoint.h"
 #include "debug_print.h"
+#include "energy.h"
+#include "report_batch.h"
+#include "report_engine.h"
+#include "zapp_task.h"
+#include "trace.h"
 
 #include "battery.h"
 
@@ -12,23 +19,86 @@
  */
 typedef struct
 {
-  uint16 mV;  // battery voltage in milliVolts
-  uint8 perc; // BatteryPercentageRemaining value (unit is 0.5%)
+  uint16 mV;    // battery voltage in milliVolts
+  uint8 perc;   // BatteryPercentageRemaining value (unit is 0.5%)
+  uint16 slope; // percentage units per mV towards the next point, Q10
 } bat_charge_t;
 
+typedef struct
+{
+  uint8 size;     // BatterySize attribute value
+  uint8 quantity; // BatteryQuantity attribute value
+  uint8 count;    // number of points
+  const bat_charge_t *points;
+} bat_profile_t;
+
+typedef struct
+{
+  uint16 filterQ4;  // filtered voltage, 1/16 mV
+  uint16 mV;        // zclBattery_mV, BATTERY_MV_INVALID if never stored
+  uint8 perc;       // zclBattery_PercentageRemainig
+  uint16 slope;     // discharge rate, mV per day
+  uint16 slopeMV;   // slope reference point
+  uint32 slopeAge;  // time since the slope reference point, ms
+  uint32 interval;  // measurement interval
+} bat_state_t;
+
 /*********************************************************************
  * CONSTANTS
  */
 
+#define BAT_SLOPE_Q          10
+
 /*
- * BAT_PMAP is the initializer for array of bat_charge_t structures
- * above and has to provide initialization for at least two elements
+ * Charge curve initializer from 2 to 8 (mV, perc) points, e.g.
+ *   BAT_CURVE((2200, 0), (2600, 12), (3000, 200))
+ * The slope of each segment is computed by the compiler from the adjacent
+ * points, so that lookup needs no division. Points have to go in ascending
+ * voltage and non-descending percentage order, otherwise the slope
+ * divides by zero and the table doesn't compile.
  */
-#ifndef BAT_PMAP
-#warning Using default battery charge percentage map for 2s AAA
-// 2s AAA, based on Duracell MX2400 datasheet
-#define BAT_PMAP { { 2500, 0 }, { 2580, 22 }, { 2730, 114 }, { 2985, 188 }, { 3200, 200 } }
-#endif /* !BAT_PMAP */
+#define BAT_CURVE(...) \
+  { BAT_CAT(BAT_CURVE_, BAT_NARGS(__VA_ARGS__))(__VA_ARGS__) }
+
+#define BAT_MV_(mV, perc)    mV
+#define BAT_PERC_(mV, perc)  perc
+#define BAT_MV(p)            BAT_APPLY(BAT_MV_, p)
+#define BAT_PERC(p)          BAT_APPLY(BAT_PERC_, p)
+#define BAT_APPLY(m, p)      m p
+#define BAT_CAT(a, b)        BAT_CAT_(a, b)
+#define BAT_CAT_(a, b)       a##b
+#define BAT_NARGS(...)       BAT_NARGS_(__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, ~)
+#define BAT_NARGS_(a1, a2, a3, a4, a5, a6, a7, a8, n, ...) n
+
+#define BAT_SEGMENT(p, next)                                                        \
+  { BAT_MV(p), BAT_PERC(p),                                                         \
+    (uint16)((((uint32)BAT_PERC(next) - BAT_PERC(p)) << BAT_SLOPE_Q) /              \
+             (BAT_MV(next) > BAT_MV(p) && BAT_PERC(next) >= BAT_PERC(p) ?           \
+              BAT_MV(next) - BAT_MV(p) : 0)) }
+#define BAT_CURVE_1(p)       { BAT_MV(p), BAT_PERC(p), 0 }
+#define BAT_CURVE_2(p, ...)  BAT_SEGMENT(p, __VA_ARGS__), BAT_CURVE_1(__VA_ARGS__)
+#define BAT_CURVE_3(p, q, ...) BAT_SEGMENT(p, q), BAT_CURVE_2(q, __VA_ARGS__)
+#define BAT_CURVE_4(p, q, ...) BAT_SEGMENT(p, q), BAT_CURVE_3(q, __VA_ARGS__)
+#define BAT_CURVE_5(p, q, ...) BAT_SEGMENT(p, q), BAT_CURVE_4(q, __VA_ARGS__)
+#define BAT_CURVE_6(p, q, ...) BAT_SEGMENT(p, q), BAT_CURVE_5(q, __VA_ARGS__)
+#define BAT_CURVE_7(p, q, ...) BAT_SEGMENT(p, q), BAT_CURVE_6(q, __VA_ARGS__)
+#define BAT_CURVE_8(p, q, ...) BAT_SEGMENT(p, q), BAT_CURVE_7(q, __VA_ARGS__)
+
+#define BAT_PROFILE(size, quantity, points) { size, quantity, COUNT_OF(points), points }
+
+/*
+ * BAT_PMAP, when defined, is the initializer for array of bat_charge_t
+ * structures above giving mV and perc only, at least two elements.
+ * It serves BAT_DEFAULT_SIZE x BAT_DEFAULT_QUANTITY in place of the
+ * bundled profile, slopes are computed once on first use.
+ */
+#ifndef BAT_DEFAULT_SIZE
+#define BAT_DEFAULT_SIZE     BAT_SIZE_AAA
+#endif /* BAT_DEFAULT_SIZE */
+
+#ifndef BAT_DEFAULT_QUANTITY
+#define BAT_DEFAULT_QUANTITY 2
+#endif /* BAT_DEFAULT_QUANTITY */
 
 // define BAT_FILTER_S as 0 to disable battery voltage filtering
 #ifndef BAT_FILTER_S
@@ -36,17 +106,122 @@ typedef struct
 #endif /* !BAT_FILTER_S */
 
 #if BAT_FILTER_S > 0
-/* Simple low-pass filter coefficient
- *                        1
- * FILTER = ------------------------------
- *          Fcut-off / Fsampling * 2Pi + 1
+/* First order low-pass filter applied with the real time elapsed
+ * since the previous sample, so any sampling schedule works:
+ *
+ *   k(dt) = exp(-dt * 2Pi / BAT_FILTER_S)
+ *   mV = mV * k(dt) + sample * (1 - k(dt))
  *
- * Figure below is normalized to power of two value for efficiency
+ * k is kept in Q16 for dt = 2^i * BAT_FILTER_UNIT_MS. Only the first
+ * entry is computed by the compiler, the rest of the table is filled by
+ * squaring it on first use, and k(dt) is the product of the entries for
+ * the bits set in dt. Filter state is held in 1/16 mV.
+ * BAT_FILTER_UNIT_MS has to be well below BAT_FILTER_S.
  */
-#undef BAT_FILTER
-#define BAT_FILTER (uint16)(1.0/(6.283/((BAT_FILTER_S)/(APP_BAT_REPORT_INTERVAL_MS/1000)) + 1.0) * 1024)
+#ifndef BAT_FILTER_UNIT_MS
+#define BAT_FILTER_UNIT_MS   16000
+#endif /* BAT_FILTER_UNIT_MS */
+
+#define BAT_FILTER_STEPS     16  // longer gaps restart the filter
+#define BAT_FILTER_X         (6.283 * (BAT_FILTER_UNIT_MS) / 1000.0 / (BAT_FILTER_S))
+#define BAT_FILTER_K0_F      \
+  ((1.0 - BAT_FILTER_X + BAT_FILTER_X * BAT_FILTER_X / 2 - BAT_FILTER_X * BAT_FILTER_X * BAT_FILTER_X / 6) * 65536.0 + 0.5)
+#define BAT_FILTER_K0        (uint16)(BAT_FILTER_K0_F > 65535.0 ? 65535.0 : BAT_FILTER_K0_F)
 #endif /* BAT_FILTER_S > 0 */
 
+/*
+ * Adaptive measurement interval. The interval doubles up to
+ * BAT_INTERVAL_MAX_MS while the voltage holds, and is cut so that at the
+ * current discharge slope at least BAT_KNEE_SAMPLES measurements are
+ * taken before the voltage reaches the lower knee of BAT_PMAP (its second
+ * point). Within BAT_KNEE_GUARD_MV of the knee BAT_INTERVAL_MIN_MS is used.
+ */
+#ifndef BAT_INTERVAL_MIN_MS
+#define BAT_INTERVAL_MIN_MS  ((uint32) 1800000)   // 30 minutes
+#endif /* BAT_INTERVAL_MIN_MS */
+
+#ifndef BAT_INTERVAL_MAX_MS
+#define BAT_INTERVAL_MAX_MS  ((uint32) 43200000)  // 12 hours
+#endif /* BAT_INTERVAL_MAX_MS */
+
+#ifndef BAT_KNEE_SAMPLES
+#define BAT_KNEE_SAMPLES     16
+#endif /* BAT_KNEE_SAMPLES */
+
+#ifndef BAT_KNEE_GUARD_MV
+#define BAT_KNEE_GUARD_MV    20
+#endif /* BAT_KNEE_GUARD_MV */
+
+/*
+ * Discharge slope is estimated once the filtered voltage dropped by
+ * BAT_SLOPE_MV since the reference point, or BAT_SLOPE_MAX_MIN minutes
+ * passed, so that the mV resolution doesn't hide slow discharge
+ */
+#ifndef BAT_SLOPE_MV
+#define BAT_SLOPE_MV         4
+#endif /* BAT_SLOPE_MV */
+
+#ifndef BAT_SLOPE_MAX_MIN
+#define BAT_SLOPE_MAX_MIN    10080 // 7 days
+#endif /* BAT_SLOPE_MAX_MIN */
+
+/*
+ * Battery state is kept in NV so that filtering and slope estimation
+ * resume warm after reboot instead of starting over from a single noisy
+ * sample. It is written lazily: once the filtered voltage moved by
+ * BAT_NV_DELTA_MV or the percentage changed since the stored state, and
+ * no more often than BAT_NV_INTERVAL_MS. Define BAT_NV_INTERVAL_MS as 0
+ * to disable. Power down time is unknown, so the restored sample is
+ * taken as made at boot; a first sample BAT_NV_RESYNC_MV or more above
+ * the stored voltage (batteries replaced) drops the restored state. Lower
+ * first samples, e.g. the dip of a cold start, are left to the filter.
+ */
+#ifndef BAT_NV_INTERVAL_MS
+#define BAT_NV_INTERVAL_MS   86400000UL  // 24 hours
+#endif /* BAT_NV_INTERVAL_MS */
+
+#ifndef BAT_NV_DELTA_MV
+#define BAT_NV_DELTA_MV      10
+#endif /* BAT_NV_DELTA_MV */
+
+#ifndef BAT_NV_RESYNC_MV
+#define BAT_NV_RESYNC_MV     100
+#endif /* BAT_NV_RESYNC_MV */
+
+#ifndef ZCD_NV_BATTERY_STATE
+#define ZCD_NV_BATTERY_STATE 0x0413
+#endif /* ZCD_NV_BATTERY_STATE */
+
+#ifndef BDB_REPORTING
+/*
+ * Without BDB_REPORTING the attributes are reported through report_engine:
+ * on a change of at least BAT_REPORT_CHANGE_* and at least every
+ * BAT_REPORT_MAX_S, Configure Reporting can change these at run time.
+ */
+#ifndef BAT_REPORT_MIN_S
+#define BAT_REPORT_MIN_S     0
+#endif /* BAT_REPORT_MIN_S */
+
+#ifndef BAT_REPORT_MAX_S
+#define BAT_REPORT_MAX_S     43200 // 12 hours
+#endif /* BAT_REPORT_MAX_S */
+
+#ifndef BAT_REPORT_CHANGE_V
+#define BAT_REPORT_CHANGE_V  1     // 100 mV
+#endif /* BAT_REPORT_CHANGE_V */
+
+#ifndef BAT_REPORT_CHANGE_PERC
+#define BAT_REPORT_CHANGE_PERC 2   // 1 %
+#endif /* BAT_REPORT_CHANGE_PERC */
+
+#ifndef BAT_REPORT_CHANGE_MV
+#define BAT_REPORT_CHANGE_MV 20
+#endif /* BAT_REPORT_CHANGE_MV */
+#endif /* !BDB_REPORTING */
+
+#define MS_PER_MIN           60000
+#define MIN_PER_DAY          1440
+
 #ifndef ADC_VREF_MV
 #define ADC_VREF_MV          1150
 #endif /* ADC_VREF_MV */
@@ -55,6 +230,12 @@ typedef struct
 #define BAT_ADC_RESOLUTION   HAL_ADC_RESOLUTION_14
 #endif /* BAT_ADC_RESOLUTION */
 
+#define BATTERY_NO_TASK      0xFF
+
+#ifndef BAT_ADC_SAMPLES
+#define BAT_ADC_SAMPLES      10
+#endif /* BAT_ADC_SAMPLES */
+
 #ifndef POWER_CFG_ENDPOINT
 #define POWER_CFG_ENDPOINT   1
 #endif /* POWER_CFG_ENDPOINT */
@@ -62,114 +243,561 @@ typedef struct
 /*********************************************************************
  * GLOBAL VARIABLES
  */
+uint8  zclBattery_Size = BAT_DEFAULT_SIZE;
+uint8  zclBattery_Quantity = BAT_DEFAULT_QUANTITY;
 uint8  zclBattery_Voltage = BATTERY_INVALID;
 uint8  zclBattery_PercentageRemainig = BATTERY_INVALID;
 uint16 zclBattery_mV = BATTERY_MV_INVALID;
 
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+static uint8  zclBattery_TaskId = BATTERY_NO_TASK;
+static uint16 zclBattery_AdcEvent = 0;
+static bool   zclBattery_Forced = FALSE;
+#ifndef BDB_REPORTING
+static bool   zclBattery_Registered = FALSE;
+#endif /* !BDB_REPORTING */
+
+// 2s AAA alkaline, based on Duracell MX2400 datasheet
+static const bat_charge_t bat_alkaline_aaa_2s[] =
+  BAT_CURVE((2500, 0), (2580, 22), (2730, 114), (2985, 188), (3200, 200));
+
+// 2s AA alkaline, based on Duracell MN1500 datasheet
+static const bat_charge_t bat_alkaline_aa_2s[] =
+  BAT_CURVE((2400, 0), (2540, 18), (2700, 106), (2960, 184), (3200, 200));
+
+// CR2032, based on Energizer CR2032 datasheet, 0.2 mA drain
+static const bat_charge_t bat_cr2032[] =
+  BAT_CURVE((2200, 0), (2600, 12), (2800, 50), (2900, 150), (3000, 200));
+
+// CR2450, based on Energizer CR2450 datasheet, 0.2 mA drain
+static const bat_charge_t bat_cr2450[] =
+  BAT_CURVE((2200, 0), (2650, 10), (2850, 60), (2950, 170), (3050, 200));
+
+// 1s AA Li-SOCl2, based on Saft LS14500 datasheet
+static const bat_charge_t bat_lisocl2_aa[] =
+  BAT_CURVE((2800, 0), (3200, 8), (3400, 30), (3550, 170), (3650, 200));
+
+#ifdef BAT_PMAP
+static bat_charge_t bat_custom[] = BAT_PMAP;
+#endif /* BAT_PMAP */
+
+// the first matching profile is used, the first one is the fallback
+static const bat_profile_t bat_profiles[] =
+{
+#ifdef BAT_PMAP
+  BAT_PROFILE(BAT_DEFAULT_SIZE, BAT_DEFAULT_QUANTITY, bat_custom),
+#endif /* BAT_PMAP */
+  BAT_PROFILE(BAT_SIZE_AAA, 2, bat_alkaline_aaa_2s),
+  BAT_PROFILE(BAT_SIZE_AA, 2, bat_alkaline_aa_2s),
+  BAT_PROFILE(BAT_SIZE_CR2032, 1, bat_cr2032),
+  BAT_PROFILE(BAT_SIZE_CR2450, 1, bat_cr2450),
+  BAT_PROFILE(BAT_SIZE_AA, 1, bat_lisocl2_aa),
+};
+
+#if BAT_FILTER_S > 0
+static uint16 zclBattery_FilterK[BAT_FILTER_STEPS];      // Q16 k(2^i units)
+static uint16 zclBattery_FilterQ4 = BATTERY_MV_INVALID; // filtered voltage, 1/16 mV
+static uint32 zclBattery_FilterTime;
+#endif /* BAT_FILTER_S > 0 */
+
+static uint32 zclBattery_Interval = APP_BAT_REPORT_INTERVAL_MS;
+static uint16 zclBattery_Slope = 0;                     // discharge rate, mV per day
+static uint16 zclBattery_SlopeMV = BATTERY_MV_INVALID;  // slope reference point
+static uint32 zclBattery_SlopeTime;
+
+#if BAT_NV_INTERVAL_MS > 0
+static bool   zclBattery_Restored = FALSE;
+static bool   zclBattery_Resync = FALSE;                // restored state not checked yet
+static uint16 zclBattery_NvMV = BATTERY_MV_INVALID;     // state last written to NV
+static uint8  zclBattery_NvPerc = BATTERY_INVALID;
+static uint32 zclBattery_NvTime;
+#endif /* BAT_NV_INTERVAL_MS > 0 */
+
 /*********************************************************************
  * LOCAL PROTOTYPES
  */
-static inline uint8 zclBatteryPercentage(uint16 mV);
+static const bat_profile_t *zclBatteryProfile(void);
+static uint8 zclBatteryPercentage(const bat_profile_t *profile, uint16 mV);
+static void zclBatteryProcess(uint16 rawADC, bool forced);
+static void zclBatterySchedule(const bat_profile_t *profile, uint16 mV);
+#ifndef BDB_REPORTING
+static void zclBatteryRegister(void);
+#endif /* !BDB_REPORTING */
+#if BAT_FILTER_S > 0
+static uint16 zclBatteryFilter(uint16 mV);
+#endif /* BAT_FILTER_S > 0 */
+#if BAT_NV_INTERVAL_MS > 0
+static void zclBatteryRestore(void);
+static void zclBatterySave(uint16 rawMV);
+#endif /* BAT_NV_INTERVAL_MS > 0 */
 
 /*********************************************************************
  * LOCAL FUNCTIONS
  */
 
+/*********************************************************************
+ * @fn      zclBatteryProfile
+ *
+ * @brief   Find charge curve for BatterySize and BatteryQuantity
+ *
+ * @param   none
+ *
+ * @return  battery profile
+ */
+static const bat_profile_t *zclBatteryProfile(void)
+{
+  uint8 i;
+
+#ifdef BAT_PMAP
+  static bool slopesDone = FALSE;
+
+  if (!slopesDone)
+  {
+    slopesDone = TRUE;
+    for (i = 0; i < COUNT_OF(bat_custom) - 1; i++)
+      bat_custom[i].slope = (((uint32)bat_custom[i+1].perc - bat_custom[i].perc) << BAT_SLOPE_Q) /
+                            (bat_custom[i+1].mV - bat_custom[i].mV);
+  }
+#endif /* BAT_PMAP */
+
+  for (i = 0; i < COUNT_OF(bat_profiles); i++)
+  {
+    if (bat_profiles[i].size == zclBattery_Size && bat_profiles[i].quantity == zclBattery_Quantity)
+      return &bat_profiles[i];
+  }
+  return &bat_profiles[0];
+}
+
 /*********************************************************************
  * @fn      zclBatteryPercentage
  *
  * @brief   Map battery voltage to charge remaining percentage
  *
+ * @param   profile - battery charge curve
  * @param   mV - battery voltage in milliVolts
  *
  * @return  charge remaining percentage
  */
-static inline uint8 zclBatteryPercentage(uint16 mV)
+static uint8 zclBatteryPercentage(const bat_profile_t *profile, uint16 mV)
 {
-  static const bat_charge_t bat_charge[] = BAT_PMAP;
-  int i;
+  const bat_charge_t *p = profile->points;
+  uint8 i;
 
-  if (mV <= bat_charge[0].mV) return bat_charge[0].perc;
-  if (mV >= LAST_OF(bat_charge).mV) return LAST_OF(bat_charge).perc;
+  if (mV <= p[0].mV) return p[0].perc;
+  if (mV >= p[profile->count - 1].mV) return p[profile->count - 1].perc;
 
-  for(i = 1; i < COUNT_OF(bat_charge); i++)
+  for (i = 1; i < profile->count - 1; i++)
   {
-    if (mV == bat_charge[i].mV) return bat_charge[i].perc;
-    if (mV < bat_charge[i].mV) break;
+    if (mV < p[i].mV) break;
   }
+  p += i - 1;
 
-  return MAP(mV, bat_charge[i-1].mV, bat_charge[i].mV, bat_charge[i-1].perc, bat_charge[i].perc);
+  return p->perc + (uint8)(((uint32)(mV - p->mV) * p->slope + BV(BAT_SLOPE_Q - 1)) >> BAT_SLOPE_Q);
 }
 
+#if BAT_FILTER_S > 0
 /*********************************************************************
- * GLOBAL FUNCTIONS
+ * @fn      zclBatteryFilter
+ *
+ * @brief   Apply low-pass filter for the time since the previous sample
+ *
+ * @param   mV - measured battery voltage in milliVolts
+ *
+ * @return  filtered battery voltage in milliVolts
  */
+static uint16 zclBatteryFilter(uint16 mV)
+{
+  uint32 now = osal_GetSystemClock();
+  uint32 units = (now - zclBattery_FilterTime + BAT_FILTER_UNIT_MS / 2) / BAT_FILTER_UNIT_MS;
+  uint32 k = 0x10000;
+  uint8 i;
+
+  if (zclBattery_FilterK[0] == 0)
+  {
+    zclBattery_FilterK[0] = BAT_FILTER_K0;
+    for (i = 1; i < BAT_FILTER_STEPS; i++)
+      zclBattery_FilterK[i] = ((uint32)zclBattery_FilterK[i-1] * zclBattery_FilterK[i-1] + 0x8000) >> 16;
+  }
+
+  if (zclBattery_FilterQ4 == BATTERY_MV_INVALID || (units >> BAT_FILTER_STEPS))
+  {
+    zclBattery_FilterQ4 = mV << 4;
+    zclBattery_FilterTime = now;
+    return mV;
+  }
+
+  // keep the remainder for the next sample
+  zclBattery_FilterTime += units * BAT_FILTER_UNIT_MS;
+  for (i = 0; units; i++, units >>= 1)
+  {
+    if (units & 1)
+      k = (k * zclBattery_FilterK[i] + 0x8000) >> 16;
+  }
+  // both weights sum up to 0x10000, fits 32 bits for mV below 4096
+  zclBattery_FilterQ4 = ((uint32)zclBattery_FilterQ4 * k + ((uint32)mV << 4) * (0x10000 - k) + 0x8000) >> 16;
+
+  return (zclBattery_FilterQ4 + 8) >> 4;
+}
+#endif /* BAT_FILTER_S > 0 */
 
 /*********************************************************************
- * @fn      zclBatteryPercentage
+ * @fn      zclBatterySchedule
  *
- * @brief   Measure and report battery state
+ * @brief   Update discharge slope and pick next measurement interval
  *
+ * @param   profile - battery charge curve
+ * @param   mV - filtered battery voltage in milliVolts
+ *
+ * @return  none
+ */
+static void zclBatterySchedule(const bat_profile_t *profile, uint16 mV)
+{
+  uint16 knee = profile->points[profile->count > 2 ? 1 : 0].mV;
+  uint32 now = osal_GetSystemClock();
+  uint32 interval;
+
+  if (zclBattery_SlopeMV == BATTERY_MV_INVALID || mV > zclBattery_SlopeMV)
+  {
+    // first sample or recovering voltage, restart the estimate
+    zclBattery_SlopeMV = mV;
+    zclBattery_SlopeTime = now;
+  }
+  else
+  {
+    uint16 drop = zclBattery_SlopeMV - mV;
+    uint32 minutes = (now - zclBattery_SlopeTime) / MS_PER_MIN;
+
+    if (minutes > 0 && (drop >= BAT_SLOPE_MV || minutes >= BAT_SLOPE_MAX_MIN))
+    {
+      uint32 slope = (uint32)drop * MIN_PER_DAY / minutes;
+
+      if (slope > 0xFFFF) slope = 0xFFFF;
+      zclBattery_Slope = (zclBattery_Slope + (uint16)slope + 1) / 2;
+      zclBattery_SlopeMV = mV;
+      zclBattery_SlopeTime = now;
+    }
+  }
+
+  if (mV <= knee + BAT_KNEE_GUARD_MV)
+  {
+    interval = BAT_INTERVAL_MIN_MS;
+  }
+  else
+  {
+    interval = zclBattery_Interval < BAT_INTERVAL_MAX_MS / 2 ? zclBattery_Interval * 2 : BAT_INTERVAL_MAX_MS;
+    if (zclBattery_Slope > 0)
+    {
+      // minutes left until the knee at the current slope, spread over BAT_KNEE_SAMPLES
+      uint32 minutes = (uint32)(mV - knee) * MIN_PER_DAY / zclBattery_Slope / BAT_KNEE_SAMPLES;
+
+      if (minutes < interval / MS_PER_MIN)
+        interval = minutes * MS_PER_MIN;
+    }
+    if (interval < BAT_INTERVAL_MIN_MS)
+      interval = BAT_INTERVAL_MIN_MS;
+  }
+  zclBattery_Interval = interval;
+}
+
+#if BAT_NV_INTERVAL_MS > 0
+/*********************************************************************
+ * @fn      zclBatteryRestore
+ *
+ * @brief   Load battery state stored before reboot, once
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+static void zclBatteryRestore(void)
+{
+  bat_state_t state;
+  uint32 now = osal_GetSystemClock();
+
+  if (zclBattery_Restored)
+    return;
+  zclBattery_Restored = TRUE;
+
+  state.mV = BATTERY_MV_INVALID;
+  if (osal_nv_item_init(ZCD_NV_BATTERY_STATE, sizeof(state), &state) != ZSUCCESS ||
+      osal_nv_read(ZCD_NV_BATTERY_STATE, 0, sizeof(state), &state) != ZSUCCESS ||
+      state.mV == BATTERY_MV_INVALID)
+  {
+    return;
+  }
+
+#if BAT_FILTER_S > 0
+  zclBattery_FilterQ4 = state.filterQ4;
+  zclBattery_FilterTime = now;
+#endif /* BAT_FILTER_S > 0 */
+  zclBattery_Slope = state.slope;
+  zclBattery_SlopeMV = state.slopeMV;
+  zclBattery_SlopeTime = now - state.slopeAge;
+  zclBattery_Interval = state.interval;
+  zclBattery_mV = state.mV;
+  zclBattery_Voltage = FP_UDIV16(zclBattery_mV + 50, 100);
+  zclBattery_PercentageRemainig = state.perc;
+
+  zclBattery_NvMV = state.mV;
+  zclBattery_NvPerc = state.perc;
+  zclBattery_NvTime = now;
+  zclBattery_Resync = TRUE;
+
+  DBG_INFO(DEBUG_MODULE_BATTERY, "BAT: restored %d mV %u mV/d\r\n", zclBattery_mV, zclBattery_Slope);
+}
+
+/*********************************************************************
+ * @fn      zclBatterySave
+ *
+ * @brief   Store battery state if it changed enough and the last write
+ *          is at least BAT_NV_INTERVAL_MS old
+ *
+ * @param   rawMV - unfiltered voltage of the sample just processed
+ *
+ * @return  none
+ */
+static void zclBatterySave(uint16 rawMV)
+{
+  bat_state_t state;
+  uint32 now = osal_GetSystemClock();
+  uint16 delta;
+
+  (void)rawMV;
+
+  if (zclBattery_NvMV != BATTERY_MV_INVALID)
+  {
+    delta = zclBattery_mV > zclBattery_NvMV ? zclBattery_mV - zclBattery_NvMV : zclBattery_NvMV - zclBattery_mV;
+    if (delta < BAT_NV_DELTA_MV && zclBattery_PercentageRemainig == zclBattery_NvPerc)
+      return;
+    if (now - zclBattery_NvTime < BAT_NV_INTERVAL_MS)
+      return;
+  }
+
+#if BAT_FILTER_S > 0
+  state.filterQ4 = zclBattery_FilterQ4;
+#else
+  state.filterQ4 = rawMV << 4;
+#endif /* BAT_FILTER_S > 0 */
+  state.mV = zclBattery_mV;
+  state.perc = zclBattery_PercentageRemainig;
+  state.slope = zclBattery_Slope;
+  state.slopeMV = zclBattery_SlopeMV;
+  state.slopeAge = now - zclBattery_SlopeTime;
+  state.interval = zclBattery_Interval;
+  if (osal_nv_write(ZCD_NV_BATTERY_STATE, 0, sizeof(state), &state) == ZSUCCESS)
+  {
+    zclBattery_NvMV = state.mV;
+    zclBattery_NvPerc = state.perc;
+    zclBattery_NvTime = now;
+  }
+}
+#endif /* BAT_NV_INTERVAL_MS > 0 */
+
+#ifndef BDB_REPORTING
+/*********************************************************************
+ * @fn      zclBatteryRegister
+ *
+ * @brief   Register battery attributes with report_engine, values
+ *          are taken as reported, so the ones restored from NV don't
+ *          get reported again unless they change
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+static void zclBatteryRegister(void)
+{
+  zclBattery_Registered =
+    zclReportEngine_Add(ENERGY_MODULE_BATTERY, POWER_CFG_ENDPOINT, ZCL_CLUSTER_ID_GEN_POWER_CFG,
+                        ATTRID_POWER_CFG_BATTERY_VOLTAGE, ZCL_DATATYPE_UINT8, &zclBattery_Voltage,
+                        BAT_REPORT_MIN_S, BAT_REPORT_MAX_S, BAT_REPORT_CHANGE_V) &&
+    zclReportEngine_Add(ENERGY_MODULE_BATTERY, POWER_CFG_ENDPOINT, ZCL_CLUSTER_ID_GEN_POWER_CFG,
+                        ATTRID_POWER_CFG_BATTERY_PERCENTAGE_REMAINING, ZCL_DATATYPE_UINT8, &zclBattery_PercentageRemainig,
+                        BAT_REPORT_MIN_S, BAT_REPORT_MAX_S, BAT_REPORT_CHANGE_PERC) &&
+    zclReportEngine_Add(ENERGY_MODULE_BATTERY, POWER_CFG_ENDPOINT, ZCL_CLUSTER_ID_GEN_POWER_CFG,
+                        ATTRID_POWER_CFG_BATTERY_VOLTAGE_MV, ZCL_DATATYPE_UINT16, &zclBattery_mV,
+                        BAT_REPORT_MIN_S, BAT_REPORT_MAX_S, BAT_REPORT_CHANGE_MV);
+}
+#endif /* !BDB_REPORTING */
+
+/*********************************************************************
+ * @fn      zclBatteryProcess
+ *
+ * @brief   Update battery state from ADC readout and report it
+ *
+ * @param   rawADC - oversampled ADC readout
  * @param   forced - force the report bypassing BDB_REPORTING mechanics
  *
  * @return  none
  */
-void zclBatteryReport(bool forced)
+static void zclBatteryProcess(uint16 rawADC, bool forced)
 {
   (void)forced;
 
-  static const zclReportCmd_t BatReportCmd =
+  const bat_profile_t *profile = zclBatteryProfile();
+
+  ENERGY_ADC(ENERGY_MODULE_BATTERY, BAT_ADC_SAMPLES, adcConversionTicks);
+  uint16 rawMV = (uint16)FP_ADC2MV(rawADC, ADC_VREF_MV, BAT_ADC_RESOLUTION);
+  uint16 mV = rawMV;
+#if BAT_NV_INTERVAL_MS > 0
+  zclBatteryRestore();
+  if (zclBattery_Resync)
+  {
+    zclBattery_Resync = FALSE;
+    if (rawMV > zclBattery_NvMV + BAT_NV_RESYNC_MV)
     {
-      .numAttr = 3,
-      .attrList =
-      {
-        {
-          .attrID = ATTRID_POWER_CFG_BATTERY_VOLTAGE,
-          .dataType = ZCL_DATATYPE_UINT8,
-          .attrData = (void*)(&zclBattery_Voltage)
-        },
-        {
-          .attrID = ATTRID_POWER_CFG_BATTERY_PERCENTAGE_REMAINING,
-          .dataType = ZCL_DATATYPE_UINT8,
-          .attrData = (void *)(&zclBattery_PercentageRemainig)
-        },
-        {
-          .attrID = ATTRID_POWER_CFG_BATTERY_VOLTAGE_MV,
-          .dataType = ZCL_DATATYPE_UINT16,
-          .attrData = (void *)(&zclBattery_mV)
-        }
-      }
-    };
-
-  uint16 rawADC = adcReadOversampled(HAL_ADC_CHANNEL_VDD, BAT_ADC_RESOLUTION, HAL_ADC_REF_125V, 10);
-  uint16 mV = ADC2MV(rawADC, ADC_VREF_MV, BAT_ADC_RESOLUTION);
-#ifdef BAT_FILTER
-  if (zclBattery_mV != BATTERY_MV_INVALID)
-    mV = (uint32)((uint32)zclBattery_mV * (BAT_FILTER) + (uint32)mV * (1024 - (BAT_FILTER))) >> 10;
-#endif
+      // stored state belongs to other batteries, start over
+#if BAT_FILTER_S > 0
+      zclBattery_FilterQ4 = BATTERY_MV_INVALID;
+#endif /* BAT_FILTER_S > 0 */
+      zclBattery_Slope = 0;
+      zclBattery_SlopeMV = BATTERY_MV_INVALID;
+      zclBattery_Interval = APP_BAT_REPORT_INTERVAL_MS;
+      zclBattery_NvMV = BATTERY_MV_INVALID;
+    }
+  }
+#endif /* BAT_NV_INTERVAL_MS > 0 */
+#ifndef BDB_REPORTING
+  if (!zclBattery_Registered)
+    zclBatteryRegister();
+#endif /* !BDB_REPORTING */
+#if BAT_FILTER_S > 0
+  mV = zclBatteryFilter(mV);
+#endif /* BAT_FILTER_S > 0 */
   zclBattery_mV = mV;
-  zclBattery_Voltage = (zclBattery_mV + 50) / 100;
-  zclBattery_PercentageRemainig = zclBatteryPercentage(zclBattery_mV);
+  zclBattery_Voltage = FP_UDIV16(zclBattery_mV + 50, 100);
+  zclBattery_PercentageRemainig = zclBatteryPercentage(profile, zclBattery_mV);
+  zclBatterySchedule(profile, zclBattery_mV);
+#if BAT_NV_INTERVAL_MS > 0
+  zclBatterySave(rawMV);
+#endif /* BAT_NV_INTERVAL_MS > 0 */
 
 #ifdef BDB_REPORTING
   if (forced)
+#else
+  if (zclBattery_Registered)
   {
+    if (forced)
+      zclReportEngine_Force(POWER_CFG_ENDPOINT, ZCL_CLUSTER_ID_GEN_POWER_CFG);
+    else
+      zclReportEngine_Check();
+  }
+  else
 #endif /* BDB_REPORTING */
-    afAddrType_t dstAddr = {
-      .addrMode = (afAddrMode_t)AddrNotPresent,
-      .addr.shortAddr = 0,
-      .endPoint = POWER_CFG_ENDPOINT,
-    };
-    zcl_SendReportCmd(POWER_CFG_ENDPOINT, &dstAddr,
-                      ZCL_CLUSTER_ID_GEN_POWER_CFG, (zclReportCmd_t*)(&BatReportCmd),
-                      ZCL_FRAME_SERVER_CLIENT_DIR, TRUE, bdb_getZCLFrameCounter());
-#ifdef BDB_REPORTING
+  {
+    zclReportBatch_Add(ENERGY_MODULE_BATTERY, POWER_CFG_ENDPOINT, ZCL_CLUSTER_ID_GEN_POWER_CFG,
+                       ATTRID_POWER_CFG_BATTERY_VOLTAGE, ZCL_DATATYPE_UINT8, &zclBattery_Voltage);
+    zclReportBatch_Add(ENERGY_MODULE_BATTERY, POWER_CFG_ENDPOINT, ZCL_CLUSTER_ID_GEN_POWER_CFG,
+                       ATTRID_POWER_CFG_BATTERY_PERCENTAGE_REMAINING, ZCL_DATATYPE_UINT8,
+                       &zclBattery_PercentageRemainig);
+    zclReportBatch_Add(ENERGY_MODULE_BATTERY, POWER_CFG_ENDPOINT, ZCL_CLUSTER_ID_GEN_POWER_CFG,
+                       ATTRID_POWER_CFG_BATTERY_VOLTAGE_MV, ZCL_DATATYPE_UINT16, &zclBattery_mV);
   }
+#ifdef BDB_REPORTING
   else
   {
     bdb_RepChangedAttrValue(POWER_CFG_ENDPOINT, ZCL_CLUSTER_ID_GEN_POWER_CFG, ATTRID_POWER_CFG_BATTERY_VOLTAGE);
   }
 #endif /* BDB_REPORTING */
 
-  DBGF("BAT: %d ADC %d mV %d %%\r\n", rawADC, zclBattery_mV, (zclBattery_PercentageRemainig + 1) / 2);
+  DBG_INFO(DEBUG_MODULE_BATTERY, "BAT: %d ADC %d mV %d %% %u mV/d next %lu s\r\n", rawADC, zclBattery_mV,
+           (zclBattery_PercentageRemainig + 1) / 2, zclBattery_Slope, zclBattery_Interval / 1000);
+}
+
+/*********************************************************************
+ * GLOBAL FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      zclBattery_Init
+ *
+ * @brief   Enable asynchronous battery measurement. zclBatteryReport
+ *          then returns right after starting the ADC, and the library
+ *          task calls zclBatteryMeasured once the readout is done.
+ *          Battery state stored before reboot is loaded right away, so
+ *          the attributes are valid before the first measurement.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void zclBattery_Init(void)
+{
+  if (zclBattery_TaskId == BATTERY_NO_TASK)
+  {
+    zclBattery_TaskId = zAppTask_Id;
+    zclBattery_AdcEvent = zAppTask_AllocEvent(zclBatteryMeasured);
+  }
+#if BAT_NV_INTERVAL_MS > 0
+  zclBatteryRestore();
+#endif /* BAT_NV_INTERVAL_MS > 0 */
+}
+
+/*********************************************************************
+ * @fn      zclBatteryReport
+ *
+ * @brief   Measure and report battery state
+ *
+ * @param   forced - force the report bypassing BDB_REPORTING mechanics
+ *
+ * @return  none
+ */
+void zclBatteryReport(bool forced)
+{
+  ENERGY_WAKE(ENERGY_MODULE_BATTERY);
+
+  if (zclBattery_TaskId == BATTERY_NO_TASK)
+  {
+    uint16 rawADC;
+
+    TRACE_BEGIN(TRACE_ID_ADC);
+    rawADC = adcReadOversampled(HAL_ADC_CHANNEL_VDD, BAT_ADC_RESOLUTION, HAL_ADC_REF_125V, BAT_ADC_SAMPLES);
+    TRACE_END(TRACE_ID_ADC);
+    zclBatteryProcess(rawADC, forced);
+    return;
+  }
+
+  // a readout already in progress will serve this request as well
+  zclBattery_Forced |= forced;
+  if (adcReadOversampledAsync(HAL_ADC_CHANNEL_VDD, BAT_ADC_RESOLUTION, HAL_ADC_REF_125V, BAT_ADC_SAMPLES,
+                              zclBattery_TaskId, zclBattery_AdcEvent))
+  {
+    TRACE_BEGIN(TRACE_ID_ADC);
+  }
+}
+
+/*********************************************************************
+ * @fn      zclBatteryMeasured
+ *
+ * @brief   Finish asynchronous measurement and report battery state
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void zclBatteryMeasured(void)
+{
+  bool forced = zclBattery_Forced;
+
+  TRACE_END(TRACE_ID_ADC);
+  zclBattery_Forced = FALSE;
+  zclBatteryProcess(adcReadOversampledResult(), forced);
+}
+
+/*********************************************************************
+ * @fn      zclBatteryInterval
+ *
+ * @brief   Get the time to the next battery measurement. Starts at
+ *          APP_BAT_REPORT_INTERVAL_MS and adapts to the discharge rate
+ *          with every measurement processed.
+ *
+ * @param   none
+ *
+ * @return  interval in milliseconds
+ */
+uint32 zclBatteryInterval(void)
+{
+  return zclBattery_Interval;
 }
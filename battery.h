@@ -6,6 +6,23 @@
 // Custom attributes
 #define ATTRID_POWER_CFG_BATTERY_VOLTAGE_MV                0x0210
 
+/*
+ * BatterySize values. ZCL has no codes for coin cells,
+ * the ones from the reserved range below are specific to this library.
+ */
+#define BAT_SIZE_NO_BATTERY  0x00
+#define BAT_SIZE_BUILT_IN    0x01
+#define BAT_SIZE_OTHER       0x02
+#define BAT_SIZE_AA          0x03
+#define BAT_SIZE_AAA         0x04
+#define BAT_SIZE_C           0x05
+#define BAT_SIZE_D           0x06
+#define BAT_SIZE_CR2         0x07
+#define BAT_SIZE_CR123A      0x08
+#define BAT_SIZE_CR2032      0x80
+#define BAT_SIZE_CR2450      0x81
+#define BAT_SIZE_UNKNOWN     0xFF
+
 #define BATTERY_INVALID 0xFF
 #define BATTERY_MV_INVALID 0xFFFF
 
@@ -16,7 +33,13 @@
 extern uint8  zclBattery_Voltage;
 extern uint8  zclBattery_PercentageRemainig;
 extern uint16 zclBattery_mV;
+// BatterySize and BatteryQuantity select the charge curve
+extern uint8  zclBattery_Size;
+extern uint8  zclBattery_Quantity;
 
+extern void zclBattery_Init(void);
 extern void zclBatteryReport(bool forced);
+extern void zclBatteryMeasured(void);
+extern uint32 zclBatteryInterval(void);
 
 #endif /* BATTERY_H */
@@ -4,50 +4,169 @@
 #include "hal_key.h"
 #include "hal_led.h"
 #include "debug_print.h"
+#include "energy.h"
+#include "poll_control.h"
+#include "link_monitor.h"
+#include "tx_power.h"
+#include "zapp_task.h"
+#include "zapp_timer.h"
+#include "trace.h"
 
 #include "commissioning.h"
 
-#define APP_COMMISSIONING_END_DEVICE_REJOIN_MAX_DELAY ((uint32)1800000)     // 30 minutes 30 * 60 * 1000
-#define APP_COMMISSIONING_END_DEVICE_REJOIN_START_DELAY ((uint32)10 * 1000) // 10 seconds
-#define APP_COMMISSIONING_END_DEVICE_REJOIN_BACKOFF(delay) (delay = delay * 6 / 5)
-#define APP_COMMISSIONING_END_DEVICE_REJOIN_TRIES 20
+/*
+ * Rejoin delays follow decorrelated jitter backoff:
+ *   delay = min(MAX_DELAY, random(START_DELAY, delay * 3))
+ * for up to TRIES attempts after the network is lost, then a random delay
+ * between MAX_DELAY / 2 and MAX_DELAY is used. Random sequence is seeded
+ * from the IEEE address, so devices orphaned at once spread their
+ * attempts. At most BUDGET scheduled attempts are made per BUDGET_WINDOW
+ * of a long outage, once they are spent retries are suspended until the
+ * window is over. Key presses are not counted. The state is kept in NV
+ * and survives reboots.
+ */
+#ifndef APP_COMMISSIONING_END_DEVICE_REJOIN_MAX_DELAY
+    #define APP_COMMISSIONING_END_DEVICE_REJOIN_MAX_DELAY ((uint32)1800000)     // 30 minutes 30 * 60 * 1000
+#endif
+
+#ifndef APP_COMMISSIONING_END_DEVICE_REJOIN_START_DELAY
+    #define APP_COMMISSIONING_END_DEVICE_REJOIN_START_DELAY ((uint32)10 * 1000) // 10 seconds
+#endif
+
+#ifndef APP_COMMISSIONING_END_DEVICE_REJOIN_TRIES
+    #define APP_COMMISSIONING_END_DEVICE_REJOIN_TRIES 20
+#endif
+
+#ifndef APP_COMMISSIONING_END_DEVICE_REJOIN_BUDGET
+    #define APP_COMMISSIONING_END_DEVICE_REJOIN_BUDGET 24
+#endif
+
+#ifndef APP_COMMISSIONING_END_DEVICE_REJOIN_BUDGET_WINDOW
+    #define APP_COMMISSIONING_END_DEVICE_REJOIN_BUDGET_WINDOW ((uint32)24 * 60 * 60 * 1000) // 24 hours
+#endif
+
+#ifndef ZCD_NV_REJOIN_STATE
+    #define ZCD_NV_REJOIN_STATE 0x0411
+#endif
+
+/*
+ * Channel, PAN and parent of the last connection are cached in NV.
+ * The first TARGETED_TRIES rejoin attempts scan the cached channel only.
+ * Routers heard on that PAN are kept as alternate parents with their
+ * channel, the next attempt scans the channel of the best one, and the
+ * full channel list is used after that. The stack picks the parent from
+ * the beacons of the scan, the shortlist only tells where to look.
+ */
+#ifndef APP_COMMISSIONING_TARGETED_REJOIN_TRIES
+    #define APP_COMMISSIONING_TARGETED_REJOIN_TRIES 2
+#endif
+
+#ifndef APP_COMMISSIONING_ALTERNATE_PARENTS
+    #define APP_COMMISSIONING_ALTERNATE_PARENTS 3
+#endif
+
+#ifndef ZCD_NV_PARENT_CACHE
+    #define ZCD_NV_PARENT_CACHE 0x0412
+#endif
 
 #ifndef APP_TX_POWER
     #define APP_TX_POWER TX_PWR_PLUS_4
 #endif
 
-#define EVT_COMMISSIONING_CLOCK_DOWN_POLING_RATE  0x0001
-#define EVT_COMMISSIONING_END_DEVICE_REJOIN       0x0002
 
+static void zclCommissioning_ProcessStateChange(osal_event_hdr_t *msg);
+static void zclCommissioning_HandleKeys(uint8 portAndAction, uint8 keyCode);
+static void zclCommissioning_EndDeviceRejoin(void);
 static void zclCommissioning_ProcessCommissioningStatus(bdbCommissioningModeMsg_t *bdbCommissioningModeMsg);
 static void zclCommissioning_BindNotification(bdbBindNotificationData_t *data);
 static void zclCommissioning_ResetBackoffRetry(void);
+static uint32 zclCommissioning_NextRejoinDelay(void);
+static uint32 zclCommissioning_Random(void);
 static void zclCommissioning_OnConnect(void);
+static void zclCommissioning_AttemptRecoverNwk(void);
+static ZStatus_t zclCommissioning_RejoinChannel(uint8 channel);
+static void zclCommissioning_HistAdd(commissioningHist_t *hist, uint32 value, uint8 shift);
+static void zclCommissioning_SaveParent(void);
+static uint8 zclCommissioning_BestAlternate(void);
+static void *zclCommissioning_BeaconNotify(void *param);
 
 extern bool requestNewTrustCenterLinkKey;
 
-static byte rejoinsLeft = APP_COMMISSIONING_END_DEVICE_REJOIN_TRIES;
-static uint32 rejoinDelay = APP_COMMISSIONING_END_DEVICE_REJOIN_START_DELAY;
+typedef struct {
+    uint32 delay;          // last backoff delay
+    uint16 attempts;       // rejoin attempts since the network was lost
+    uint16 windowAttempts; // attempts in the budget window
+    uint32 windowTime;     // delays scheduled in the budget window, ms
+} rejoinState_t;
+
+static rejoinState_t rejoinState = {APP_COMMISSIONING_END_DEVICE_REJOIN_START_DELAY, 0, 0, 0};
+static uint32 rejoinSeed = 1;
 
-static uint8 zclCommissioning_TaskId = 0;
+typedef struct {
+    uint8 channel;                        // 0 if nothing cached
+    uint16 panId;
+    uint8 extPanId[Z_EXTADDR_LEN];
+    uint16 parentAddr;
+    uint16 alternateAddr[APP_COMMISSIONING_ALTERNATE_PARENTS];
+    uint8 alternateLqi[APP_COMMISSIONING_ALTERNATE_PARENTS];   // 0 if the slot is free
+    uint8 alternateChannel[APP_COMMISSIONING_ALTERNATE_PARENTS];
+} parentCache_t;
+
+static parentCache_t parentCache;
+static bool parentCacheDirty = FALSE;     // alternates changed since last NV write
+
+static uint16 zclCommissioning_RejoinEvent = 0;
+
+commissioningTelemetry_t zclCommissioning_Telemetry = {
+    .joinTime.len = sizeof(commissioningHist_t) - 1,
+    .recoverTime.len = sizeof(commissioningHist_t) - 1,
+    .recoverAttempts.len = sizeof(commissioningHist_t) - 1,
+};
+static uint32 joinStart;                  // commissioning start time
+static uint32 lostSince;                  // parent loss time
+static bool recovering = FALSE;
 
 /**************************************************************************************************
  * @fn      zclCommissioning_Init
  *
- * @brief   Initialize commissioning task
+ * @brief   Initialize commissioning, call after zAppTask_Init
  *
- * @param   task_id - ID of this task
+ * @param   None
  *
  * @return  None
  **************************************************************************************************/
-void zclCommissioning_Init(uint8 task_id)
+void zclCommissioning_Init(void)
 {
-    zclCommissioning_TaskId = task_id;
+    uint8 *extAddr = NLME_GetExtAddr();
+
+    zclCommissioning_RejoinEvent = zAppTask_AllocEvent(zclCommissioning_EndDeviceRejoin);
+    zAppTask_RegisterMsg(ZDO_STATE_CHANGE, zclCommissioning_ProcessStateChange);
+    zAppTask_RegisterKeys(zclCommissioning_HandleKeys);
+    joinStart = osal_GetSystemClock();
+    TRACE_BEGIN(TRACE_ID_JOIN);
+
+    for (uint8 i = 0; i < Z_EXTADDR_LEN; i++) {
+        rejoinSeed = ((rejoinSeed << 8) | (rejoinSeed >> 24)) ^ extAddr[i];
+    }
+    rejoinSeed ^= osal_rand();
+    if (rejoinSeed == 0) {
+        rejoinSeed = 1;
+    }
+    if (osal_nv_item_init(ZCD_NV_REJOIN_STATE, sizeof(rejoinState), &rejoinState) == ZSUCCESS) {
+        osal_nv_read(ZCD_NV_REJOIN_STATE, 0, sizeof(rejoinState), &rejoinState);
+    }
+    if (osal_nv_item_init(ZCD_NV_PARENT_CACHE, sizeof(parentCache), &parentCache) == ZSUCCESS) {
+        osal_nv_read(ZCD_NV_PARENT_CACHE, 0, sizeof(parentCache), &parentCache);
+    }
+    ZDO_RegisterForZdoCB(ZDO_BEACON_NOTIFY_IND_CBID, zclCommissioning_BeaconNotify);
+
+    zclPollControl_Init();
+    zclLinkMonitor_Init();
 
     bdb_RegisterCommissioningStatusCB(zclCommissioning_ProcessCommissioningStatus);
     bdb_RegisterBindNotificationCB(zclCommissioning_BindNotification);
 
-    ZMacSetTransmitPower(APP_TX_POWER);
+    zclTxPower_Init(APP_TX_POWER);
 
     // this is important to allow connects throught routers
     // to make this work, coordinator should be compiled with this flag #define TP2_LEGACY_ZC
@@ -56,85 +175,66 @@ void zclCommissioning_Init(uint8 task_id)
 }
 
 /**************************************************************************************************
- * @fn      zclCommissioning_event_loop
+ * @fn      zclCommissioning_Sleep
  *
- * @brief   Task event loop
+ * @brief   Allow or prevent deep sleep, see poll_control for finer control
  *
- * @param   task_id - ID of the task
- * @param   events - pending events
+ * @param   allow - true to allow sleep, false to prevent
  *
- * @return  pending events still active after completion
+ * @return  None
  **************************************************************************************************/
-uint16 zclCommissioning_event_loop(uint8 task_id, uint16 events) {
-    if (events & SYS_EVENT_MSG) {
-        devStates_t zclApp_NwkState;
-        afIncomingMSGPacket_t *MSGpkt;
-        while ((MSGpkt = (afIncomingMSGPacket_t *)osal_msg_receive(zclCommissioning_TaskId))) {
-
-            switch (MSGpkt->hdr.event) {
-            case ZDO_STATE_CHANGE:
-                HalLedSet(HAL_LED_1, HAL_LED_MODE_BLINK);
-                zclApp_NwkState = (devStates_t)(MSGpkt->hdr.status);
-                DBGF("NwkState=%d\r\n", zclApp_NwkState);
-                if (zclApp_NwkState == DEV_END_DEVICE) {
-                    HalLedSet(HAL_LED_1, HAL_LED_MODE_OFF);
-                }
-                break;
-
-            case ZCL_INCOMING_MSG:
-                if (((zclIncomingMsg_t *)MSGpkt)->attrCmd)
-                {
-                    osal_mem_free(((zclIncomingMsg_t *)MSGpkt)->attrCmd);
-                }
-                break;
-
-            default:
-                break;
-            }
-
-            // Release the memory
-            osal_msg_deallocate((uint8 *)MSGpkt);
-        }
-
-        // return unprocessed events
-        return (events ^ SYS_EVENT_MSG);
-    }
-    if (events & EVT_COMMISSIONING_END_DEVICE_REJOIN) {
-        DBG("APP_END_DEVICE_REJOIN_EVT\r\n");
-#if ZG_BUILD_ENDDEVICE_TYPE
-        bdb_ZedAttemptRecoverNwk();
-#endif
-        return (events ^ EVT_COMMISSIONING_END_DEVICE_REJOIN);
+void zclCommissioning_Sleep(uint8 allow) {
+    DBG_TRACE(DEBUG_MODULE_COMMISSIONING, "zclCommissioning_Sleep %d\r\n", allow);
+    if (allow) {
+        zclPollControl_Sleep();
+    } else {
+        zclPollControl_Hold(TRUE);
     }
+}
 
-    if (events & EVT_COMMISSIONING_CLOCK_DOWN_POLING_RATE) {
-        DBG("APP_CLOCK_DOWN_POLING_RATE_EVT\r\n");
-        zclCommissioning_Sleep(true);
-        return (events ^ EVT_COMMISSIONING_CLOCK_DOWN_POLING_RATE);
-    }
+/**************************************************************************************************
+ * @fn      zclCommissioning_ProcessStateChange
+ *
+ * @brief   Process ZDO_STATE_CHANGE message
+ *
+ * @param   msg - incoming message
+ *
+ * @return  None
+ **************************************************************************************************/
+static void zclCommissioning_ProcessStateChange(osal_event_hdr_t *msg)
+{
+    devStates_t zclApp_NwkState = (devStates_t)(msg->status);
 
-    // Discard unknown events
-    return 0;
+    ENERGY_WAKE(ENERGY_MODULE_COMMISSIONING);
+    ENERGY_LED_SET(ENERGY_MODULE_COMMISSIONING, HAL_LED_1, HAL_LED_MODE_BLINK);
+    DBG_INFO(DEBUG_MODULE_COMMISSIONING, "NwkState=%d\r\n", zclApp_NwkState);
+    TRACE_INSTANT(TRACE_ID_NWK_STATE, zclApp_NwkState);
+    if (zclApp_NwkState == DEV_END_DEVICE) {
+        ENERGY_LED_SET(ENERGY_MODULE_COMMISSIONING, HAL_LED_1, HAL_LED_MODE_OFF);
+        zclCommissioning_SaveParent();
+        zclLinkMonitor_Reset();
+    }
 }
 
 /**************************************************************************************************
- * @fn      zclCommissioning_Sleep
+ * @fn      zclCommissioning_EndDeviceRejoin
  *
- * @brief   Initialize commissioning task
+ * @brief   Scheduled rejoin attempt
  *
- * @param   allow - true to allow sleep, false to prevent
+ * @param   None
  *
  * @return  None
  **************************************************************************************************/
-void zclCommissioning_Sleep(uint8 allow) {
-    DBGF("zclCommissioning_Sleep %d\r\n", allow);
-#if defined(POWER_SAVING)
-    if (allow) {
-        NLME_SetPollRate(0);
-    } else {
-        NLME_SetPollRate(POLL_RATE);
+static void zclCommissioning_EndDeviceRejoin(void)
+{
+    ENERGY_WAKE(ENERGY_MODULE_COMMISSIONING);
+    DBG_TRACE(DEBUG_MODULE_COMMISSIONING, "APP_END_DEVICE_REJOIN_EVT\r\n");
+    if (rejoinState.windowAttempts > APP_COMMISSIONING_END_DEVICE_REJOIN_BUDGET) {
+        // suspension is over, this attempt opens the next budget window
+        rejoinState.windowAttempts = 1;
+        rejoinState.windowTime = 0;
     }
-#endif
+    zclCommissioning_AttemptRecoverNwk();
 }
 
 /**************************************************************************************************
@@ -147,21 +247,19 @@ void zclCommissioning_Sleep(uint8 allow) {
  *
  * @return  None
  **************************************************************************************************/
-void zclCommissioning_HandleKeys(uint8 portAndAction, uint8 keyCode)
+static void zclCommissioning_HandleKeys(uint8 portAndAction, uint8 keyCode)
 {
     if (portAndAction & HAL_KEY_PRESS)
     {
 #if ZG_BUILD_ENDDEVICE_TYPE
         if (devState == DEV_NWK_ORPHAN)
         {
-            DBGF("devState=%d try to restore network\r\n", devState);
-            bdb_ZedAttemptRecoverNwk();
+            DBG_INFO(DEBUG_MODULE_COMMISSIONING, "devState=%d try to restore network\r\n", devState);
+            zclCommissioning_AttemptRecoverNwk();
         }
 #endif
     }
-#if defined(POWER_SAVING)
-    NLME_SetPollRate(1);
-#endif
+    zclPollControl_Raise(POLL_LEVEL_FAST, POLL_REASON_KEY);
 }
 
 /**************************************************************************************************
@@ -175,17 +273,23 @@ void zclCommissioning_HandleKeys(uint8 portAndAction, uint8 keyCode)
  **************************************************************************************************/
 static void zclCommissioning_ProcessCommissioningStatus(bdbCommissioningModeMsg_t *bdbCommissioningModeMsg)
 {
-    DBGF("bdbCommissioningMode=%d bdbCommissioningStatus=%d bdbRemainingCommissioningModes=0x%X\r\n",
-         bdbCommissioningModeMsg->bdbCommissioningMode, bdbCommissioningModeMsg->bdbCommissioningStatus,
-         bdbCommissioningModeMsg->bdbRemainingCommissioningModes);
+    uint32 rejoinDelay;
+
+    DBG_TRACE(DEBUG_MODULE_COMMISSIONING, "bdbCommissioningMode=%d bdbCommissioningStatus=%d bdbRemainingCommissioningModes=0x%X\r\n",
+              bdbCommissioningModeMsg->bdbCommissioningMode, bdbCommissioningModeMsg->bdbCommissioningStatus,
+              bdbCommissioningModeMsg->bdbRemainingCommissioningModes);
+    // BDB network steering takes the beacon callback over and drops it when done
+    if (bdbCommissioningModeMsg->bdbCommissioningStatus != BDB_COMMISSIONING_IN_PROGRESS) {
+        ZDO_RegisterForZdoCB(ZDO_BEACON_NOTIFY_IND_CBID, zclCommissioning_BeaconNotify);
+    }
     switch (bdbCommissioningModeMsg->bdbCommissioningMode)
     {
     case BDB_COMMISSIONING_INITIALIZATION:
         switch (bdbCommissioningModeMsg->bdbCommissioningStatus)
         {
         case BDB_COMMISSIONING_NO_NETWORK:
-            DBG("No network\r\n");
-            HalLedBlink(HAL_LED_1, 3, 50, 500);
+            DBG_WARN(DEBUG_MODULE_COMMISSIONING, "No network\r\n");
+            ENERGY_LED_BLINK(ENERGY_MODULE_COMMISSIONING, HAL_LED_1, 3, 50, 500);
             break;
         case BDB_COMMISSIONING_NETWORK_RESTORED:
             zclCommissioning_OnConnect();
@@ -199,36 +303,50 @@ static void zclCommissioning_ProcessCommissioningStatus(bdbCommissioningModeMsg_
         switch (bdbCommissioningModeMsg->bdbCommissioningStatus)
         {
         case BDB_COMMISSIONING_SUCCESS:
-            HalLedBlink(HAL_LED_1, 5, 50, 500);
-            DBG("BDB_COMMISSIONING_SUCCESS\r\n");
+            ENERGY_LED_BLINK(ENERGY_MODULE_COMMISSIONING, HAL_LED_1, 5, 50, 500);
+            DBG_INFO(DEBUG_MODULE_COMMISSIONING, "BDB_COMMISSIONING_SUCCESS\r\n");
+            zclCommissioning_Telemetry.joins++;
+            zclCommissioning_Telemetry.lastJoinTime = osal_GetSystemClock() - joinStart;
+            zclCommissioning_HistAdd(&zclCommissioning_Telemetry.joinTime,
+                                     zclCommissioning_Telemetry.lastJoinTime / 1000, 2);
             zclCommissioning_OnConnect();
             break;
 
         default:
-            HalLedSet(HAL_LED_1, HAL_LED_MODE_BLINK);
+            ENERGY_LED_SET(ENERGY_MODULE_COMMISSIONING, HAL_LED_1, HAL_LED_MODE_BLINK);
             break;
         }
         break;
 
     case BDB_COMMISSIONING_PARENT_LOST:
-        DBG("BDB_COMMISSIONING_PARENT_LOST\r\n");
+        DBG_WARN(DEBUG_MODULE_COMMISSIONING, "BDB_COMMISSIONING_PARENT_LOST\r\n");
         switch (bdbCommissioningModeMsg->bdbCommissioningStatus)
         {
         case BDB_COMMISSIONING_NETWORK_RESTORED:
+            if (recovering) {
+                TRACE_END(TRACE_ID_RECOVER);
+                recovering = FALSE;
+                zclCommissioning_Telemetry.recoveries++;
+                zclCommissioning_Telemetry.lastRecoverTime = osal_GetSystemClock() - lostSince;
+                zclCommissioning_HistAdd(&zclCommissioning_Telemetry.recoverTime,
+                                         zclCommissioning_Telemetry.lastRecoverTime / 1000, 2);
+                zclCommissioning_HistAdd(&zclCommissioning_Telemetry.recoverAttempts, rejoinState.attempts, 1);
+            }
             zclCommissioning_ResetBackoffRetry();
             break;
 
         default:
-            HalLedSet(HAL_LED_1, HAL_LED_MODE_BLINK);
-            // // Parent not found, attempt to rejoin again after a exponential backoff delay
-            DBGF("rejoinsLeft %d rejoinDelay=%ld\r\n", rejoinsLeft, rejoinDelay);
-            if (rejoinsLeft > 0) {
-                APP_COMMISSIONING_END_DEVICE_REJOIN_BACKOFF(rejoinDelay);
-                rejoinsLeft -= 1;
-            } else {
-                rejoinDelay = APP_COMMISSIONING_END_DEVICE_REJOIN_MAX_DELAY;
+            if (!recovering) {
+                TRACE_BEGIN(TRACE_ID_RECOVER);
+                recovering = TRUE;
+                lostSince = osal_GetSystemClock();
+                zclCommissioning_Telemetry.parentLost++;
             }
-            osal_start_timerEx(zclCommissioning_TaskId, EVT_COMMISSIONING_END_DEVICE_REJOIN, rejoinDelay);
+            ENERGY_LED_SET(ENERGY_MODULE_COMMISSIONING, HAL_LED_1, HAL_LED_MODE_BLINK);
+            // Parent not found, attempt to rejoin again after a backoff delay,
+            // it is random anyway so let it slip to share a wakeup
+            rejoinDelay = zclCommissioning_NextRejoinDelay();
+            zAppTimer_Start(zAppTask_Id, zclCommissioning_RejoinEvent, rejoinDelay, rejoinDelay >> 3);
             break;
         }
         break;
@@ -249,13 +367,15 @@ static void zclCommissioning_ProcessCommissioningStatus(bdbCommissioningModeMsg_
  **************************************************************************************************/
 static void zclCommissioning_BindNotification(bdbBindNotificationData_t *bdbBindNotificationData)
 {
-    HalLedSet(HAL_LED_1, HAL_LED_MODE_BLINK);
-    DBGF("Recieved bind request clusterId=0x%X dstAddr=0x%X ep=%d\r\n",
-        bdbBindNotificationData->clusterId, bdbBindNotificationData->dstAddr,
-        bdbBindNotificationData->ep);
+    ENERGY_LED_SET(ENERGY_MODULE_COMMISSIONING, HAL_LED_1, HAL_LED_MODE_BLINK);
+    zclPollControl_Raise(POLL_LEVEL_FAST, POLL_REASON_BINDING);
+    zclCommissioning_Telemetry.bindNotifications++;
+    DBG_INFO(DEBUG_MODULE_COMMISSIONING, "Recieved bind request clusterId=0x%X dstAddr=0x%X ep=%d\r\n",
+             bdbBindNotificationData->clusterId, bdbBindNotificationData->dstAddr.addr.shortAddr,
+             bdbBindNotificationData->ep);
     uint16 maxEntries = 0, usedEntries = 0;
     bindCapacity(&maxEntries, &usedEntries);
-    DBGF("bindCapacity %d %usedEntries %d \r\n", maxEntries, usedEntries);
+    DBG_TRACE(DEBUG_MODULE_COMMISSIONING, "bindCapacity %d %usedEntries %d \r\n", maxEntries, usedEntries);
 }
 
 /**************************************************************************************************
@@ -269,8 +389,79 @@ static void zclCommissioning_BindNotification(bdbBindNotificationData_t *bdbBind
  **************************************************************************************************/
 static void zclCommissioning_ResetBackoffRetry(void)
 {
-    rejoinsLeft = APP_COMMISSIONING_END_DEVICE_REJOIN_TRIES;
-    rejoinDelay = APP_COMMISSIONING_END_DEVICE_REJOIN_START_DELAY;
+    if (rejoinState.attempts == 0 && rejoinState.delay == APP_COMMISSIONING_END_DEVICE_REJOIN_START_DELAY) {
+        return;
+    }
+    rejoinState.attempts = 0;
+    rejoinState.delay = APP_COMMISSIONING_END_DEVICE_REJOIN_START_DELAY;
+    rejoinState.windowAttempts = 0;
+    rejoinState.windowTime = 0;
+    osal_nv_write(ZCD_NV_REJOIN_STATE, 0, sizeof(rejoinState), &rejoinState);
+}
+
+/**************************************************************************************************
+ * @fn      zclCommissioning_NextRejoinDelay
+ *
+ * @brief   Account rejoin attempt and pick the delay before it
+ *
+ * @param   None
+ *
+ * @return  delay in milliseconds
+ **************************************************************************************************/
+static uint32 zclCommissioning_NextRejoinDelay(void)
+{
+    uint32 delay;
+
+    if (rejoinState.attempts < APP_COMMISSIONING_END_DEVICE_REJOIN_TRIES) {
+        uint32 span = rejoinState.delay * 3 - APP_COMMISSIONING_END_DEVICE_REJOIN_START_DELAY;
+
+        delay = APP_COMMISSIONING_END_DEVICE_REJOIN_START_DELAY + zclCommissioning_Random() % (span + 1);
+        if (delay > APP_COMMISSIONING_END_DEVICE_REJOIN_MAX_DELAY) {
+            delay = APP_COMMISSIONING_END_DEVICE_REJOIN_MAX_DELAY;
+        }
+        rejoinState.delay = delay;
+        rejoinState.attempts++;
+    } else {
+        delay = APP_COMMISSIONING_END_DEVICE_REJOIN_MAX_DELAY / 2 +
+                zclCommissioning_Random() % (APP_COMMISSIONING_END_DEVICE_REJOIN_MAX_DELAY / 2);
+    }
+
+    // the waits are the time orphaned, BUDGET + 1 attempts mark the wait for the window
+    // to end in NV until the attempt after it, a reboot starts the wait over
+    if (rejoinState.windowAttempts >= APP_COMMISSIONING_END_DEVICE_REJOIN_BUDGET) {
+        if (delay < APP_COMMISSIONING_END_DEVICE_REJOIN_BUDGET_WINDOW - rejoinState.windowTime) {
+            delay = APP_COMMISSIONING_END_DEVICE_REJOIN_BUDGET_WINDOW - rejoinState.windowTime;
+        }
+        rejoinState.windowAttempts = APP_COMMISSIONING_END_DEVICE_REJOIN_BUDGET + 1;
+        DBG_WARN(DEBUG_MODULE_COMMISSIONING, "rejoin budget spent, suspended for %ld\r\n", delay);
+    } else if (rejoinState.windowTime + delay >= APP_COMMISSIONING_END_DEVICE_REJOIN_BUDGET_WINDOW) {
+        rejoinState.windowAttempts = 1;
+        rejoinState.windowTime = 0;
+    } else {
+        rejoinState.windowAttempts++;
+        rejoinState.windowTime += delay;
+    }
+    // once per scheduled attempt, at most BUDGET + 1 times per window
+    osal_nv_write(ZCD_NV_REJOIN_STATE, 0, sizeof(rejoinState), &rejoinState);
+    DBG_INFO(DEBUG_MODULE_COMMISSIONING, "rejoin attempt %d delay=%ld\r\n", rejoinState.attempts, delay);
+    return delay;
+}
+
+/**************************************************************************************************
+ * @fn      zclCommissioning_Random
+ *
+ * @brief   xorshift32 pseudo random generator
+ *
+ * @param   None
+ *
+ * @return  next random value
+ **************************************************************************************************/
+static uint32 zclCommissioning_Random(void)
+{
+    rejoinSeed ^= rejoinSeed << 13;
+    rejoinSeed ^= rejoinSeed >> 17;
+    rejoinSeed ^= rejoinSeed << 5;
+    return rejoinSeed;
 }
 
 /**************************************************************************************************
@@ -284,7 +475,215 @@ static void zclCommissioning_ResetBackoffRetry(void)
  **************************************************************************************************/
 static void zclCommissioning_OnConnect(void)
 {
-    DBG("zclCommissioning_OnConnect \r\n");
+    DBG_TRACE(DEBUG_MODULE_COMMISSIONING, "zclCommissioning_OnConnect \r\n");
+    TRACE_END(TRACE_ID_JOIN);
     zclCommissioning_ResetBackoffRetry();
-    osal_start_timerEx(zclCommissioning_TaskId, EVT_COMMISSIONING_CLOCK_DOWN_POLING_RATE, 10 * 1000);
+    // keep POLL_RATE for POLL_CONTROL_NORMAL_HOLD to finish joining, then decay to sleep
+    zclPollControl_Raise(POLL_LEVEL_NORMAL, POLL_REASON_JOIN);
+}
+
+/**************************************************************************************************
+ * @fn      zclCommissioning_AttemptRecoverNwk
+ *
+ * @brief   Rejoin on the cached channel first, then on the channel of the
+ *          best alternate parent, on all channels after that
+ *
+ * @param   None
+ *
+ * @return  None
+ **************************************************************************************************/
+static void zclCommissioning_AttemptRecoverNwk(void)
+{
+#if ZG_BUILD_ENDDEVICE_TYPE
+    uint8 channel = 0;
+
+    zclCommissioning_Telemetry.rejoinAttempts++;
+    TRACE_INSTANT(TRACE_ID_REJOIN, rejoinState.attempts);
+    if (parentCache.channel != 0 && rejoinState.attempts <= APP_COMMISSIONING_TARGETED_REJOIN_TRIES) {
+        channel = parentCache.channel;
+        DBG_INFO(DEBUG_MODULE_COMMISSIONING, "rejoin on channel %d, parent 0x%04X\r\n", channel, parentCache.parentAddr);
+    } else if (rejoinState.attempts == APP_COMMISSIONING_TARGETED_REJOIN_TRIES + 1) {
+        uint8 best = zclCommissioning_BestAlternate();
+
+        if (best < APP_COMMISSIONING_ALTERNATE_PARENTS) {
+            channel = parentCache.alternateChannel[best];
+            DBG_INFO(DEBUG_MODULE_COMMISSIONING, "rejoin on channel %d, alternate 0x%04X\r\n", channel,
+                     parentCache.alternateAddr[best]);
+        }
+    }
+    if (channel != 0 && zclCommissioning_RejoinChannel(channel) == ZSUCCESS) {
+        return;
+    }
+    bdb_ZedAttemptRecoverNwk();
+#endif
+}
+
+/**************************************************************************************************
+ * @fn      zclCommissioning_SwitchParent
+ *
+ * @brief   Rejoin the network while still on it to find a better parent,
+ *          on the channel of the best alternate parent, the current one
+ *          if none is cached
+ *
+ * @param   None
+ *
+ * @return  ZSUCCESS if the rejoin started
+ **************************************************************************************************/
+ZStatus_t zclCommissioning_SwitchParent(void)
+{
+#if ZG_BUILD_ENDDEVICE_TYPE
+    uint8 best = zclCommissioning_BestAlternate();
+    uint8 channel = parentCache.channel;
+
+    if (devState != DEV_END_DEVICE || channel == 0) {
+        return ZFAILURE;
+    }
+    if (best < APP_COMMISSIONING_ALTERNATE_PARENTS) {
+        channel = parentCache.alternateChannel[best];
+    }
+    DBG_INFO(DEBUG_MODULE_COMMISSIONING, "switch parent on channel %d\r\n", channel);
+    return zclCommissioning_RejoinChannel(channel);
+#else
+    return ZFAILURE;
+#endif
+}
+
+/**************************************************************************************************
+ * @fn      zclCommissioning_RejoinChannel
+ *
+ * @brief   Rejoin the cached PAN scanning a single channel
+ *
+ * @param   channel - channel to scan
+ *
+ * @return  NLME_ReJoinRequest status
+ **************************************************************************************************/
+static ZStatus_t zclCommissioning_RejoinChannel(uint8 channel)
+{
+    ZStatus_t status = NLME_ReJoinRequest(parentCache.extPanId, (uint32)1 << channel);
+
+    // same states bdb_ZedAttemptRecoverNwk enters, the state stays if the request is refused
+    if (status == ZSUCCESS) {
+        ZDApp_ChangeState(ZDApp_RestoreNwkKey(TRUE) ? DEV_NWK_SEC_REJOIN_CURR_CHANNEL : DEV_NWK_TC_REJOIN_CURR_CHANNEL);
+    }
+    return status;
+}
+
+/**************************************************************************************************
+ * @fn      zclCommissioning_BestAlternate
+ *
+ * @brief   Find the alternate parent with the best LQI
+ *
+ * @param   None
+ *
+ * @return  slot index, APP_COMMISSIONING_ALTERNATE_PARENTS if none is cached
+ **************************************************************************************************/
+static uint8 zclCommissioning_BestAlternate(void)
+{
+    uint8 best = APP_COMMISSIONING_ALTERNATE_PARENTS;
+
+    for (uint8 i = 0; i < APP_COMMISSIONING_ALTERNATE_PARENTS; i++) {
+        if (parentCache.alternateLqi[i] != 0 &&
+            (best == APP_COMMISSIONING_ALTERNATE_PARENTS || parentCache.alternateLqi[i] > parentCache.alternateLqi[best])) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+/**************************************************************************************************
+ * @fn      zclCommissioning_SaveParent
+ *
+ * @brief   Cache current channel, PAN and parent in NV if they changed
+ *
+ * @param   None
+ *
+ * @return  None
+ **************************************************************************************************/
+static void zclCommissioning_SaveParent(void)
+{
+    parentCache_t cache = parentCache;
+
+    cache.channel = _NIB.nwkLogicalChannel;
+    cache.panId = _NIB.nwkPanId;
+    osal_memcpy(cache.extPanId, _NIB.extendedPANID, Z_EXTADDR_LEN);
+    cache.parentAddr = _NIB.nwkCoordAddress;
+    // the new parent is no alternate, neither are routers of another PAN
+    for (uint8 i = 0; i < APP_COMMISSIONING_ALTERNATE_PARENTS; i++) {
+        if (cache.alternateAddr[i] == cache.parentAddr ||
+            !osal_memcmp(cache.extPanId, parentCache.extPanId, Z_EXTADDR_LEN)) {
+            cache.alternateLqi[i] = 0;
+        }
+    }
+
+    if (!parentCacheDirty && osal_memcmp(&cache, &parentCache, sizeof(cache))) {
+        return;
+    }
+    parentCache = cache;
+    parentCacheDirty = FALSE;
+    osal_nv_write(ZCD_NV_PARENT_CACHE, 0, sizeof(parentCache), &parentCache);
+    DBG_TRACE(DEBUG_MODULE_COMMISSIONING, "parent 0x%04X channel %d pan 0x%04X cached\r\n", parentCache.parentAddr, parentCache.channel,
+              parentCache.panId);
+}
+
+/**************************************************************************************************
+ * @fn      zclCommissioning_BeaconNotify
+ *
+ * @brief   Collect alternate parents from beacons of the cached PAN
+ *
+ * @param   param - zdoBeaconInd_t
+ *
+ * @return  NULL
+ **************************************************************************************************/
+static void *zclCommissioning_BeaconNotify(void *param)
+{
+    zdoBeaconInd_t *beacon = (zdoBeaconInd_t *)param;
+    uint8 slot = 0;
+
+    if (parentCache.channel == 0 || !beacon->deviceCapacity || beacon->sourceAddr == parentCache.parentAddr ||
+        !osal_memcmp(beacon->extendedPanID, parentCache.extPanId, Z_EXTADDR_LEN)) {
+        return NULL;
+    }
+
+    // refresh known router or replace the worst one
+    for (uint8 i = 0; i < APP_COMMISSIONING_ALTERNATE_PARENTS; i++) {
+        if (parentCache.alternateAddr[i] == beacon->sourceAddr) {
+            slot = i;
+            break;
+        }
+        if (parentCache.alternateLqi[i] < parentCache.alternateLqi[slot]) {
+            slot = i;
+        }
+    }
+    if (parentCache.alternateAddr[slot] != beacon->sourceAddr && parentCache.alternateLqi[slot] >= beacon->LQI) {
+        return NULL;
+    }
+    parentCache.alternateAddr[slot] = beacon->sourceAddr;
+    parentCache.alternateLqi[slot] = beacon->LQI;
+    parentCache.alternateChannel[slot] = beacon->logicalChannel;
+    parentCacheDirty = TRUE;
+    return NULL;
+}
+
+/**************************************************************************************************
+ * @fn      zclCommissioning_HistAdd
+ *
+ * @brief   Count value in logarithmic histogram
+ *
+ * @param   hist - histogram
+ * @param   value - value to count
+ * @param   shift - log2 of bucket width ratio
+ *
+ * @return  None
+ **************************************************************************************************/
+static void zclCommissioning_HistAdd(commissioningHist_t *hist, uint32 value, uint8 shift)
+{
+    uint8 i = 0;
+
+    while (value && i < COMMISSIONING_HIST_BUCKETS - 1) {
+        value >>= shift;
+        i++;
+    }
+    if (hist->bucket[i] < 0xFFFF) {
+        hist->bucket[i]++;
+    }
 }
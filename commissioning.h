@@ -2,10 +2,53 @@
 #define COMMISSIONING_H
 
 #include "hal_defs.h"
+#include "ZComDef.h"
 
-extern void zclCommissioning_Init(uint8 task_id);
-extern uint16 zclCommissioning_event_loop(uint8 task_id, uint16 events);
+/*
+ * Commissioning telemetry, Diagnostics cluster custom attributes.
+ * Histograms are octet strings of COMMISSIONING_HIST_BUCKETS little
+ * endian uint16 counters. Time buckets are < 1 s, < 4 s, < 16 s ... and
+ * the last one takes the rest, attempt buckets are 0, 1, 2-3, 4-7 ...
+ * Standard LastMessageLQI and LastMessageRSSI can be backed by
+ * zclLinkMonitor_Stats.lqi and .rssi.
+ */
+#define ATTRID_DIAGNOSTIC_JOINS                            0x0200
+#define ATTRID_DIAGNOSTIC_PARENT_LOST                      0x0201
+#define ATTRID_DIAGNOSTIC_RECOVERIES                       0x0202
+#define ATTRID_DIAGNOSTIC_REJOIN_ATTEMPTS                  0x0203
+#define ATTRID_DIAGNOSTIC_BIND_NOTIFICATIONS               0x0204
+#define ATTRID_DIAGNOSTIC_LAST_JOIN_TIME                   0x0205
+#define ATTRID_DIAGNOSTIC_LAST_RECOVER_TIME                0x0206
+#define ATTRID_DIAGNOSTIC_JOIN_TIME_HIST                   0x0207
+#define ATTRID_DIAGNOSTIC_RECOVER_TIME_HIST                0x0208
+#define ATTRID_DIAGNOSTIC_RECOVER_ATTEMPTS_HIST            0x0209
+
+#define COMMISSIONING_HIST_BUCKETS 8
+
+typedef struct
+{
+    uint8 len;
+    uint16 bucket[COMMISSIONING_HIST_BUCKETS];
+} commissioningHist_t;
+
+typedef struct
+{
+    uint16 joins;                        // successful network steering
+    uint16 parentLost;                   // parent lost events
+    uint16 recoveries;                   // networks restored after parent loss
+    uint32 rejoinAttempts;               // scheduled and key press rejoin attempts
+    uint16 bindNotifications;
+    uint32 lastJoinTime;                 // ms from start to join
+    uint32 lastRecoverTime;              // ms from parent loss to recovery
+    commissioningHist_t joinTime;
+    commissioningHist_t recoverTime;
+    commissioningHist_t recoverAttempts; // rejoin attempts per recovery
+} commissioningTelemetry_t;
+
+extern commissioningTelemetry_t zclCommissioning_Telemetry;
+
+extern void zclCommissioning_Init(void);
 extern void zclCommissioning_Sleep( uint8 allow );
-extern void zclCommissioning_HandleKeys(uint8 portAndAction, uint8 keyCode);
+extern ZStatus_t zclCommissioning_SwitchParent(void);
 
 #endif /* COMMISSIONING_H */
@@ -8,22 +8,37 @@
 #define DEBUG_PRINT_FORMAT_BUFLEN 100
 #endif /* DEBUG_PRINT_FORMAT_BUFLEN */
 
+#if defined(DEBUG_PRINT_TOKENIZED) || defined(DEBUG_PRINT_UART) || defined(DEBUG_PRINT_MT) || defined(DEBUG_PRINT_STDIO)
+uint8 DebugLevel = DEBUG_PRINT_LEVEL;
+uint16 DebugModuleMask = DEBUG_PRINT_MODULES;
+#endif /* DEBUG_PRINT_TOKENIZED || DEBUG_PRINT_UART || DEBUG_PRINT_MT || DEBUG_PRINT_STDIO */
+
 #if defined(DEBUG_PRINT_UART) || defined(DEBUG_PRINT_MT)
 #include "hal_assert.h"
 #include "hal_defs.h"   /* st() */
 #include "OnBoard.h"    /* MicroWait() */
 
+// let the message leave before asserting, MT output can't be flushed
+#if defined(DEBUG_PRINT_UART)
+#define DEBUG_PRINT_ASSERT_WAIT()  DebugFlush()
+#else
+#define DEBUG_PRINT_ASSERT_WAIT()  MicroWait(30000)
+#endif /* DEBUG_PRINT_UART */
+
 #define DEBUG_PRINT_ASSERT()                                  \
     st (                                                      \
         static const uint8 msg[] = "!!ERROR DBGF overflow!!"; \
         DBG(msg);                                             \
-        MicroWait(30000);                                     \
+        DEBUG_PRINT_ASSERT_WAIT();                            \
         halAssertHandler();                                   \
        )
 #endif /* DEBUG_PRINT_UART || DEBUG_PRINT_MT */
 
-#if defined(DEBUG_PRINT_UART)
+#if defined(DEBUG_PRINT_UART) || defined(DEBUG_PRINT_TOKENIZED)
 #include "hal_uart.h"
+#include "hal_mcu.h"
+#include "OnBoard.h"    /* MicroWait() */
+#include "debug_token.h" /* DEBUG_TOKEN_SYNC */
 
 #ifndef DEBUG_PRINT_UART_PORT
 #define DEBUG_PRINT_UART_PORT HAL_UART_PORT_0
@@ -32,7 +47,212 @@
 #define DEBUG_PRINT_UART_BUFFLEN 128
 #endif /* DEBUG_PRINT_UART_BUFFLEN */
 
-bool DebugInit()
+// transport ring, filled by DBG/DBGF and drained by the UART
+#ifndef DEBUG_PRINT_RING_LEN
+#define DEBUG_PRINT_RING_LEN 128
+#endif /* DEBUG_PRINT_RING_LEN */
+// largest block handed to HalUARTWrite at once
+#ifndef DEBUG_PRINT_UART_CHUNK
+#define DEBUG_PRINT_UART_CHUNK 32
+#endif /* DEBUG_PRINT_UART_CHUNK */
+// upper bound for DebugFlush() busy wait
+#ifndef DEBUG_PRINT_FLUSH_TIMEOUT_US
+#define DEBUG_PRINT_FLUSH_TIMEOUT_US 50000
+#endif /* DEBUG_PRINT_FLUSH_TIMEOUT_US */
+
+#if (DEBUG_PRINT_RING_LEN) > 256 || ((DEBUG_PRINT_RING_LEN) & ((DEBUG_PRINT_RING_LEN) - 1))
+#error DEBUG_PRINT_RING_LEN should be a power of two not greater than 256
+#endif
+#if (DEBUG_PRINT_UART_CHUNK) >= (DEBUG_PRINT_UART_BUFFLEN)
+#error DEBUG_PRINT_UART_CHUNK should be less than DEBUG_PRINT_UART_BUFFLEN
+#endif
+
+#define DEBUG_RING_MASK ((DEBUG_PRINT_RING_LEN) - 1)
+#define DEBUG_RING_USED() ((uint8)(debugRingHead - debugRingTail) & DEBUG_RING_MASK)
+#define DEBUG_RING_FREE() ((uint8)(debugRingTail - debugRingHead - 1) & DEBUG_RING_MASK)
+
+#define DEBUG_UART_BYTE_US 87   // 10 bits at 115200 baud
+
+debugStats_t DebugStats = { 0, 0 };
+
+/*
+ * Single producer ring: DBG/DBGF own debugRingHead, the consumer (UART ISR
+ * or HAL driver callback) owns debugRingTail. Single byte indices keep both
+ * sides lock free on the 8051; only DEBUG_PRINT_DROP_OLDEST has to move the
+ * tail from the producer side, and does so in a short critical section.
+ */
+static uint8 debugRing[DEBUG_PRINT_RING_LEN];
+static volatile uint8 debugRingHead = 0;
+static volatile uint8 debugRingTail = 0;
+static uint8 debugRingWrite = 0;   // producer position of the record being built
+
+static void DebugRingKick(void);
+
+#if defined(DEBUG_PRINT_UART_ISR)
+/*
+ * DEBUG_PRINT_UART_ISR drives the USART directly from its TX complete
+ * interrupt and doesn't use the HAL UART driver at all, so the HAL driver
+ * must not be enabled on the same port.
+ * Port 0 is USART0 at alt. 1 location (TX on P0.3),
+ * port 1 is USART1 at alt. 2 location (TX on P1.6).
+ */
+#ifndef DEBUG_PRINT_UART_BAUD_M
+#define DEBUG_PRINT_UART_BAUD_M 216   // 115200 baud at 32 MHz
+#endif /* DEBUG_PRINT_UART_BAUD_M */
+#ifndef DEBUG_PRINT_UART_BAUD_E
+#define DEBUG_PRINT_UART_BAUD_E 11
+#endif /* DEBUG_PRINT_UART_BAUD_E */
+
+#if DEBUG_PRINT_UART_PORT == HAL_UART_PORT_0
+#define DEBUG_UxCSR           U0CSR
+#define DEBUG_UxUCR           U0UCR
+#define DEBUG_UxGCR           U0GCR
+#define DEBUG_UxBAUD          U0BAUD
+#define DEBUG_UxDBUF          U0DBUF
+#define DEBUG_UTXxIF          UTX0IF
+#define DEBUG_UTXxIE          0x04      // IEN2.UTX0IE
+#define DEBUG_UTXx_VECTOR     UTX0_VECTOR
+#define DEBUG_UART_PINS()     st( PERCFG &= ~0x01; P0SEL |= 0x08; )
+#else
+#define DEBUG_UxCSR           U1CSR
+#define DEBUG_UxUCR           U1UCR
+#define DEBUG_UxGCR           U1GCR
+#define DEBUG_UxBAUD          U1BAUD
+#define DEBUG_UxDBUF          U1DBUF
+#define DEBUG_UTXxIF          UTX1IF
+#define DEBUG_UTXxIE          0x08      // IEN2.UTX1IE
+#define DEBUG_UTXx_VECTOR     UTX1_VECTOR
+#define DEBUG_UART_PINS()     st( PERCFG |= 0x02; P1SEL |= 0x40; )
+#endif /* DEBUG_PRINT_UART_PORT */
+
+#define DEBUG_UxCSR_MODE      0x80      // UART mode
+#define DEBUG_UxCSR_ACTIVE    0x01      // transfer in progress
+#define DEBUG_UxUCR_STOP      0x02      // high stop bit
+
+static volatile bool debugTxActive = FALSE;
+
+/**************************************************************************************************
+ * @fn      DebugUartTxIsr
+ *
+ * @brief   USART TX complete interrupt, sends next byte from the ring
+ *
+ * @param   None
+ *
+ * @return  None
+ **************************************************************************************************/
+HAL_ISR_FUNCTION(DebugUartTxIsr, DEBUG_UTXx_VECTOR)
+{
+    DEBUG_UTXxIF = 0;
+    if (debugRingTail != debugRingHead)
+    {
+        DEBUG_UxDBUF = debugRing[debugRingTail];
+        debugRingTail = (debugRingTail + 1) & DEBUG_RING_MASK;
+    }
+    else
+    {
+        debugTxActive = FALSE;
+    }
+}
+
+/**************************************************************************************************
+ * @fn      DebugRingKick
+ *
+ * @brief   Start transmission if the UART is idle
+ *
+ * @param   None
+ *
+ * @return  None
+ **************************************************************************************************/
+static void DebugRingKick(void)
+{
+    // the ISR runs atomically against us, so head is published before we look at the flag
+    if (!debugTxActive)
+    {
+        debugTxActive = TRUE;
+        DEBUG_UTXxIF = 1;   // software triggered interrupt sends the first byte
+    }
+}
+
+static bool DebugUartOpen(void)
+{
+    DEBUG_UART_PINS();
+    DEBUG_UxCSR = DEBUG_UxCSR_MODE;
+    DEBUG_UxUCR = DEBUG_UxUCR_STOP;
+    DEBUG_UxGCR = DEBUG_PRINT_UART_BAUD_E;
+    DEBUG_UxBAUD = DEBUG_PRINT_UART_BAUD_M;
+    DEBUG_UTXxIF = 0;
+    IEN2 |= DEBUG_UTXxIE;
+    return true;
+}
+
+/**************************************************************************************************
+ * @fn      DebugFlush
+ *
+ * @brief   Wait until buffered output has left the UART, call before entering sleep
+ *
+ * @param   None
+ *
+ * @return  None
+ **************************************************************************************************/
+void DebugFlush(void)
+{
+    uint16 timeout = (DEBUG_PRINT_FLUSH_TIMEOUT_US) / DEBUG_UART_BYTE_US;
+
+    while ((debugTxActive || (DEBUG_UxCSR & DEBUG_UxCSR_ACTIVE)) && timeout--)
+        MicroWait(DEBUG_UART_BYTE_US);
+}
+
+#else /* DEBUG_PRINT_UART_ISR */
+
+static uint16 debugHalPending = 0;   // bytes handed to the HAL driver since it last reported empty
+
+/**************************************************************************************************
+ * @fn      DebugRingKick
+ *
+ * @brief   Move buffered output to the HAL UART driver as long as it accepts it
+ *
+ * @param   None
+ *
+ * @return  None
+ **************************************************************************************************/
+static void DebugRingKick(void)
+{
+    while (debugRingTail != debugRingHead)
+    {
+        uint16 len = (debugRingHead > debugRingTail) ?
+                     (debugRingHead - debugRingTail) : (DEBUG_PRINT_RING_LEN - debugRingTail);
+        if (len > DEBUG_PRINT_UART_CHUNK)
+            len = DEBUG_PRINT_UART_CHUNK;
+        len = HalUARTWrite(DEBUG_PRINT_UART_PORT, &debugRing[debugRingTail], len);
+        if (len == 0)
+            break;
+        debugHalPending += len;
+        debugRingTail = (debugRingTail + len) & DEBUG_RING_MASK;
+    }
+}
+
+/**************************************************************************************************
+ * @fn      DebugUartCB
+ *
+ * @brief   UART driver callback, refills the driver once its tx buffer is empty
+ *
+ * @param   port - UART port
+ * @param   event - UART events
+ *
+ * @return  None
+ **************************************************************************************************/
+static void DebugUartCB(uint8 port, uint8 event)
+{
+    (void)port;
+
+    if (event & HAL_UART_TX_EMPTY)
+    {
+        debugHalPending = 0;
+        DebugRingKick();
+    }
+}
+
+static bool DebugUartOpen(void)
 {
     halUARTCfg_t halUARTConfig;
     halUARTConfig.configured = TRUE;
@@ -44,9 +264,224 @@ bool DebugInit()
     halUARTConfig.rx.maxBufSize = 0;
     halUARTConfig.tx.maxBufSize = DEBUG_PRINT_UART_BUFFLEN;
     halUARTConfig.intEnable = TRUE;
-    halUARTConfig.callBackFunc = NULL;
+    halUARTConfig.callBackFunc = DebugUartCB;
     HalUARTInit();
-    if (HalUARTOpen(DEBUG_PRINT_UART_PORT, &halUARTConfig) == HAL_UART_SUCCESS)
+    return (HalUARTOpen(DEBUG_PRINT_UART_PORT, &halUARTConfig) == HAL_UART_SUCCESS);
+}
+
+/**************************************************************************************************
+ * @fn      DebugFlush
+ *
+ * @brief   Wait until buffered output has left the UART, call before entering sleep
+ *
+ * @param   None
+ *
+ * @return  None
+ **************************************************************************************************/
+void DebugFlush(void)
+{
+    uint16 timeout = (DEBUG_PRINT_FLUSH_TIMEOUT_US) / DEBUG_UART_BYTE_US;
+
+    // the HAL driver callback isn't polled while we spin, so keep feeding it here
+    while (debugRingTail != debugRingHead && timeout--)
+    {
+        DebugRingKick();
+        MicroWait(DEBUG_UART_BYTE_US);
+    }
+    while (debugHalPending && timeout--)
+    {
+        debugHalPending--;
+        MicroWait(DEBUG_UART_BYTE_US);
+    }
+}
+
+#endif /* !DEBUG_PRINT_UART_ISR */
+
+/**************************************************************************************************
+ * @fn      DebugRingReserve
+ *
+ * @brief   Make room for a record of given length according to the drop policy
+ *
+ * @param   len - record length
+ *
+ * @return  true if the record may be written, false if it was dropped
+ **************************************************************************************************/
+static bool DebugRingReserve(uint8 len)
+{
+    uint8 room = DEBUG_RING_FREE();
+
+    debugRingWrite = debugRingHead;
+    if (room >= len)
+        return true;
+
+#if defined(DEBUG_PRINT_DROP_OLDEST)
+    if (len <= DEBUG_RING_MASK)
+    {
+        halIntState_t intState;
+        HAL_ENTER_CRITICAL_SECTION(intState);
+        room = DEBUG_RING_FREE();
+        if (room < len)
+        {
+            DebugStats.dropped += len - room;
+            debugRingTail = (debugRingTail + (len - room)) & DEBUG_RING_MASK;
+        }
+        HAL_EXIT_CRITICAL_SECTION(intState);
+        return true;
+    }
+#endif /* DEBUG_PRINT_DROP_OLDEST */
+
+    DebugStats.dropped += len;
+    return false;
+}
+
+#define DEBUG_RING_PUT(b)                                       \
+    st (                                                        \
+        debugRing[debugRingWrite] = (b);                        \
+        debugRingWrite = (debugRingWrite + 1) & DEBUG_RING_MASK; \
+       )
+
+/**************************************************************************************************
+ * @fn      DebugRingCommit
+ *
+ * @brief   Publish the record written after DebugRingReserve and start transmission
+ *
+ * @param   None
+ *
+ * @return  None
+ **************************************************************************************************/
+static void DebugRingCommit(void)
+{
+    debugRingHead = debugRingWrite;
+    if (DEBUG_RING_USED() > DebugStats.highWater)
+        DebugStats.highWater = DEBUG_RING_USED();
+    DebugRingKick();
+}
+
+/**************************************************************************************************
+ * @fn      DebugRecord
+ *
+ * @brief   Buffer binary record framed as a tokenized one, e.g. trace
+ *          events. Nothing is dropped to make room for it.
+ *
+ * @param   token - record token
+ * @param   payload - record payload
+ * @param   len - payload length
+ *
+ * @return  true if buffered, false if the ring has no room for it
+ **************************************************************************************************/
+bool DebugRecord(uint16 token, const uint8 *payload, uint8 len)
+{
+    if (DEBUG_RING_FREE() < len + 4)
+        return false;
+
+    debugRingWrite = debugRingHead;
+    DEBUG_RING_PUT(DEBUG_TOKEN_SYNC);
+    DEBUG_RING_PUT(len);
+    DEBUG_RING_PUT(LO_UINT16(token));
+    DEBUG_RING_PUT(HI_UINT16(token));
+    while (len--)
+        DEBUG_RING_PUT(*payload++);
+    DebugRingCommit();
+    return true;
+}
+#endif /* DEBUG_PRINT_UART || DEBUG_PRINT_TOKENIZED */
+
+#if defined(DEBUG_PRINT_TOKENIZED)
+
+bool DebugInit()
+{
+    if (DebugUartOpen())
+    {
+        DBG("Initialized tokenized debug\r\n");
+        return true;
+    }
+    return false;
+}
+
+/**************************************************************************************************
+ * @fn      DebugTokenized
+ *
+ * @brief   Buffer tokenized record, invoked by DBG and DBGF
+ *
+ * @param   token - format string token
+ * @param   desc - argument descriptor (see debug_token.h)
+ * @param   ... - arguments
+ *
+ * @return  None
+ **************************************************************************************************/
+void DebugTokenized(uint16 token, uint16 desc, ...)
+{
+    uint8 argc = DEBUG_TOKEN_ARGC(desc);
+    uint8 size = 0;
+    uint8 i;
+
+    for (i = 0; i < argc; i++)
+        size += DEBUG_TOKEN_ARG_LONG(desc, i) ? sizeof(long) : sizeof(int);
+
+    // record that doesn't fit is dropped as a whole to keep the stream parseable
+    if (!DebugRingReserve(size + 4))
+        return;
+
+    DEBUG_RING_PUT(DEBUG_TOKEN_SYNC);
+    DEBUG_RING_PUT(size);
+    DEBUG_RING_PUT(LO_UINT16(token));
+    DEBUG_RING_PUT(HI_UINT16(token));
+
+    va_list argp;
+    va_start(argp, desc);
+    for (i = 0; i < argc; i++)
+    {
+        uint32 value;
+        if (DEBUG_TOKEN_ARG_LONG(desc, i))
+        {
+            value = va_arg(argp, unsigned long);
+            size = sizeof(long);
+        }
+        else
+        {
+            value = va_arg(argp, unsigned int);
+            size = sizeof(int);
+        }
+        while (size--)
+        {
+            DEBUG_RING_PUT((uint8)value);
+            value >>= 8;
+        }
+    }
+    va_end(argp);
+
+    DebugRingCommit();
+}
+
+#elif defined(DEBUG_PRINT_UART)
+
+/**************************************************************************************************
+ * @fn      DebugRingWriteBuf
+ *
+ * @brief   Queue text for transmission
+ *
+ * @param   data - text
+ * @param   len - text length
+ *
+ * @return  None
+ **************************************************************************************************/
+static void DebugRingWriteBuf(const uint8 *data, uint16 len)
+{
+    if (len > DEBUG_RING_MASK)
+    {
+        DebugStats.dropped += len;
+        return;
+    }
+    if (!DebugRingReserve((uint8)len))
+        return;
+    while (len--)
+        DEBUG_RING_PUT(*data++);
+    DebugRingCommit();
+}
+
+bool DebugInit()
+{
+    if (DebugUartOpen())
     {
         DBG("Initialized UART debug\r\n");
         return true;
@@ -59,7 +494,7 @@ void DBG(const uint8 *data)
     if (data == NULL)
         return;
 
-    HalUARTWrite(DEBUG_PRINT_UART_PORT, (uint8*)data, strlen((const char *)data));
+    DebugRingWriteBuf(data, strlen((const char *)data));
 }
 
 void DBGF(const char *format, ...)
@@ -73,7 +508,7 @@ void DBGF(const char *format, ...)
     if (cnt >= DEBUG_PRINT_FORMAT_BUFLEN)
         DEBUG_PRINT_ASSERT();
     else if (cnt > 0)
-        HalUARTWrite(DEBUG_PRINT_UART_PORT, str, cnt);
+        DebugRingWriteBuf(str, cnt);
     va_end(argp);
 }
 
@@ -114,16 +549,19 @@ bool DebugInit()
     return true;
 }
 
-void DBG(uint8 *data)
+void DBG(const uint8 *data)
 {
-    printf((const char*)data);
+    if (data == NULL)
+        return;
+
+    fputs((const char *)data, stdout);
 }
 
-void DBGF(char *format, ...)
+void DBGF(const char *format, ...)
 {
     va_list argp;
     va_start(argp, format);
-    printf(format, argp);
+    vprintf(format, argp);
     va_end(argp);
 }
 
@@ -2,6 +2,7 @@
 #define DEBUG_PRINT_H
 
 #include "hal_types.h"
+#include "hal_defs.h"   /* st() */
 
 #define BYTE_TO_BINARY_PATTERN "%c%c%c%c%c%c%c%c"
 #define BYTE_TO_BINARY(byte)  \
@@ -14,14 +15,127 @@
   (byte & 0x02 ? '1' : '0'), \
   (byte & 0x01 ? '1' : '0')
 
-#if defined(DEBUG_PRINT_UART) || defined(DEBUG_PRINT_MT) || defined(DEBUG_PRINT_STDIO)
+#if defined(DEBUG_PRINT_UART) || defined(DEBUG_PRINT_TOKENIZED)
+/*
+ * UART output goes through a ring buffer drained by the UART driver
+ * (DEBUG_PRINT_UART_ISR selects the library's own TX interrupt instead of
+ * the HAL driver), so DBG/DBGF never wait for the line. When the ring is
+ * full the new text is dropped, or the oldest if DEBUG_PRINT_DROP_OLDEST
+ * is defined.
+ *
+ * DebugFlush() should be called before the MCU enters sleep, e.g.
+ * #define OSAL_SET_CPU_INTO_SLEEP(timeout) st( DebugFlush(); halSleep(timeout); )
+ */
+typedef struct
+{
+  uint32 dropped;   // bytes lost due to ring overflow
+  uint8 highWater;  // ring usage high-water mark in bytes
+} debugStats_t;
+
+extern debugStats_t DebugStats;
+extern void DebugFlush(void);
+extern bool DebugRecord(uint16 token, const uint8 *payload, uint8 len);
+#else /* DEBUG_PRINT_UART || DEBUG_PRINT_TOKENIZED */
+#define DebugFlush()
+#endif /* !(DEBUG_PRINT_UART || DEBUG_PRINT_TOKENIZED) */
+
+#if defined(DEBUG_PRINT_TOKENIZED)
+#include "debug_token.h"
+
+extern bool DebugInit(void);
+#define DBG(s) DEBUG_TOKEN_PRINTF(s)
+#define DBGF(...) DEBUG_TOKEN_PRINTF(__VA_ARGS__)
+#elif defined(DEBUG_PRINT_UART) || defined(DEBUG_PRINT_MT) || defined(DEBUG_PRINT_STDIO)
 extern bool DebugInit(void);
 extern void DBG(const uint8 *data);
 extern void DBGF(const char *format, ...);
-#else /* DEBUG_PRINT_UART || DEBUG_PRINT_MT || DEBUG_PRINT_STDIO */
+#else /* DEBUG_PRINT_TOKENIZED || DEBUG_PRINT_UART || DEBUG_PRINT_MT || DEBUG_PRINT_STDIO */
 #define DebugInit()
 #define DBG(s)
 #define DBGF(f, ...)
 #endif /* !DEBUG_PRINT */
 
+/*
+ * Leveled output tagged with a module: DBG_INFO(DEBUG_MODULE_BATTERY, format, ...).
+ * Levels above DEBUG_PRINT_LEVEL compile to nothing. The rest is checked
+ * against DebugLevel and the module bit of DebugModuleMask before any
+ * formatting, both can be changed at run time. DEBUG_PRINT_ATTRS expands
+ * to writable Diagnostics cluster custom attributes backed by them, to be
+ * put into the application attribute list, and to nothing without a debug
+ * backend.
+ */
+#define ATTRID_DIAGNOSTIC_DEBUG_LEVEL                      0x0210
+#define ATTRID_DIAGNOSTIC_DEBUG_MODULE_MASK                0x0211
+
+#define DEBUG_LEVEL_NONE             0
+#define DEBUG_LEVEL_ERROR            1
+#define DEBUG_LEVEL_WARN             2
+#define DEBUG_LEVEL_INFO             3
+#define DEBUG_LEVEL_TRACE            4
+
+#ifndef DEBUG_PRINT_LEVEL
+#define DEBUG_PRINT_LEVEL            DEBUG_LEVEL_TRACE
+#endif /* DEBUG_PRINT_LEVEL */
+
+// DebugModuleMask default, bit per DEBUG_MODULE_*
+#ifndef DEBUG_PRINT_MODULES
+#define DEBUG_PRINT_MODULES          0xFFFF
+#endif /* DEBUG_PRINT_MODULES */
+
+#define DEBUG_MODULE_APP             0
+#define DEBUG_MODULE_BATTERY         1
+#define DEBUG_MODULE_ALARM           2
+#define DEBUG_MODULE_COMMISSIONING   3
+#define DEBUG_MODULE_FACTORY_RESET   4
+#define DEBUG_MODULE_REPORTING       5
+#define DEBUG_MODULE_POLL_CONTROL    6
+#define DEBUG_MODULE_LINK_MONITOR    7
+#define DEBUG_MODULE_TX_POWER        8
+#define DEBUG_MODULE_NV_RECORD       9
+#define DEBUG_MODULE_TIMER           10
+#define DEBUG_MODULE_ENERGY          11
+#define DEBUG_MODULE_USER            12  // 12..15 are free for the application
+
+#if defined(DEBUG_PRINT_TOKENIZED) || defined(DEBUG_PRINT_UART) || defined(DEBUG_PRINT_MT) || defined(DEBUG_PRINT_STDIO)
+extern uint8 DebugLevel;
+extern uint16 DebugModuleMask;
+
+#define DEBUG_LOG(level, module, ...)                                                     \
+  st( if ((level) <= DebugLevel && (DebugModuleMask & ((uint16)1 << (module)))) {        \
+        DBGF(__VA_ARGS__);                                                                \
+      } )
+
+#define DEBUG_PRINT_ATTRS                                                                 \
+  { ZCL_CLUSTER_ID_HA_DIAGNOSTIC,                                                         \
+    { ATTRID_DIAGNOSTIC_DEBUG_LEVEL, ZCL_DATATYPE_UINT8,                                  \
+      ACCESS_CONTROL_READ | ACCESS_CONTROL_WRITE, (void *)&DebugLevel } },                \
+  { ZCL_CLUSTER_ID_HA_DIAGNOSTIC,                                                         \
+    { ATTRID_DIAGNOSTIC_DEBUG_MODULE_MASK, ZCL_DATATYPE_BITMAP16,                         \
+      ACCESS_CONTROL_READ | ACCESS_CONTROL_WRITE, (void *)&DebugModuleMask } },
+#else
+#define DEBUG_LOG(level, module, ...)
+#define DEBUG_PRINT_ATTRS
+#endif /* DEBUG_PRINT_TOKENIZED || DEBUG_PRINT_UART || DEBUG_PRINT_MT || DEBUG_PRINT_STDIO */
+
+#if DEBUG_PRINT_LEVEL >= DEBUG_LEVEL_ERROR
+#define DBG_ERROR(module, ...)  DEBUG_LOG(DEBUG_LEVEL_ERROR, module, __VA_ARGS__)
+#else
+#define DBG_ERROR(module, ...)
+#endif
+#if DEBUG_PRINT_LEVEL >= DEBUG_LEVEL_WARN
+#define DBG_WARN(module, ...)   DEBUG_LOG(DEBUG_LEVEL_WARN, module, __VA_ARGS__)
+#else
+#define DBG_WARN(module, ...)
+#endif
+#if DEBUG_PRINT_LEVEL >= DEBUG_LEVEL_INFO
+#define DBG_INFO(module, ...)   DEBUG_LOG(DEBUG_LEVEL_INFO, module, __VA_ARGS__)
+#else
+#define DBG_INFO(module, ...)
+#endif
+#if DEBUG_PRINT_LEVEL >= DEBUG_LEVEL_TRACE
+#define DBG_TRACE(module, ...)  DEBUG_LOG(DEBUG_LEVEL_TRACE, module, __VA_ARGS__)
+#else
+#define DBG_TRACE(module, ...)
+#endif
+
 #endif /* DEBUG_PRINT_H */
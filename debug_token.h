@@ -0,0 +1,111 @@
+#ifndef DEBUG_TOKEN_H
+#define DEBUG_TOKEN_H
+
+/*
+ * Tokenized debug output helpers.
+ *
+ * Format strings are hashed by the compiler into 16 bit tokens, so only
+ * the token and raw argument bytes reach the wire. The literal itself is
+ * never referenced at run time and is dropped from the image.
+ * tools/detokenize.py implements the same hash over the sources to turn
+ * a captured stream back into text.
+ *
+ * Record layout (little endian):
+ *   DEBUG_TOKEN_SYNC, payload length, token LSB, token MSB, payload
+ * Every argument is stored as it was passed through "...": int-sized or
+ * smaller values take sizeof(int) bytes, long values take sizeof(long).
+ */
+
+#define DEBUG_TOKEN_SYNC      0xA5
+
+// number of leading characters of the format string taken into the hash
+#define DEBUG_TOKEN_HASH_LEN  64
+#define DEBUG_TOKEN_HASH_K    65599u
+
+#define DEBUG_TOKEN_MAX_ARGS  12
+
+/*********************************************************************
+ * @fn          DEBUG_TOKEN
+ *
+ * @brief       evaluates to the 16 bit token of a string literal
+ *
+ * @param       s - string literal
+ */
+#define DEBUG_TOKEN(s) \
+  ((uint16)(DEBUG_TOKEN32(s) ^ (DEBUG_TOKEN32(s) >> 16)))
+
+#define DEBUG_TOKEN32(s) DEBUG_TOKEN_H64(s, (uint32)(sizeof(s) - 1))
+
+#define DEBUG_TOKEN_C(s, i) \
+  ((i) < sizeof(s) - 1 ? (uint32)(uint8)(s)[(i) < sizeof(s) ? (i) : 0] : (uint32)0)
+#define DEBUG_TOKEN_H1(s, i, h) \
+  ((uint32)(h) * DEBUG_TOKEN_HASH_K + DEBUG_TOKEN_C(s, i))
+#define DEBUG_TOKEN_H4(s, i, h) \
+  DEBUG_TOKEN_H1(s, (i) + 3, DEBUG_TOKEN_H1(s, (i) + 2, DEBUG_TOKEN_H1(s, (i) + 1, DEBUG_TOKEN_H1(s, i, h))))
+#define DEBUG_TOKEN_H16(s, i, h) \
+  DEBUG_TOKEN_H4(s, (i) + 12, DEBUG_TOKEN_H4(s, (i) + 8, DEBUG_TOKEN_H4(s, (i) + 4, DEBUG_TOKEN_H4(s, i, h))))
+#define DEBUG_TOKEN_H64(s, h) \
+  DEBUG_TOKEN_H16(s, 48, DEBUG_TOKEN_H16(s, 32, DEBUG_TOKEN_H16(s, 16, DEBUG_TOKEN_H16(s, 0, h))))
+
+/*
+ * Argument descriptor passed along with the token:
+ *   bits 0..3  - number of arguments
+ *   bit  4 + n - argument n is long sized
+ */
+#define DEBUG_TOKEN_ARGC(desc)       ((desc) & 0x0F)
+#define DEBUG_TOKEN_ARG_LONG(desc, n) ((desc) & (0x10 << (n)))
+
+#define DEBUG_TOKEN_SZ(a) ((uint16)(sizeof(a) > sizeof(int)))
+
+#define DEBUG_TOKEN_D1(a)        DEBUG_TOKEN_SZ(a)
+#define DEBUG_TOKEN_D2(a, ...)   (DEBUG_TOKEN_SZ(a) | (DEBUG_TOKEN_D1(__VA_ARGS__) << 1))
+#define DEBUG_TOKEN_D3(a, ...)   (DEBUG_TOKEN_SZ(a) | (DEBUG_TOKEN_D2(__VA_ARGS__) << 1))
+#define DEBUG_TOKEN_D4(a, ...)   (DEBUG_TOKEN_SZ(a) | (DEBUG_TOKEN_D3(__VA_ARGS__) << 1))
+#define DEBUG_TOKEN_D5(a, ...)   (DEBUG_TOKEN_SZ(a) | (DEBUG_TOKEN_D4(__VA_ARGS__) << 1))
+#define DEBUG_TOKEN_D6(a, ...)   (DEBUG_TOKEN_SZ(a) | (DEBUG_TOKEN_D5(__VA_ARGS__) << 1))
+#define DEBUG_TOKEN_D7(a, ...)   (DEBUG_TOKEN_SZ(a) | (DEBUG_TOKEN_D6(__VA_ARGS__) << 1))
+#define DEBUG_TOKEN_D8(a, ...)   (DEBUG_TOKEN_SZ(a) | (DEBUG_TOKEN_D7(__VA_ARGS__) << 1))
+#define DEBUG_TOKEN_D9(a, ...)   (DEBUG_TOKEN_SZ(a) | (DEBUG_TOKEN_D8(__VA_ARGS__) << 1))
+#define DEBUG_TOKEN_D10(a, ...)  (DEBUG_TOKEN_SZ(a) | (DEBUG_TOKEN_D9(__VA_ARGS__) << 1))
+#define DEBUG_TOKEN_D11(a, ...)  (DEBUG_TOKEN_SZ(a) | (DEBUG_TOKEN_D10(__VA_ARGS__) << 1))
+#define DEBUG_TOKEN_D12(a, ...)  (DEBUG_TOKEN_SZ(a) | (DEBUG_TOKEN_D11(__VA_ARGS__) << 1))
+
+#define DEBUG_TOKEN_CAT(a, b)  DEBUG_TOKEN_CAT_(a, b)
+#define DEBUG_TOKEN_CAT_(a, b) a##b
+
+// number of arguments following the format string, format alone gives 0
+#define DEBUG_TOKEN_NARGS(...) \
+  DEBUG_TOKEN_NARGS_(__VA_ARGS__, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0, ~)
+#define DEBUG_TOKEN_NARGS_(f, a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, n, ...) n
+
+#define DEBUG_TOKEN_CALL_0(f) \
+  DebugTokenized(DEBUG_TOKEN(f), 0)
+#define DEBUG_TOKEN_CALL_N(n, f, ...) \
+  DebugTokenized(DEBUG_TOKEN(f), (n) | (DEBUG_TOKEN_CAT(DEBUG_TOKEN_D, n)(__VA_ARGS__) << 4), __VA_ARGS__)
+#define DEBUG_TOKEN_CALL_1(f, ...)  DEBUG_TOKEN_CALL_N(1, f, __VA_ARGS__)
+#define DEBUG_TOKEN_CALL_2(f, ...)  DEBUG_TOKEN_CALL_N(2, f, __VA_ARGS__)
+#define DEBUG_TOKEN_CALL_3(f, ...)  DEBUG_TOKEN_CALL_N(3, f, __VA_ARGS__)
+#define DEBUG_TOKEN_CALL_4(f, ...)  DEBUG_TOKEN_CALL_N(4, f, __VA_ARGS__)
+#define DEBUG_TOKEN_CALL_5(f, ...)  DEBUG_TOKEN_CALL_N(5, f, __VA_ARGS__)
+#define DEBUG_TOKEN_CALL_6(f, ...)  DEBUG_TOKEN_CALL_N(6, f, __VA_ARGS__)
+#define DEBUG_TOKEN_CALL_7(f, ...)  DEBUG_TOKEN_CALL_N(7, f, __VA_ARGS__)
+#define DEBUG_TOKEN_CALL_8(f, ...)  DEBUG_TOKEN_CALL_N(8, f, __VA_ARGS__)
+#define DEBUG_TOKEN_CALL_9(f, ...)  DEBUG_TOKEN_CALL_N(9, f, __VA_ARGS__)
+#define DEBUG_TOKEN_CALL_10(f, ...) DEBUG_TOKEN_CALL_N(10, f, __VA_ARGS__)
+#define DEBUG_TOKEN_CALL_11(f, ...) DEBUG_TOKEN_CALL_N(11, f, __VA_ARGS__)
+#define DEBUG_TOKEN_CALL_12(f, ...) DEBUG_TOKEN_CALL_N(12, f, __VA_ARGS__)
+
+/*********************************************************************
+ * @fn          DEBUG_TOKEN_PRINTF
+ *
+ * @brief       emits tokenized record for the format string and arguments
+ *
+ * @param       ... - string literal format followed by up to
+ *                    DEBUG_TOKEN_MAX_ARGS integer arguments
+ */
+#define DEBUG_TOKEN_PRINTF(...) \
+  DEBUG_TOKEN_CAT(DEBUG_TOKEN_CALL_, DEBUG_TOKEN_NARGS(__VA_ARGS__))(__VA_ARGS__)
+
+extern void DebugTokenized(uint16 token, uint16 desc, ...);
+
+#endif /* DEBUG_TOKEN_H */
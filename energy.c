@@ -0,0 +1,269 @@
+#if defined(ENERGY_ACCOUNTING)
+#include "OSAL.h"
+#include "ZDApp.h"
+#include "hal_led.h"
+#include "debug_print.h"
+
+#include "energy.h"
+
+/*
+ * HAL_LED_MODE_BLINK and HAL_LED_MODE_FLASH on-time estimates,
+ * keep in sync with the HAL defaults the application is built with
+ */
+#define ENERGY_LED_BLINK_MS \
+    ((uint32)(HAL_LED_DEFAULT_FLASH_TIME) * (HAL_LED_DEFAULT_DUTY_CYCLE) / 100)
+#define ENERGY_LED_FLASH_MS \
+    ((uint32)(HAL_LED_DEFAULT_FLASH_COUNT) * ENERGY_LED_BLINK_MS)
+
+energyAttr_t zclEnergy = { sizeof(energyAttr_t) - 1 };
+
+static uint8 energyPollSetting = ENERGY_POLL_NORMAL;
+static uint32 energyPollSince = 0;
+static uint32 energyLedSince[ENERGY_MODULE_COUNT];
+static uint8 energyLedOn = 0;   // bitmask of modules holding a LED on
+
+static uint8 zclEnergy_PollSetting(uint32 rate);
+static void zclEnergy_LedAccount(uint8 module, uint32 now);
+
+/**************************************************************************************************
+ * @fn      zclEnergy_Wake
+ *
+ * @brief   Account module wakeup
+ *
+ * @param   module - ENERGY_MODULE_*
+ *
+ * @return  None
+ **************************************************************************************************/
+void zclEnergy_Wake(uint8 module)
+{
+    zclEnergy.module[module].wakes++;
+}
+
+/**************************************************************************************************
+ * @fn      zclEnergy_Adc
+ *
+ * @brief   Account ADC conversion sequence
+ *
+ * @param   module - ENERGY_MODULE_*
+ * @param   conversions - number of conversions done
+ * @param   ticks - sleep timer ticks spent converting
+ *
+ * @return  None
+ **************************************************************************************************/
+void zclEnergy_Adc(uint8 module, uint8 conversions, uint32 ticks)
+{
+    zclEnergy.module[module].adcConversions += conversions;
+    zclEnergy.module[module].adcTicks += ticks;
+}
+
+/**************************************************************************************************
+ * @fn      zclEnergy_Report
+ *
+ * @brief   Account reported attribute to the module that queued it
+ *
+ * @param   module - ENERGY_MODULE_*
+ * @param   attr - attribute record of the report frame
+ * @param   frame - first attribute of the module in the frame
+ *
+ * @return  None
+ **************************************************************************************************/
+void zclEnergy_Report(uint8 module, const zclReport_t *attr, bool frame)
+{
+    if (frame)
+    {
+        zclEnergy.module[module].reports++;
+    }
+    // attribute ID, data type and value
+    zclEnergy.module[module].reportBytes += 3 + zclGetAttrDataLength(attr->dataType, attr->attrData);
+}
+
+/**************************************************************************************************
+ * @fn      zclEnergy_SetPollRate
+ *
+ * @brief   NLME_SetPollRate wrapper accounting time spent at each poll setting
+ *
+ * @param   module - ENERGY_MODULE_*
+ * @param   rate - poll rate in milliseconds, 0 disables polling
+ *
+ * @return  None
+ **************************************************************************************************/
+void zclEnergy_SetPollRate(uint8 module, uint32 rate)
+{
+    zclEnergy_Update();
+    energyPollSetting = zclEnergy_PollSetting(rate);
+    zclEnergy.module[module].pollChanges++;
+    NLME_SetPollRate(rate);
+}
+
+/**************************************************************************************************
+ * @fn      zclEnergy_LedSet
+ *
+ * @brief   HalLedSet wrapper accounting LED on time
+ *
+ * @param   module - ENERGY_MODULE_*
+ * @param   leds - LEDs bitmask
+ * @param   mode - HAL_LED_MODE_*
+ *
+ * @return  None
+ **************************************************************************************************/
+void zclEnergy_LedSet(uint8 module, uint8 leds, uint8 mode)
+{
+    uint32 now = osal_GetSystemClock();
+    bool on = energyLedOn & BV(module);
+
+    switch (mode)
+    {
+    case HAL_LED_MODE_ON:
+        if (!on)
+        {
+            energyLedSince[module] = now;
+            energyLedOn |= BV(module);
+        }
+        break;
+    case HAL_LED_MODE_TOGGLE:
+        if (on)
+        {
+            zclEnergy_LedAccount(module, now);
+        }
+        else
+        {
+            energyLedSince[module] = now;
+            energyLedOn |= BV(module);
+        }
+        break;
+    case HAL_LED_MODE_BLINK:
+        zclEnergy_LedAccount(module, now);
+        zclEnergy.module[module].ledOnMs += ENERGY_LED_BLINK_MS;
+        break;
+    case HAL_LED_MODE_FLASH:
+        zclEnergy_LedAccount(module, now);
+        zclEnergy.module[module].ledOnMs += ENERGY_LED_FLASH_MS;
+        break;
+    default:
+        zclEnergy_LedAccount(module, now);
+        break;
+    }
+    HalLedSet(leds, mode);
+}
+
+/**************************************************************************************************
+ * @fn      zclEnergy_LedBlink
+ *
+ * @brief   HalLedBlink wrapper accounting LED on time
+ *
+ * @param   module - ENERGY_MODULE_*
+ * @param   leds - LEDs bitmask
+ * @param   numBlinks - number of blinks, 0 blinks until stopped
+ * @param   percent - on time percentage of the period
+ * @param   period - blink period in milliseconds
+ *
+ * @return  None
+ **************************************************************************************************/
+void zclEnergy_LedBlink(uint8 module, uint8 leds, uint8 numBlinks, uint8 percent, uint16 period)
+{
+    zclEnergy_LedAccount(module, osal_GetSystemClock());
+    // endless blinking is accounted as steady on until turned off
+    if (numBlinks == 0)
+    {
+        energyLedSince[module] = osal_GetSystemClock();
+        energyLedOn |= BV(module);
+    }
+    else
+    {
+        zclEnergy.module[module].ledOnMs += (uint32)numBlinks * period * percent / 100;
+    }
+    HalLedBlink(leds, numBlinks, percent, period);
+}
+
+/**************************************************************************************************
+ * @fn      zclEnergy_Update
+ *
+ * @brief   Bring time based counters up to date, call before reading them
+ *
+ * @param   None
+ *
+ * @return  None
+ **************************************************************************************************/
+void zclEnergy_Update(void)
+{
+    uint32 now = osal_GetSystemClock();
+
+    zclEnergy.pollMs[energyPollSetting] += now - energyPollSince;
+    energyPollSince = now;
+
+    for (uint8 module = 0; module < ENERGY_MODULE_COUNT; module++)
+    {
+        if (energyLedOn & BV(module))
+        {
+            zclEnergy_LedAccount(module, now);
+            energyLedSince[module] = now;
+            energyLedOn |= BV(module);
+        }
+    }
+}
+
+/**************************************************************************************************
+ * @fn      zclEnergy_Dump
+ *
+ * @brief   Print counters
+ *
+ * @param   None
+ *
+ * @return  None
+ **************************************************************************************************/
+void zclEnergy_Dump(void)
+{
+    zclEnergy_Update();
+    for (uint8 module = 0; module < ENERGY_MODULE_COUNT; module++)
+    {
+        // no local pointer, it would be unused without a debug backend
+        DBG_INFO(DEBUG_MODULE_ENERGY, "ENERGY %d: wk %u adc %u/%lu rep %u/%lu poll %u led %lu\r\n",
+                 module, zclEnergy.module[module].wakes, zclEnergy.module[module].adcConversions,
+                 zclEnergy.module[module].adcTicks, zclEnergy.module[module].reports,
+                 zclEnergy.module[module].reportBytes, zclEnergy.module[module].pollChanges,
+                 zclEnergy.module[module].ledOnMs);
+    }
+    DBG_INFO(DEBUG_MODULE_ENERGY, "ENERGY poll: off %lu fast %lu norm %lu slow %lu\r\n",
+             zclEnergy.pollMs[ENERGY_POLL_OFF], zclEnergy.pollMs[ENERGY_POLL_FAST],
+             zclEnergy.pollMs[ENERGY_POLL_NORMAL], zclEnergy.pollMs[ENERGY_POLL_SLOW]);
+}
+
+/**************************************************************************************************
+ * @fn      zclEnergy_PollSetting
+ *
+ * @brief   Map poll rate to accounting bucket
+ *
+ * @param   rate - poll rate in milliseconds
+ *
+ * @return  ENERGY_POLL_*
+ **************************************************************************************************/
+static uint8 zclEnergy_PollSetting(uint32 rate)
+{
+    if (rate == 0)
+        return ENERGY_POLL_OFF;
+    if (rate <= ENERGY_POLL_FAST_MS)
+        return ENERGY_POLL_FAST;
+    if (rate <= POLL_RATE)
+        return ENERGY_POLL_NORMAL;
+    return ENERGY_POLL_SLOW;
+}
+
+/**************************************************************************************************
+ * @fn      zclEnergy_LedAccount
+ *
+ * @brief   Close steady LED on interval of the module
+ *
+ * @param   module - ENERGY_MODULE_*
+ * @param   now - current system clock
+ *
+ * @return  None
+ **************************************************************************************************/
+static void zclEnergy_LedAccount(uint8 module, uint32 now)
+{
+    if (energyLedOn & BV(module))
+    {
+        zclEnergy.module[module].ledOnMs += now - energyLedSince[module];
+        energyLedOn &= ~BV(module);
+    }
+}
+#endif /* ENERGY_ACCOUNTING */
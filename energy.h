@@ -0,0 +1,85 @@
+#ifndef ENERGY_H
+#define ENERGY_H
+
+#include "hal_defs.h"
+#include "zcl.h"
+
+/*
+ * Energy accounting counters, enabled with ENERGY_ACCOUNTING.
+ * Without it every ENERGY_* macro compiles to nothing, or to the plain
+ * stack call it wraps.
+ */
+
+// Custom attributes
+#define ATTRID_POWER_CFG_ENERGY_COUNTERS                   0x0211
+
+#define ENERGY_MODULE_BATTERY        0
+#define ENERGY_MODULE_ALARM          1
+#define ENERGY_MODULE_COMMISSIONING  2
+#define ENERGY_MODULE_FACTORY_RESET  3
+#define ENERGY_MODULE_APP            4  // application reports queued to report_batch
+#define ENERGY_MODULE_COUNT          5
+
+// NLME_SetPollRate settings time is accounted to
+#define ENERGY_POLL_OFF              0  // polling disabled
+#define ENERGY_POLL_FAST             1  // up to ENERGY_POLL_FAST_MS
+#define ENERGY_POLL_NORMAL           2  // up to POLL_RATE
+#define ENERGY_POLL_SLOW             3  // slower than POLL_RATE
+#define ENERGY_POLL_COUNT            4
+
+#ifndef ENERGY_POLL_FAST_MS
+#define ENERGY_POLL_FAST_MS          1000
+#endif /* ENERGY_POLL_FAST_MS */
+
+typedef struct
+{
+  uint16 wakes;           // event handler invocations
+  uint16 adcConversions;  // ADC conversions
+  uint32 adcTicks;        // time spent converting, 32 kHz sleep timer ticks
+  uint16 reports;         // report frames carrying module attributes
+  uint32 reportBytes;     // report payload bytes
+  uint16 pollChanges;     // NLME_SetPollRate calls
+  uint32 ledOnMs;         // estimated LED on time
+} energyCounters_t;
+
+/*
+ * Layout of the ATTRID_POWER_CFG_ENERGY_COUNTERS octet string attribute,
+ * multi-byte fields are little endian.
+ */
+typedef struct
+{
+  uint8 len;
+  energyCounters_t module[ENERGY_MODULE_COUNT];
+  uint32 pollMs[ENERGY_POLL_COUNT];  // time spent at each poll setting
+} energyAttr_t;
+
+#if defined(ENERGY_ACCOUNTING)
+extern energyAttr_t zclEnergy;
+
+extern void zclEnergy_Wake(uint8 module);
+extern void zclEnergy_Adc(uint8 module, uint8 conversions, uint32 ticks);
+extern void zclEnergy_Report(uint8 module, const zclReport_t *attr, bool frame);
+extern void zclEnergy_SetPollRate(uint8 module, uint32 rate);
+extern void zclEnergy_LedSet(uint8 module, uint8 leds, uint8 mode);
+extern void zclEnergy_LedBlink(uint8 module, uint8 leds, uint8 numBlinks, uint8 percent, uint16 period);
+extern void zclEnergy_Update(void);
+extern void zclEnergy_Dump(void);
+
+#define ENERGY_WAKE(module)                      zclEnergy_Wake(module)
+#define ENERGY_ADC(module, conversions, ticks)   zclEnergy_Adc(module, conversions, ticks)
+#define ENERGY_REPORT(module, attr, frame)       zclEnergy_Report(module, attr, frame)
+#define ENERGY_SET_POLL_RATE(module, rate)       zclEnergy_SetPollRate(module, rate)
+#define ENERGY_LED_SET(module, leds, mode)       zclEnergy_LedSet(module, leds, mode)
+#define ENERGY_LED_BLINK(module, leds, n, p, t)  zclEnergy_LedBlink(module, leds, n, p, t)
+#else /* ENERGY_ACCOUNTING */
+#define ENERGY_WAKE(module)
+#define ENERGY_ADC(module, conversions, ticks)
+#define ENERGY_REPORT(module, attr, frame)
+#define ENERGY_SET_POLL_RATE(module, rate)       NLME_SetPollRate(rate)
+#define ENERGY_LED_SET(module, leds, mode)       HalLedSet(leds, mode)
+#define ENERGY_LED_BLINK(module, leds, n, p, t)  HalLedBlink(leds, n, p, t)
+#define zclEnergy_Update()
+#define zclEnergy_Dump()
+#endif /* !ENERGY_ACCOUNTING */
+
+#endif /* ENERGY_H */
@@ -6,6 +6,12 @@
 #include "hal_led.h"
 #include "hal_key.h"
 #include "debug_print.h"
+#include "energy.h"
+#include "nv_record.h"
+#include "utils.h"
+#include "trace.h"
+#include "zapp_task.h"
+#include "zapp_timer.h"
 
 #include "factory_reset.h"
 
@@ -37,6 +43,11 @@
     #define FACTORY_RESET_BOOTCOUNTER_RESET_TIME ((uint32)10 * 1000)
 #endif
 
+// the counter reset may come late, the device just has to stay up long enough
+#ifndef FACTORY_RESET_BOOTCOUNTER_RESET_SLACK
+    #define FACTORY_RESET_BOOTCOUNTER_RESET_SLACK ((uint32)5 * 1000)
+#endif
+
 #if !(FACTORY_RESET_BY_BOOT_COUNTER) && !(FACTORY_RESET_BY_LONG_PRESS)
 #error At least one of FACTORY_RESET_BY_BOOT_COUNTER or FACTORY_RESET_BY_LONG_PRESS should be enabled
 #endif /* !FACTORY_RESET_BY_BOOT_COUNTER && !FACTORY_RESET_BY_LONG_PRESS */
@@ -45,70 +56,45 @@
 #error FACTORY_RESET_BOOTCOUNTER_MAX_VALUE couldn't be less than 3
 #endif /* FACTORY_RESET_BOOTCOUNTER_MAX_VALUE */
 
-#define EVT_FACTORY_RESET 0x1000
-#define EVT_FACTORY_BOOTCOUNTER_RESET 0x2000
-
 static void zclFactoryResetter_ResetToFN(void);
+#if FACTORY_RESET_BY_LONG_PRESS
+static void zclFactoryResetter_HandleKeys(uint8 portAndAction, uint8 keyCode);
+#endif /* FACTORY_RESET_BY_LONG_PRESS */
 #if FACTORY_RESET_BY_BOOT_COUNTER
 static void zclFactoryResetter_ProcessBootCounter(void);
 static void zclFactoryResetter_ResetBootCounter(void);
+static uint16 zclFactoryResetter_ReadBootCounter(void);
+static void zclFactoryResetter_WriteBootCounter(uint16 bootCnt);
 #endif /* FACTORY_RESET_BY_BOOT_COUNTER */
 
-static uint8 zclFactoryResetter_TaskID;
+uint32 zclFactoryResetter_BootNvTicks = 0;
+
+static uint16 zclFactoryResetter_ResetEvent;
+#if FACTORY_RESET_BY_BOOT_COUNTER
+static uint16 zclFactoryResetter_BootCounterEvent;
+#endif /* FACTORY_RESET_BY_BOOT_COUNTER */
 
 /**************************************************************************************************
  * @fn      zclFactoryResetter_Init
  *
- * @brief   Initialize factory resetter task
+ * @brief   Initialize factory resetter, call after zAppTask_Init
  *
- * @param   task_id - ID of this task
+ * @param   None
  *
  * @return  None
  **************************************************************************************************/
-void zclFactoryResetter_Init(uint8 task_id)
+void zclFactoryResetter_Init(void)
 {
-    zclFactoryResetter_TaskID = task_id;
-    /**
-     * We can't register more than one task, call in main app taks
-     * zclFactoryResetter_HandleKeys(portAndAction, keyCode);
-     * */
-    // RegisterForKeys(task_id);
+    zclFactoryResetter_ResetEvent = zAppTask_AllocEvent(zclFactoryResetter_ResetToFN);
+#if FACTORY_RESET_BY_LONG_PRESS
+    zAppTask_RegisterKeys(zclFactoryResetter_HandleKeys);
+#endif
 #if FACTORY_RESET_BY_BOOT_COUNTER
+    zclFactoryResetter_BootCounterEvent = zAppTask_AllocEvent(zclFactoryResetter_ResetBootCounter);
     zclFactoryResetter_ProcessBootCounter();
 #endif
 }
 
-/**************************************************************************************************
- * @fn      zclFactoryResetter_event_loop
- *
- * @brief   Task event loop
- *
- * @param   task_id - ID of the task
- * @param   events - pending events
- *
- * @return  pending events still active after completion
- **************************************************************************************************/
-uint16 zclFactoryResetter_event_loop(uint8 task_id, uint16 events)
-{
-    if (events & EVT_FACTORY_RESET)
-    {
-        DBG("EVT_FACTORY_RESET\r\n");
-        zclFactoryResetter_ResetToFN();
-        return (events ^ EVT_FACTORY_RESET);
-    }
-
-#if FACTORY_RESET_BY_BOOT_COUNTER
-    if (events & EVT_FACTORY_BOOTCOUNTER_RESET)
-    {
-        DBG("EVT_FACTORY_BOOTCOUNTER_RESET\r\n");
-        zclFactoryResetter_ResetBootCounter();
-        return (events ^ EVT_FACTORY_BOOTCOUNTER_RESET);
-    }
-#endif /* FACTORY_RESET_BY_BOOT_COUNTER */
-
-    return 0;
-}
-
 /**************************************************************************************************
  * @fn      zclFactoryResetter_HandleKeys
  *
@@ -119,9 +105,9 @@ uint16 zclFactoryResetter_event_loop(uint8 task_id, uint16 events)
  *
  * @return  None
  **************************************************************************************************/
-void zclFactoryResetter_HandleKeys(uint8 portAndAction, uint8 keyCode)
-{
 #if FACTORY_RESET_BY_LONG_PRESS
+static void zclFactoryResetter_HandleKeys(uint8 portAndAction, uint8 keyCode)
+{
 #if FACTORY_RESET_BY_LONG_PRESS_PORT
     if (!((FACTORY_RESET_BY_LONG_PRESS_PORT) & portAndAction))
         return;
@@ -129,17 +115,17 @@ void zclFactoryResetter_HandleKeys(uint8 portAndAction, uint8 keyCode)
 
     if (portAndAction & HAL_KEY_RELEASE)
     {
-        DBG("zclFactoryResetter: Key release\r\n");
-        osal_stop_timerEx(zclFactoryResetter_TaskID, EVT_FACTORY_RESET);
+        DBG_TRACE(DEBUG_MODULE_FACTORY_RESET, "zclFactoryResetter: Key release\r\n");
+        osal_stop_timerEx(zAppTask_Id, zclFactoryResetter_ResetEvent);
     }
     else
     {
-        DBG("zclFactoryResetter: Key press\r\n");
+        DBG_TRACE(DEBUG_MODULE_FACTORY_RESET, "zclFactoryResetter: Key press\r\n");
         uint32 timeout = bdbAttributes.bdbNodeIsOnANetwork ? FACTORY_RESET_HOLD_TIME_LONG : FACTORY_RESET_HOLD_TIME_FAST;
-        osal_start_timerEx(zclFactoryResetter_TaskID, EVT_FACTORY_RESET, timeout);
+        osal_start_timerEx(zAppTask_Id, zclFactoryResetter_ResetEvent, timeout);
     }
-#endif /* FACTORY_RESET_BY_LONG_PRESS */
 }
+#endif /* FACTORY_RESET_BY_LONG_PRESS */
 
 /**************************************************************************************************
  * @fn      zclFactoryResetter_ResetToFN
@@ -152,9 +138,10 @@ void zclFactoryResetter_HandleKeys(uint8 portAndAction, uint8 keyCode)
  **************************************************************************************************/
 static void zclFactoryResetter_ResetToFN(void)
 {
-    HalLedSet(HAL_LED_1, HAL_LED_MODE_FLASH);
-    DBGF("bdbAttributes.bdbNodeIsOnANetwork=%d bdbAttributes.bdbCommissioningMode=0x%X\r\n", bdbAttributes.bdbNodeIsOnANetwork, bdbAttributes.bdbCommissioningMode);
-    DBG("zclFactoryResetter: Reset to FN\r\n");
+    ENERGY_WAKE(ENERGY_MODULE_FACTORY_RESET);
+    ENERGY_LED_SET(ENERGY_MODULE_FACTORY_RESET, HAL_LED_1, HAL_LED_MODE_FLASH);
+    DBG_TRACE(DEBUG_MODULE_FACTORY_RESET, "bdbAttributes.bdbNodeIsOnANetwork=%d bdbAttributes.bdbCommissioningMode=0x%X\r\n", bdbAttributes.bdbNodeIsOnANetwork, bdbAttributes.bdbCommissioningMode);
+    DBG_INFO(DEBUG_MODULE_FACTORY_RESET, "zclFactoryResetter: Reset to FN\r\n");
     bdb_resetLocalAction();
 }
 
@@ -170,24 +157,29 @@ static void zclFactoryResetter_ResetToFN(void)
  **************************************************************************************************/
 static void zclFactoryResetter_ProcessBootCounter(void)
 {
-    uint16 bootCnt = 0;
+    uint16 bootCnt;
+    uint32 start;
 
-    DBG("zclFactoryResetter_ProcessBootCounter\r\n");
+    DBG_TRACE(DEBUG_MODULE_FACTORY_RESET, "zclFactoryResetter_ProcessBootCounter\r\n");
 
-    osal_start_timerEx(zclFactoryResetter_TaskID, EVT_FACTORY_BOOTCOUNTER_RESET, FACTORY_RESET_BOOTCOUNTER_RESET_TIME);
+    zAppTimer_Start(zAppTask_Id, zclFactoryResetter_BootCounterEvent, FACTORY_RESET_BOOTCOUNTER_RESET_TIME,
+                    FACTORY_RESET_BOOTCOUNTER_RESET_SLACK);
 
-    if (osal_nv_item_init(ZCD_NV_BOOTCOUNTER, sizeof(bootCnt), &bootCnt) == ZSUCCESS) {
-        osal_nv_read(ZCD_NV_BOOTCOUNTER, 0, sizeof(bootCnt), &bootCnt);
-    }
-    DBGF("bootCnt %d\r\n", bootCnt);
+    start = sleepTimerRead();
+    TRACE_BEGIN(TRACE_ID_NV);
+    bootCnt = zclFactoryResetter_ReadBootCounter();
+    DBG_INFO(DEBUG_MODULE_FACTORY_RESET, "bootCnt %d\r\n", bootCnt);
     bootCnt++;
     if (bootCnt >= (FACTORY_RESET_BOOTCOUNTER_MAX_VALUE)) {
-        DBGF("bootCnt %d reached %d, executing factory reset\r\n", bootCnt, FACTORY_RESET_BOOTCOUNTER_MAX_VALUE);
+        DBG_WARN(DEBUG_MODULE_FACTORY_RESET, "bootCnt %d reached %d, executing factory reset\r\n", bootCnt, FACTORY_RESET_BOOTCOUNTER_MAX_VALUE);
         bootCnt = 0;
-        osal_stop_timerEx(zclFactoryResetter_TaskID, EVT_FACTORY_BOOTCOUNTER_RESET);
-        osal_start_timerEx(zclFactoryResetter_TaskID, EVT_FACTORY_RESET, 5000);
+        zAppTimer_Stop(zAppTask_Id, zclFactoryResetter_BootCounterEvent);
+        osal_start_timerEx(zAppTask_Id, zclFactoryResetter_ResetEvent, 5000);
     }
-    osal_nv_write(ZCD_NV_BOOTCOUNTER, 0, sizeof(bootCnt), &bootCnt);
+    zclFactoryResetter_WriteBootCounter(bootCnt);
+    TRACE_END(TRACE_ID_NV);
+    zclFactoryResetter_BootNvTicks = SLEEP_TIMER_ELAPSED(start, sleepTimerRead());
+    DBG_TRACE(DEBUG_MODULE_FACTORY_RESET, "bootCnt NV %lu ticks\r\n", zclFactoryResetter_BootNvTicks);
 }
 
 /**************************************************************************************************
@@ -201,8 +193,49 @@ static void zclFactoryResetter_ProcessBootCounter(void)
  **************************************************************************************************/
 static void zclFactoryResetter_ResetBootCounter(void)
 {
+    ENERGY_WAKE(ENERGY_MODULE_FACTORY_RESET);
+    zclFactoryResetter_WriteBootCounter(0);
+    DBG_TRACE(DEBUG_MODULE_FACTORY_RESET, "Boot counter reset\r\n");
+}
+
+/**************************************************************************************************
+ * @fn      zclFactoryResetter_ReadBootCounter
+ *
+ * @brief   Read boot counter, from nv_record when it is enabled
+ *
+ * @param   None
+ *
+ * @return  boot counter value
+ **************************************************************************************************/
+static uint16 zclFactoryResetter_ReadBootCounter(void)
+{
+#if defined(NV_RECORD_PAGE_BEG)
+    return zAppNvRecord_Read(NV_RECORD_ID_BOOT_COUNTER, 0);
+#else
     uint16 bootCnt = 0;
+
+    if (osal_nv_item_init(ZCD_NV_BOOTCOUNTER, sizeof(bootCnt), &bootCnt) == ZSUCCESS) {
+        osal_nv_read(ZCD_NV_BOOTCOUNTER, 0, sizeof(bootCnt), &bootCnt);
+    }
+    return bootCnt;
+#endif /* NV_RECORD_PAGE_BEG */
+}
+
+/**************************************************************************************************
+ * @fn      zclFactoryResetter_WriteBootCounter
+ *
+ * @brief   Write boot counter, to nv_record when it is enabled
+ *
+ * @param   bootCnt - boot counter value
+ *
+ * @return  None
+ **************************************************************************************************/
+static void zclFactoryResetter_WriteBootCounter(uint16 bootCnt)
+{
+#if defined(NV_RECORD_PAGE_BEG)
+    zAppNvRecord_Write(NV_RECORD_ID_BOOT_COUNTER, bootCnt);
+#else
     osal_nv_write(ZCD_NV_BOOTCOUNTER, 0, sizeof(bootCnt), &bootCnt);
-    DBG("Boot counter reset\r\n");
+#endif /* NV_RECORD_PAGE_BEG */
 }
 #endif /* FACTORY_RESET_BY_BOOT_COUNTER */
@@ -3,8 +3,9 @@
 
 #include "hal_defs.h"
 
-extern void zclFactoryResetter_Init(uint8 task_id);
-extern uint16 zclFactoryResetter_event_loop(uint8 task_id, uint16 events);
-extern void zclFactoryResetter_HandleKeys(uint8 portAndAction, uint8 keyCode);
+// sleep timer ticks the boot counter NV read and write took on this boot
+extern uint32 zclFactoryResetter_BootNvTicks;
+
+extern void zclFactoryResetter_Init(void);
 
 #endif
@@ -0,0 +1,308 @@
+#include "hal_types.h"
+
+#include "fixedpoint.h"
+
+#define FP_INT16_MAX   32767
+#define FP_INT16_MIN   (-32767 - 1)
+#define FP_UINT16_MAX  0xFFFF
+#define FP_INT32_MAX   0x7FFFFFFFL
+#define FP_INT32_MIN   (-FP_INT32_MAX - 1)
+
+static const uint32 fpPow10[] = {
+    1UL, 10UL, 100UL, 1000UL, 10000UL, 100000UL, 1000000UL, 10000000UL, 100000000UL, 1000000000UL
+};
+
+// floor(2^32 / 10^n), an estimate of x / 10^n low by at most 1, 10^0 is never divided by
+static const uint32 fpRecip10[] = {
+    0UL, 429496729UL, 42949672UL, 4294967UL, 429496UL, 42949UL, 4294UL, 429UL, 42UL, 4UL
+};
+
+#define FP_POW10_COUNT (sizeof(fpPow10) / sizeof(fpPow10[0]))
+
+static uint32 fpMulHi32(uint32 a, uint32 b);
+
+/**************************************************************************************************
+ * @fn      fpMulHi32
+ *
+ * @brief   High half of the 64 bit product from four 16 bit products,
+ *          the compiler has no 64 bit type to do it
+ *
+ * @param   a - first operand
+ * @param   b - second operand
+ *
+ * @return  a * b >> 32
+ **************************************************************************************************/
+static uint32 fpMulHi32(uint32 a, uint32 b)
+{
+    uint16 al = (uint16)a, ah = (uint16)(a >> 16);
+    uint16 bl = (uint16)b, bh = (uint16)(b >> 16);
+    uint32 ll = (uint32)al * bl;
+    uint32 lh = (uint32)al * bh;
+    uint32 hl = (uint32)ah * bl;
+    uint32 mid = (ll >> 16) + (uint16)lh + (uint16)hl;
+
+    return (uint32)ah * bh + (lh >> 16) + (hl >> 16) + (mid >> 16);
+}
+
+/**************************************************************************************************
+ * @fn      fpDivPow2M1
+ *
+ * @brief   Divide by 2^n - 1 with shifts and adds only, exact.
+ *          x = hi * 2^n + lo = hi * (2^n - 1) + hi + lo, so hi is added
+ *          to the quotient and hi + lo divided the same way until it
+ *          is below the divisor.
+ *
+ * @param   x - dividend
+ * @param   n - divisor bits, 1..31
+ *
+ * @return  x / (2^n - 1)
+ **************************************************************************************************/
+uint32 fpDivPow2M1(uint32 x, uint8 n)
+{
+    uint32 mask = ((uint32)1 << n) - 1;
+    uint32 q = 0;
+
+    while (x > mask)
+    {
+        uint32 hi = x >> n;
+        q += hi;
+        x = (x & mask) + hi;
+    }
+    if (x == mask)
+    {
+        q++;
+    }
+    return q;
+}
+
+/**************************************************************************************************
+ * @fn      fpScale
+ *
+ * @brief   Table driven SCALE, no loop whatever the scale is. Negative
+ *          scales divide by reciprocal multiplication and one correction
+ *          step. Truncates toward zero like SCALE, but saturates instead
+ *          of wrapping on overflow.
+ *
+ * @param   value - input value
+ * @param   scale - power of ten to scale by
+ *
+ * @return  value * 10^scale
+ **************************************************************************************************/
+int32 fpScale(int32 value, int8 scale)
+{
+    uint32 p;
+    uint32 mag;
+
+    if (scale == 0 || value == 0)
+    {
+        return value;
+    }
+    mag = value > 0 ? (uint32)value : (uint32)0 - (uint32)value;
+    if (scale < 0)
+    {
+        uint32 q;
+
+        if (-scale >= (int8)FP_POW10_COUNT)
+        {
+            return 0;
+        }
+        p = fpPow10[-scale];
+        q = fpMulHi32(mag, fpRecip10[-scale]);
+        if (mag - q * p >= p)
+        {
+            q++;
+        }
+        return value > 0 ? (int32)q : -(int32)q;
+    }
+    if (scale >= (int8)FP_POW10_COUNT)
+    {
+        return value > 0 ? FP_INT32_MAX : FP_INT32_MIN;
+    }
+
+    p = fpPow10[scale];
+    if (mag > (uint32)FP_INT32_MAX / p)
+    {
+        return value > 0 ? FP_INT32_MAX : FP_INT32_MIN;
+    }
+    return value * (int32)p;
+}
+
+/**************************************************************************************************
+ * @fn      fpSatAdd16
+ *
+ * @brief   Saturating signed addition
+ *
+ * @param   a - first operand
+ * @param   b - second operand
+ *
+ * @return  a + b clamped to int16
+ **************************************************************************************************/
+int16 fpSatAdd16(int16 a, int16 b)
+{
+    int32 r = (int32)a + b;
+
+    return r > FP_INT16_MAX ? FP_INT16_MAX : r < FP_INT16_MIN ? FP_INT16_MIN : (int16)r;
+}
+
+/**************************************************************************************************
+ * @fn      fpSatSub16
+ *
+ * @brief   Saturating signed subtraction
+ *
+ * @param   a - minuend
+ * @param   b - subtrahend
+ *
+ * @return  a - b clamped to int16
+ **************************************************************************************************/
+int16 fpSatSub16(int16 a, int16 b)
+{
+    int32 r = (int32)a - b;
+
+    return r > FP_INT16_MAX ? FP_INT16_MAX : r < FP_INT16_MIN ? FP_INT16_MIN : (int16)r;
+}
+
+/**************************************************************************************************
+ * @fn      fpSatMul16
+ *
+ * @brief   Saturating signed multiplication
+ *
+ * @param   a - first operand
+ * @param   b - second operand
+ *
+ * @return  a * b clamped to int16
+ **************************************************************************************************/
+int16 fpSatMul16(int16 a, int16 b)
+{
+    int32 r = (int32)a * b;
+
+    return r > FP_INT16_MAX ? FP_INT16_MAX : r < FP_INT16_MIN ? FP_INT16_MIN : (int16)r;
+}
+
+/**************************************************************************************************
+ * @fn      fpSatAddU16
+ *
+ * @brief   Saturating unsigned addition
+ *
+ * @param   a - first operand
+ * @param   b - second operand
+ *
+ * @return  a + b clamped to uint16
+ **************************************************************************************************/
+uint16 fpSatAddU16(uint16 a, uint16 b)
+{
+    uint16 r = a + b;
+
+    return r < a ? FP_UINT16_MAX : r;
+}
+
+/**************************************************************************************************
+ * @fn      fpSatSubU16
+ *
+ * @brief   Saturating unsigned subtraction
+ *
+ * @param   a - minuend
+ * @param   b - subtrahend
+ *
+ * @return  a - b, 0 if b is greater
+ **************************************************************************************************/
+uint16 fpSatSubU16(uint16 a, uint16 b)
+{
+    return a > b ? a - b : 0;
+}
+
+/**************************************************************************************************
+ * @fn      fpSatMulU16
+ *
+ * @brief   Saturating unsigned multiplication
+ *
+ * @param   a - first operand
+ * @param   b - second operand
+ *
+ * @return  a * b clamped to uint16
+ **************************************************************************************************/
+uint16 fpSatMulU16(uint16 a, uint16 b)
+{
+    uint32 r = (uint32)a * b;
+
+    return r > FP_UINT16_MAX ? FP_UINT16_MAX : (uint16)r;
+}
+
+/**************************************************************************************************
+ * @fn      fpMapInit
+ *
+ * @brief   Precompute map from one range to another, the only division
+ *          is done here. Ranges are up to 65535 wide.
+ *
+ * @param   map - map to initialize
+ * @param   inMin - first range minimum
+ * @param   inMax - first range maximum, differs from inMin
+ * @param   outMin - second range minimum
+ * @param   outMax - second range maximum
+ *
+ * @return  None
+ **************************************************************************************************/
+void fpMapInit(fpMap_t *map, int16 inMin, int16 inMax, int16 outMin, int16 outMax)
+{
+    int32 dIn, dOut, q, r;
+    uint32 frac;
+
+    // descending input is the same line walked from the other end
+    if (inMin > inMax)
+    {
+        int16 t = inMin;
+        inMin = inMax;
+        inMax = t;
+        t = outMin;
+        outMin = outMax;
+        outMax = t;
+    }
+    dIn = (int32)inMax - inMin;
+    dOut = (int32)outMax - outMin;
+    q = dOut / dIn;
+    r = dOut % dIn;
+    if (r < 0)
+    {
+        q--;
+        r += dIn;
+    }
+    // rounded fraction keeps the slope error below 1/2 output unit over the range
+    frac = (((uint32)r << 16) + (uint32)dIn / 2) / (uint32)dIn;
+    if (frac > 0xFFFF)
+    {
+        q++;
+        frac = 0;
+    }
+
+    map->inMin = inMin;
+    map->inMax = inMax;
+    map->outMin = outMin;
+    map->slopeInt = q;
+    map->slopeFrac = (uint16)frac;
+}
+
+/**************************************************************************************************
+ * @fn      fpMap
+ *
+ * @brief   Map value with a map from fpMapInit, input is clamped to the
+ *          first range. Rounds to nearest, differs from MAP by at most 1.
+ *
+ * @param   map - map
+ * @param   value - input value
+ *
+ * @return  mapped value
+ **************************************************************************************************/
+int16 fpMap(const fpMap_t *map, int16 value)
+{
+    uint16 d;
+
+    if (value < map->inMin)
+    {
+        value = map->inMin;
+    }
+    else if (value > map->inMax)
+    {
+        value = map->inMax;
+    }
+    d = (uint16)(value - map->inMin);
+    return (int16)(map->outMin + (int32)d * map->slopeInt + (int32)(((uint32)d * map->slopeFrac + 0x8000) >> 16));
+}
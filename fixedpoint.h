@@ -0,0 +1,77 @@
+#ifndef FIXEDPOINT_H
+#define FIXEDPOINT_H
+
+#include "hal_types.h"
+
+/*
+ * Integer kernels replacing run time division on the 8051, where 32 bit
+ * division is a library loop of a few hundred cycles.
+ */
+
+/*********************************************************************
+ * @fn          FP_CLOG2
+ *
+ * @brief       evaluates to ceil(log2(d)) of a constant, 1..32768
+ *
+ * @param       d - constant
+ */
+#define FP_CLOG2(d)                                                        \
+    ((d) > 16384 ? 15 : (d) > 8192 ? 14 : (d) > 4096 ? 13 : (d) > 2048 ? 12 : \
+     (d) > 1024 ? 11 : (d) > 512 ? 10 : (d) > 256 ? 9 : (d) > 128 ? 8 :      \
+     (d) > 64 ? 7 : (d) > 32 ? 6 : (d) > 16 ? 5 : (d) > 8 ? 4 :              \
+     (d) > 4 ? 3 : (d) > 2 ? 2 : (d) > 1 ? 1 : 0)
+
+/*********************************************************************
+ * @fn          FP_UDIV16
+ *
+ * @brief       evaluates to x / d for a constant d by reciprocal
+ *              multiplication, exact for every 16 bit x. The 17 bit
+ *              reciprocal ceil(2^(16 + l) / d), l = ceil(log2(d)), is
+ *              folded by the compiler, its implicit top bit is added
+ *              back as x.
+ *
+ * @param       x - uint16 dividend
+ * @param       d - constant divisor, 1..32768
+ */
+#define FP_UDIV16(x, d)                                                    \
+    ((uint16)(((uint32)(x) +                                               \
+               (((uint32)(x) * (uint16)((((uint32)1 << (16 + FP_CLOG2(d))) + (d) - 1) / (d))) >> 16)) \
+              >> FP_CLOG2(d)))
+
+/*********************************************************************
+ * @fn          FP_ADC2MV
+ *
+ * @brief       ADC2MV without division, same result
+ *
+ * @param       raw - raw ADC value
+ * @param       reference - reference voltage in milliVolts
+ * @param       resolution - ADC value resolution (HAL_ADC_RESOLUTION_*)
+ */
+#define FP_ADC2MV(raw, reference, resolution) \
+    fpDivPow2M1((uint32)(raw) * (reference) * 3, 5 + (resolution) * 2)
+
+/*
+ * Linear map precomputed by fpMapInit, the slope is kept as a floor
+ * integer part and a 1/65536 fraction.
+ */
+typedef struct
+{
+    int16 inMin;
+    int16 inMax;
+    int16 outMin;
+    int32 slopeInt;
+    uint16 slopeFrac;
+} fpMap_t;
+
+extern uint32 fpDivPow2M1(uint32 x, uint8 n);
+extern int32 fpScale(int32 value, int8 scale);
+extern int16 fpSatAdd16(int16 a, int16 b);
+extern int16 fpSatSub16(int16 a, int16 b);
+extern int16 fpSatMul16(int16 a, int16 b);
+extern uint16 fpSatAddU16(uint16 a, uint16 b);
+extern uint16 fpSatSubU16(uint16 a, uint16 b);
+extern uint16 fpSatMulU16(uint16 a, uint16 b);
+extern void fpMapInit(fpMap_t *map, int16 inMin, int16 inMax, int16 outMin, int16 outMax);
+extern int16 fpMap(const fpMap_t *map, int16 value);
+
+#endif /* FIXEDPOINT_H */
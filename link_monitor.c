@@ -0,0 +1,321 @@
+#include "OSAL.h"
+#include "ZDApp.h"
+#include "commissioning.h"
+#include "debug_print.h"
+#include "poll_control.h"
+#include "tx_power.h"
+#include "zapp_task.h"
+#include "zapp_timer.h"
+
+#include "link_monitor.h"
+
+#ifndef LINK_MONITOR_LQI_MIN
+    #define LINK_MONITOR_LQI_MIN 40
+#endif
+
+#ifndef LINK_MONITOR_TX_FAILURES_MAX
+    #define LINK_MONITOR_TX_FAILURES_MAX 4
+#endif
+
+#ifndef LINK_MONITOR_POLL_FAILURES_MAX
+    #define LINK_MONITOR_POLL_FAILURES_MAX 4
+#endif
+
+// no successful poll for this long while polling is a bad link
+#ifndef LINK_MONITOR_POLL_SILENCE_MS
+    #define LINK_MONITOR_POLL_SILENCE_MS ((uint32)60 * 1000)
+#endif
+
+// how long the link has to stay bad to rejoin
+#ifndef LINK_MONITOR_BAD_MS
+    #define LINK_MONITOR_BAD_MS ((uint32)5 * 60 * 1000)
+#endif
+
+// minimum time between pre-emptive rejoins
+#ifndef LINK_MONITOR_REJOIN_HOLDOFF_MS
+    #define LINK_MONITOR_REJOIN_HOLDOFF_MS ((uint32)60 * 60 * 1000)
+#endif
+
+// retry delay after the stack refused a rejoin, the link stays bad
+#ifndef LINK_MONITOR_REJOIN_RETRY_MS
+    #define LINK_MONITOR_REJOIN_RETRY_MS ((uint32)60 * 1000)
+#endif
+
+#ifndef LINK_MONITOR_IDLE_CHECK_MS
+    #define LINK_MONITOR_IDLE_CHECK_MS ((uint32)1000)
+#endif
+
+#ifndef LINK_MONITOR_IDLE_CHECK_SLACK
+    #define LINK_MONITOR_IDLE_CHECK_SLACK ((uint32)1000)
+#endif
+
+#ifndef LINK_MONITOR_IDLE
+    #define LINK_MONITOR_IDLE() (zclPollControl_Level() == POLL_LEVEL_SLEEP)
+#endif
+
+// BDB recovery is for a lost parent only, the stack refuses it on the network
+#ifndef LINK_MONITOR_REJOIN
+    #define LINK_MONITOR_REJOIN() zclCommissioning_SwitchParent()
+#endif
+
+#define LINK_MONITOR_NO_TASK 0xFF
+
+linkMonitorStats_t zclLinkMonitor_Stats;
+
+static uint8 linkMonitor_TaskId = LINK_MONITOR_NO_TASK;
+static uint16 linkMonitor_Event = 0;
+
+static uint16 linkMonitor_LqiQ4;    // averages in 1/16 units
+static int16 linkMonitor_RssiQ4;
+static uint16 linkMonitor_TxWindow; // 1 bits are failures, newest in bit 0
+static uint16 linkMonitor_PollWindow;
+static uint32 linkMonitor_BadSince;
+static uint32 linkMonitor_LastRejoin;
+static bool linkMonitor_Bad = FALSE;
+static bool linkMonitor_Heard = FALSE; // averages hold a sample
+
+static uint8 zclLinkMonitor_Shift(uint16 *window, uint8 *count, bool failed);
+static bool zclLinkMonitor_IsBad(uint32 now);
+
+/**************************************************************************************************
+ * @fn      zclLinkMonitor_Init
+ *
+ * @brief   Initialize link monitor
+ *
+ * @param   None
+ *
+ * @return  None
+ **************************************************************************************************/
+void zclLinkMonitor_Init(void)
+{
+    if (linkMonitor_TaskId == LINK_MONITOR_NO_TASK)
+    {
+        linkMonitor_TaskId = zAppTask_Id;
+        linkMonitor_Event = zAppTask_AllocEvent(zclLinkMonitor_Check);
+    }
+    linkMonitor_LastRejoin = osal_GetSystemClock() - LINK_MONITOR_REJOIN_HOLDOFF_MS;
+    zclLinkMonitor_Reset();
+}
+
+/**************************************************************************************************
+ * @fn      zclLinkMonitor_Reset
+ *
+ * @brief   Start over with a new parent
+ *
+ * @param   None
+ *
+ * @return  None
+ **************************************************************************************************/
+void zclLinkMonitor_Reset(void)
+{
+    uint16 rejoins = zclLinkMonitor_Stats.rejoins;
+
+    osal_memset(&zclLinkMonitor_Stats, 0, sizeof(zclLinkMonitor_Stats));
+    zclLinkMonitor_Stats.rejoins = rejoins;
+    zclLinkMonitor_Stats.lqi = 0xFF;  // nothing heard yet, assume good
+    zclLinkMonitor_Stats.lastGoodPoll = osal_GetSystemClock();
+    linkMonitor_LqiQ4 = 0;
+    linkMonitor_RssiQ4 = 0;
+    linkMonitor_TxWindow = 0;
+    linkMonitor_PollWindow = 0;
+    linkMonitor_Bad = FALSE;
+    linkMonitor_Heard = FALSE;
+}
+
+/**************************************************************************************************
+ * @fn      zclLinkMonitor_Rx
+ *
+ * @brief   Account frame received from the parent
+ *
+ * @param   lqi - frame link quality
+ * @param   rssi - frame RSSI, dBm
+ *
+ * @return  None
+ **************************************************************************************************/
+void zclLinkMonitor_Rx(uint8 lqi, int8 rssi)
+{
+    if (!linkMonitor_Heard)
+    {
+        linkMonitor_Heard = TRUE;
+        linkMonitor_LqiQ4 = (uint16)lqi << 4;
+        linkMonitor_RssiQ4 = (int16)rssi * 16;
+    }
+    else
+    {
+        linkMonitor_LqiQ4 += ((int16)((uint16)lqi << 4) - (int16)linkMonitor_LqiQ4) / 8;
+        linkMonitor_RssiQ4 += ((int16)rssi * 16 - linkMonitor_RssiQ4) / 8;
+    }
+    zclLinkMonitor_Stats.lqi = (linkMonitor_LqiQ4 + 8) >> 4;
+    zclLinkMonitor_Stats.rssi = (int8)(linkMonitor_RssiQ4 / 16);
+    zclLinkMonitor_Check();
+}
+
+/**************************************************************************************************
+ * @fn      zclLinkMonitor_Tx
+ *
+ * @brief   Account data request outcome, feed from AF data confirm
+ *
+ * @param   acked - TRUE if the parent acknowledged the frame
+ *
+ * @return  None
+ **************************************************************************************************/
+void zclLinkMonitor_Tx(bool acked)
+{
+    zclLinkMonitor_Stats.txFailures =
+        zclLinkMonitor_Shift(&linkMonitor_TxWindow, &zclLinkMonitor_Stats.txCount, !acked);
+    zclTxPower_Tx(acked, zclLinkMonitor_Stats.lqi);
+    zclLinkMonitor_Check();
+}
+
+/**************************************************************************************************
+ * @fn      zclLinkMonitor_Poll
+ *
+ * @brief   Account data poll outcome, feed from poll confirm
+ *
+ * @param   ok - TRUE if the poll was acknowledged
+ *
+ * @return  None
+ **************************************************************************************************/
+void zclLinkMonitor_Poll(bool ok)
+{
+    zclLinkMonitor_Stats.pollFailures =
+        zclLinkMonitor_Shift(&linkMonitor_PollWindow, &zclLinkMonitor_Stats.pollCount, !ok);
+    if (ok)
+    {
+        zclLinkMonitor_Stats.lastGoodPoll = osal_GetSystemClock();
+    }
+    zclLinkMonitor_Check();
+}
+
+/**************************************************************************************************
+ * @fn      zclLinkMonitor_Check
+ *
+ * @brief   Evaluate the link and rejoin if it stayed bad and the device
+ *          is idle, run by the library task
+ *
+ * @param   None
+ *
+ * @return  None
+ **************************************************************************************************/
+void zclLinkMonitor_Check(void)
+{
+    uint32 now = osal_GetSystemClock();
+
+    if (devState != DEV_END_DEVICE)
+    {
+        return;
+    }
+
+    if (!zclLinkMonitor_IsBad(now))
+    {
+        if (linkMonitor_Bad && linkMonitor_TaskId != LINK_MONITOR_NO_TASK)
+        {
+            zAppTimer_Stop(linkMonitor_TaskId, linkMonitor_Event);
+        }
+        linkMonitor_Bad = FALSE;
+        return;
+    }
+    if (!linkMonitor_Bad)
+    {
+        linkMonitor_Bad = TRUE;
+        linkMonitor_BadSince = now;
+        DBG_WARN(DEBUG_MODULE_LINK_MONITOR, "LINK: bad lqi %d tx %d/%d poll %d/%d\r\n", zclLinkMonitor_Stats.lqi,
+                 zclLinkMonitor_Stats.txFailures, zclLinkMonitor_Stats.txCount,
+                 zclLinkMonitor_Stats.pollFailures, zclLinkMonitor_Stats.pollCount);
+    }
+    if (now - linkMonitor_BadSince < LINK_MONITOR_BAD_MS ||
+        now - linkMonitor_LastRejoin < LINK_MONITOR_REJOIN_HOLDOFF_MS)
+    {
+        // no traffic may come to re-evaluate, wake up when both run out
+        uint32 wait = 0;
+
+        if (now - linkMonitor_BadSince < LINK_MONITOR_BAD_MS)
+        {
+            wait = LINK_MONITOR_BAD_MS - (now - linkMonitor_BadSince);
+        }
+        if (now - linkMonitor_LastRejoin < LINK_MONITOR_REJOIN_HOLDOFF_MS &&
+            LINK_MONITOR_REJOIN_HOLDOFF_MS - (now - linkMonitor_LastRejoin) > wait)
+        {
+            wait = LINK_MONITOR_REJOIN_HOLDOFF_MS - (now - linkMonitor_LastRejoin);
+        }
+        if (linkMonitor_TaskId != LINK_MONITOR_NO_TASK)
+        {
+            zAppTimer_Start(linkMonitor_TaskId, linkMonitor_Event, wait, LINK_MONITOR_IDLE_CHECK_SLACK);
+        }
+        return;
+    }
+
+    if (!LINK_MONITOR_IDLE())
+    {
+        if (linkMonitor_TaskId != LINK_MONITOR_NO_TASK)
+        {
+            zAppTimer_Start(linkMonitor_TaskId, linkMonitor_Event, LINK_MONITOR_IDLE_CHECK_MS,
+                            LINK_MONITOR_IDLE_CHECK_SLACK);
+        }
+        return;
+    }
+
+    if (LINK_MONITOR_REJOIN() != ZSUCCESS)
+    {
+        // keep the evidence and try again later
+        DBG_WARN(DEBUG_MODULE_LINK_MONITOR, "LINK: rejoin refused\r\n");
+        if (linkMonitor_TaskId != LINK_MONITOR_NO_TASK)
+        {
+            zAppTimer_Start(linkMonitor_TaskId, linkMonitor_Event, LINK_MONITOR_REJOIN_RETRY_MS,
+                            LINK_MONITOR_IDLE_CHECK_SLACK);
+        }
+        return;
+    }
+    DBG_INFO(DEBUG_MODULE_LINK_MONITOR, "LINK: rejoin to find a better parent\r\n");
+    zclLinkMonitor_Stats.rejoins++;
+    linkMonitor_LastRejoin = now;
+    zclLinkMonitor_Reset();
+}
+
+/**************************************************************************************************
+ * @fn      zclLinkMonitor_Shift
+ *
+ * @brief   Push outcome into sliding window
+ *
+ * @param   window - window bits, 1 is failure
+ * @param   count - number of outcomes in the window
+ * @param   failed - outcome to push
+ *
+ * @return  failures in the window
+ **************************************************************************************************/
+static uint8 zclLinkMonitor_Shift(uint16 *window, uint8 *count, bool failed)
+{
+    uint8 failures = 0;
+
+    *window = (*window << 1) | (failed ? 1 : 0);
+    if (*count < LINK_MONITOR_WINDOW)
+    {
+        (*count)++;
+    }
+    for (uint16 w = *window; w; w &= w - 1)
+    {
+        failures++;
+    }
+    return failures;
+}
+
+/**************************************************************************************************
+ * @fn      zclLinkMonitor_IsBad
+ *
+ * @brief   Check link quality against thresholds
+ *
+ * @param   now - current system clock
+ *
+ * @return  TRUE if the link is bad
+ **************************************************************************************************/
+static bool zclLinkMonitor_IsBad(uint32 now)
+{
+    if (zclLinkMonitor_Stats.lqi < LINK_MONITOR_LQI_MIN)
+        return TRUE;
+    if (zclLinkMonitor_Stats.txFailures >= LINK_MONITOR_TX_FAILURES_MAX)
+        return TRUE;
+    if (zclLinkMonitor_Stats.pollFailures >= LINK_MONITOR_POLL_FAILURES_MAX)
+        return TRUE;
+    return zclLinkMonitor_Stats.pollCount > 0 && zclPollControl_Level() != POLL_LEVEL_SLEEP &&
+           now - zclLinkMonitor_Stats.lastGoodPoll > LINK_MONITOR_POLL_SILENCE_MS;
+}
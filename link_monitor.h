@@ -0,0 +1,38 @@
+#ifndef LINK_MONITOR_H
+#define LINK_MONITOR_H
+
+#include "hal_defs.h"
+
+/*
+ * Parent link quality monitor. The application feeds it with frames
+ * received from the parent, data confirms and poll confirms. A link
+ * that stays bad for LINK_MONITOR_BAD_MS gets a rejoin through
+ * commissioning, on the channel of the best alternate parent heard,
+ * deferred to an idle window, to pick a better parent before the stack
+ * declares the parent lost. A refused rejoin is retried later.
+ */
+
+#define LINK_MONITOR_WINDOW  16  // outcomes kept per sliding window
+
+typedef struct
+{
+    uint8 lqi;           // running average of parent LQI
+    int8 rssi;           // running average of parent RSSI, dBm
+    uint8 txFailures;    // unacknowledged data requests in the window
+    uint8 txCount;       // data requests in the window
+    uint8 pollFailures;  // failed polls in the window
+    uint8 pollCount;     // polls in the window
+    uint32 lastGoodPoll; // system clock of the last successful poll
+    uint16 rejoins;      // pre-emptive rejoins triggered
+} linkMonitorStats_t;
+
+extern linkMonitorStats_t zclLinkMonitor_Stats;
+
+extern void zclLinkMonitor_Init(void);
+extern void zclLinkMonitor_Reset(void);
+extern void zclLinkMonitor_Rx(uint8 lqi, int8 rssi);
+extern void zclLinkMonitor_Tx(bool acked);
+extern void zclLinkMonitor_Poll(bool ok);
+extern void zclLinkMonitor_Check(void);
+
+#endif /* LINK_MONITOR_H */
@@ -0,0 +1,272 @@
+#if defined(NV_RECORD_PAGE_BEG)
+#include "hal_adc.h"
+#include "hal_board.h"
+#include "hal_flash.h"
+#include "debug_print.h"
+#include "trace.h"
+
+#include "nv_record.h"
+
+#if NV_RECORD_IDS > 8
+#error NV_RECORD_IDS should not be more than 8
+#endif /* NV_RECORD_IDS */
+
+#define NV_RECORD_PAGES          2
+#define NV_RECORD_PAGE_WORDS     (HAL_FLASH_PAGE_SIZE / HAL_FLASH_WORD_SIZE)
+
+// page header word, the sequence number picks the newer page
+#define NV_RECORD_MAGIC0         0x4E
+#define NV_RECORD_MAGIC1         0x52
+
+// record check byte over ID and value, never 0xFF
+#define NV_RECORD_CHECK(id, lsb, msb) ((uint8)(((id) ^ (lsb) ^ (msb) ^ 0x5A) & 0x7F))
+
+#define NV_RECORD_NO_PAGE        0xFF
+
+/*
+ * Record word: ID, value LSB, value MSB, check byte.
+ * Erased flash reads as 0xFF and fails the check, the first erased word
+ * ends the log. The check byte is programmed last, so a word torn by
+ * reset fails the check however many bytes landed.
+ */
+typedef struct
+{
+    uint8 id;
+    uint8 lsb;
+    uint8 msb;
+    uint8 check;
+} nvRecordWord_t;
+
+nvRecordStats_t zAppNvRecord_Stats;
+
+static uint8 nvRecord_Page = NV_RECORD_NO_PAGE;   // active page index
+static uint16 nvRecord_Seq = 0;
+static uint16 nvRecord_Offset = 0;                // next free word in the active page
+static uint16 nvRecord_Values[NV_RECORD_IDS];
+static uint8 nvRecord_Present = 0;                // bitmask of IDs holding a value
+static uint8 nvRecord_Unsaved = 0;                // bitmask of IDs not in flash yet
+
+static void zAppNvRecord_Load(void);
+static bool zAppNvRecord_Header(uint8 page, uint16 *seq);
+static bool zAppNvRecord_WriteWord(uint8 page, uint16 word, nvRecordWord_t *rec);
+static void zAppNvRecord_Compact(void);
+
+/**************************************************************************************************
+ * @fn      zAppNvRecord_Read
+ *
+ * @brief   Read the latest value of the record
+ *
+ * @param   id - record ID, NV_RECORD_ID_*
+ * @param   def - value to return if the record was never written
+ *
+ * @return  record value
+ **************************************************************************************************/
+uint16 zAppNvRecord_Read(uint8 id, uint16 def)
+{
+    zAppNvRecord_Load();
+    return (nvRecord_Present & BV(id)) ? nvRecord_Values[id] : def;
+}
+
+/**************************************************************************************************
+ * @fn      zAppNvRecord_Write
+ *
+ * @brief   Append new value of the record, unchanged values are not written.
+ *          On low supply the value is kept in RAM and written later.
+ *
+ * @param   id - record ID, NV_RECORD_ID_*
+ * @param   value - value to store
+ *
+ * @return  None
+ **************************************************************************************************/
+void zAppNvRecord_Write(uint8 id, uint16 value)
+{
+    nvRecordWord_t rec;
+
+    zAppNvRecord_Load();
+    if ((nvRecord_Present & BV(id)) && !(nvRecord_Unsaved & BV(id)) && nvRecord_Values[id] == value)
+    {
+        return;
+    }
+    nvRecord_Values[id] = value;
+    nvRecord_Present |= BV(id);
+    nvRecord_Unsaved |= BV(id);
+
+    if (nvRecord_Offset >= NV_RECORD_PAGE_WORDS)
+    {
+        // the new value is moved over along with the others
+        zAppNvRecord_Compact();
+        return;
+    }
+    rec.id = id;
+    rec.lsb = LO_UINT16(value);
+    rec.msb = HI_UINT16(value);
+    rec.check = NV_RECORD_CHECK(rec.id, rec.lsb, rec.msb);
+    if (zAppNvRecord_WriteWord(nvRecord_Page, nvRecord_Offset, &rec))
+    {
+        nvRecord_Offset++;
+        nvRecord_Unsaved &= ~BV(id);
+        zAppNvRecord_Stats.writes++;
+    }
+}
+
+/**************************************************************************************************
+ * @fn      zAppNvRecord_Load
+ *
+ * @brief   Find the active page and replay its records, once per boot
+ *
+ * @param   None
+ *
+ * @return  None
+ **************************************************************************************************/
+static void zAppNvRecord_Load(void)
+{
+    nvRecordWord_t rec;
+    uint16 seq;
+
+    if (nvRecord_Page != NV_RECORD_NO_PAGE)
+    {
+        return;
+    }
+
+    for (uint8 page = 0; page < NV_RECORD_PAGES; page++)
+    {
+        if (zAppNvRecord_Header(page, &seq) &&
+            (nvRecord_Page == NV_RECORD_NO_PAGE || (int16)(seq - nvRecord_Seq) > 0))
+        {
+            nvRecord_Page = page;
+            nvRecord_Seq = seq;
+        }
+    }
+
+    if (nvRecord_Page == NV_RECORD_NO_PAGE)
+    {
+        DBG_INFO(DEBUG_MODULE_NV_RECORD, "zAppNvRecord: format\r\n");
+        // compaction of nothing formats the first page
+        nvRecord_Page = NV_RECORD_PAGES - 1;
+        zAppNvRecord_Compact();
+        return;
+    }
+
+    for (nvRecord_Offset = 1; nvRecord_Offset < NV_RECORD_PAGE_WORDS; nvRecord_Offset++)
+    {
+        HalFlashRead(NV_RECORD_PAGE_BEG + nvRecord_Page, nvRecord_Offset * HAL_FLASH_WORD_SIZE,
+                     (uint8 *)&rec, sizeof(rec));
+        if (rec.id == 0xFF && rec.check == 0xFF && rec.lsb == 0xFF && rec.msb == 0xFF)
+        {
+            break;
+        }
+        // a word torn by reset fails the check and is skipped
+        if (rec.id < NV_RECORD_IDS && rec.check == NV_RECORD_CHECK(rec.id, rec.lsb, rec.msb))
+        {
+            nvRecord_Values[rec.id] = BUILD_UINT16(rec.lsb, rec.msb);
+            nvRecord_Present |= BV(rec.id);
+        }
+    }
+}
+
+/**************************************************************************************************
+ * @fn      zAppNvRecord_Header
+ *
+ * @brief   Check the page header
+ *
+ * @param   page - page index
+ * @param   seq - sequence number output
+ *
+ * @return  TRUE if the page holds records
+ **************************************************************************************************/
+static bool zAppNvRecord_Header(uint8 page, uint16 *seq)
+{
+    nvRecordWord_t hdr;
+
+    HalFlashRead(NV_RECORD_PAGE_BEG + page, 0, (uint8 *)&hdr, sizeof(hdr));
+    *seq = BUILD_UINT16(hdr.lsb, hdr.msb);
+    return (hdr.id == NV_RECORD_MAGIC0 && hdr.check == NV_RECORD_MAGIC1);
+}
+
+/**************************************************************************************************
+ * @fn      zAppNvRecord_WriteWord
+ *
+ * @brief   Write one flash word if the supply is high enough for it
+ *
+ * @param   page - page index
+ * @param   word - word offset in the page
+ * @param   rec - word to write
+ *
+ * @return  TRUE if the word was written
+ **************************************************************************************************/
+static bool zAppNvRecord_WriteWord(uint8 page, uint16 word, nvRecordWord_t *rec)
+{
+    uint16 addr = (uint16)(NV_RECORD_PAGE_BEG + page) * NV_RECORD_PAGE_WORDS + word;
+
+    if (!HalAdcCheckVdd(VDD_MIN_NV))
+    {
+        zAppNvRecord_Stats.lowVdd++;
+        return FALSE;
+    }
+    HalFlashWrite(addr, (uint8 *)rec, 1);
+    return TRUE;
+}
+
+/**************************************************************************************************
+ * @fn      zAppNvRecord_Compact
+ *
+ * @brief   Move the latest values to the other page and make it active.
+ *          The header is written last, a reset halfway leaves the old
+ *          page active. On low supply the old page stays active as well
+ *          and the next write tries again.
+ *
+ * @param   None
+ *
+ * @return  None
+ **************************************************************************************************/
+static void zAppNvRecord_Compact(void)
+{
+    nvRecordWord_t rec;
+    uint8 page = (nvRecord_Page + 1) % NV_RECORD_PAGES;
+    uint16 offset = 1;
+
+    // a full offset makes the next write compact again
+    nvRecord_Offset = NV_RECORD_PAGE_WORDS;
+    if (!HalAdcCheckVdd(VDD_MIN_NV))
+    {
+        zAppNvRecord_Stats.lowVdd++;
+        return;
+    }
+
+    TRACE_BEGIN(TRACE_ID_NV_COMPACT);
+    HalFlashErase(NV_RECORD_PAGE_BEG + page);
+    zAppNvRecord_Stats.compactions++;
+
+    for (uint8 id = 0; id < NV_RECORD_IDS; id++)
+    {
+        if (nvRecord_Present & BV(id))
+        {
+            rec.id = id;
+            rec.lsb = LO_UINT16(nvRecord_Values[id]);
+            rec.msb = HI_UINT16(nvRecord_Values[id]);
+            rec.check = NV_RECORD_CHECK(rec.id, rec.lsb, rec.msb);
+            if (!zAppNvRecord_WriteWord(page, offset++, &rec))
+            {
+                TRACE_END(TRACE_ID_NV_COMPACT);
+                return;
+            }
+        }
+    }
+
+    rec.id = NV_RECORD_MAGIC0;
+    rec.lsb = LO_UINT16(nvRecord_Seq + 1);
+    rec.msb = HI_UINT16(nvRecord_Seq + 1);
+    rec.check = NV_RECORD_MAGIC1;
+    if (!zAppNvRecord_WriteWord(page, 0, &rec))
+    {
+        TRACE_END(TRACE_ID_NV_COMPACT);
+        return;
+    }
+    nvRecord_Seq++;
+    nvRecord_Page = page;
+    nvRecord_Offset = offset;
+    nvRecord_Unsaved = 0;
+    TRACE_END(TRACE_ID_NV_COMPACT);
+    DBG_TRACE(DEBUG_MODULE_NV_RECORD, "zAppNvRecord: compacted to %d seq %u\r\n", page, nvRecord_Seq);
+}
+#endif /* NV_RECORD_PAGE_BEG */
@@ -0,0 +1,39 @@
+#ifndef NV_RECORD_H
+#define NV_RECORD_H
+
+#include "hal_defs.h"
+
+/*
+ * Append-only 16 bit records for values written on every boot or more
+ * often. Each write takes one flash word in the active page, the other
+ * page is erased only when the active one fills up and the latest
+ * values are moved over. Records live outside of OSAL NV, so writes
+ * never trigger OSAL NV page compaction.
+ *
+ * Enabled by defining NV_RECORD_PAGE_BEG, the first of two flash pages
+ * reserved for the records. Both pages have to be excluded from the
+ * code area in the linker command file and must not overlap OSAL NV.
+ */
+
+#ifndef NV_RECORD_IDS
+#define NV_RECORD_IDS                4
+#endif /* NV_RECORD_IDS */
+
+// record IDs, 0..NV_RECORD_IDS-1
+#define NV_RECORD_ID_BOOT_COUNTER    0
+
+typedef struct
+{
+    uint16 writes;       // records appended
+    uint16 compactions;  // page erases
+    uint16 lowVdd;       // writes and erases skipped on low supply
+} nvRecordStats_t;
+
+#if defined(NV_RECORD_PAGE_BEG)
+extern nvRecordStats_t zAppNvRecord_Stats;
+
+extern uint16 zAppNvRecord_Read(uint8 id, uint16 def);
+extern void zAppNvRecord_Write(uint8 id, uint16 value);
+#endif /* NV_RECORD_PAGE_BEG */
+
+#endif /* NV_RECORD_H */
@@ -0,0 +1,242 @@
+#include "OSAL.h"
+#include "ZDApp.h"
+#include "debug_print.h"
+#include "energy.h"
+#include "zapp_task.h"
+#include "zapp_timer.h"
+
+#include "poll_control.h"
+
+#ifndef POLL_CONTROL_FAST_RATE
+    #define POLL_CONTROL_FAST_RATE 250
+#endif
+
+#ifndef POLL_CONTROL_MEDIUM_RATE
+    #define POLL_CONTROL_MEDIUM_RATE 1000
+#endif
+
+#ifndef POLL_CONTROL_SLEEP_RATE
+    #define POLL_CONTROL_SLEEP_RATE 0
+#endif
+
+#ifndef POLL_CONTROL_FAST_HOLD
+    #define POLL_CONTROL_FAST_HOLD ((uint32)3 * 1000)
+#endif
+
+#ifndef POLL_CONTROL_MEDIUM_HOLD
+    #define POLL_CONTROL_MEDIUM_HOLD ((uint32)5 * 1000)
+#endif
+
+#ifndef POLL_CONTROL_NORMAL_HOLD
+    #define POLL_CONTROL_NORMAL_HOLD ((uint32)10 * 1000)
+#endif
+
+// hold timers may run this much longer to share a wakeup with other timers
+#ifndef POLL_CONTROL_HOLD_SLACK
+    #define POLL_CONTROL_HOLD_SLACK ((uint32)1000)
+#endif
+
+// longest time spent faster than POLL_RATE before going back to sleep level
+#ifndef POLL_CONTROL_FAST_MAX_MS
+    #define POLL_CONTROL_FAST_MAX_MS ((uint32)60 * 1000)
+#endif
+
+static const uint32 pollControlRate[POLL_LEVEL_COUNT] = {
+    POLL_CONTROL_FAST_RATE, POLL_CONTROL_MEDIUM_RATE, POLL_RATE, POLL_CONTROL_SLEEP_RATE
+};
+
+static const uint32 pollControlHold[POLL_LEVEL_SLEEP] = {
+    POLL_CONTROL_FAST_HOLD, POLL_CONTROL_MEDIUM_HOLD, POLL_CONTROL_NORMAL_HOLD
+};
+
+pollControlStats_t zclPollControl_Stats;
+
+#define POLL_CONTROL_NO_TASK 0xFF
+
+static uint8 pollControl_TaskId = POLL_CONTROL_NO_TASK;
+static uint16 pollControl_Event = 0;
+static uint8 pollControl_Level = POLL_LEVEL_NORMAL;
+static bool pollControl_Hold = FALSE;
+static uint32 pollControl_Since = 0;     // when current level was entered
+static uint32 pollControl_FastMs = 0;    // time faster than POLL_RATE since sleep level
+
+static void zclPollControl_Set(uint8 level, uint8 reason);
+
+/**************************************************************************************************
+ * @fn      zclPollControl_Init
+ *
+ * @brief   Initialize poll rate control
+ *
+ * @param   None
+ *
+ * @return  None
+ **************************************************************************************************/
+void zclPollControl_Init(void)
+{
+    if (pollControl_TaskId == POLL_CONTROL_NO_TASK)
+    {
+        pollControl_TaskId = zAppTask_Id;
+        pollControl_Event = zAppTask_AllocEvent(zclPollControl_Step);
+    }
+    pollControl_Since = osal_GetSystemClock();
+}
+
+/**************************************************************************************************
+ * @fn      zclPollControl_Raise
+ *
+ * @brief   Poll at least at the given level for its hold time, a level
+ *          slower than the current one is ignored
+ *
+ * @param   level - POLL_LEVEL_*
+ * @param   reason - POLL_REASON_*
+ *
+ * @return  None
+ **************************************************************************************************/
+void zclPollControl_Raise(uint8 level, uint8 reason)
+{
+    uint32 fastMs = pollControl_FastMs;
+
+    // senders outside of commissioning may raise before zclPollControl_Init
+    if (pollControl_TaskId == POLL_CONTROL_NO_TASK)
+    {
+        return;
+    }
+    if (pollControl_Level < POLL_LEVEL_NORMAL)
+    {
+        fastMs += osal_GetSystemClock() - pollControl_Since;
+    }
+    if (level < POLL_LEVEL_NORMAL && fastMs >= POLL_CONTROL_FAST_MAX_MS)
+    {
+        // fast poll budget until the next sleep level is spent
+        zclPollControl_Stats.capped++;
+        level = POLL_LEVEL_NORMAL;
+        reason = POLL_REASON_CAP;
+    }
+    else if (level > pollControl_Level)
+    {
+        return;
+    }
+    zclPollControl_Set(level, reason);
+}
+
+/**************************************************************************************************
+ * @fn      zclPollControl_Hold
+ *
+ * @brief   Keep polling at POLL_RATE or faster until released
+ *
+ * @param   hold - TRUE to hold, FALSE to let it decay
+ *
+ * @return  None
+ **************************************************************************************************/
+void zclPollControl_Hold(bool hold)
+{
+    pollControl_Hold = hold;
+    if (hold)
+    {
+        if (pollControl_Level > POLL_LEVEL_NORMAL)
+        {
+            zclPollControl_Set(POLL_LEVEL_NORMAL, POLL_REASON_HOLD);
+        }
+    }
+    else if (pollControl_Level == POLL_LEVEL_NORMAL)
+    {
+        zAppTimer_Start(pollControl_TaskId, pollControl_Event, pollControlHold[POLL_LEVEL_NORMAL], POLL_CONTROL_HOLD_SLACK);
+    }
+}
+
+/**************************************************************************************************
+ * @fn      zclPollControl_Sleep
+ *
+ * @brief   Release hold and go to sleep level right away
+ *
+ * @param   None
+ *
+ * @return  None
+ **************************************************************************************************/
+void zclPollControl_Sleep(void)
+{
+    pollControl_Hold = FALSE;
+    zclPollControl_Set(POLL_LEVEL_SLEEP, POLL_REASON_SLEEP);
+}
+
+/**************************************************************************************************
+ * @fn      zclPollControl_Step
+ *
+ * @brief   Decay to the next slower level, run by the library task
+ *
+ * @param   None
+ *
+ * @return  None
+ **************************************************************************************************/
+void zclPollControl_Step(void)
+{
+    if (pollControl_Level < POLL_LEVEL_SLEEP && !(pollControl_Hold && pollControl_Level == POLL_LEVEL_NORMAL))
+    {
+        zclPollControl_Set(pollControl_Level + 1, POLL_REASON_TIMEOUT);
+    }
+}
+
+/**************************************************************************************************
+ * @fn      zclPollControl_Level
+ *
+ * @brief   Get current poll level
+ *
+ * @param   None
+ *
+ * @return  POLL_LEVEL_*
+ **************************************************************************************************/
+uint8 zclPollControl_Level(void)
+{
+    return pollControl_Level;
+}
+
+/**************************************************************************************************
+ * @fn      zclPollControl_Set
+ *
+ * @brief   Apply poll level, account the time spent at the previous one
+ *          and arm the decay timer
+ *
+ * @param   level - POLL_LEVEL_*
+ * @param   reason - POLL_REASON_*
+ *
+ * @return  None
+ **************************************************************************************************/
+static void zclPollControl_Set(uint8 level, uint8 reason)
+{
+    uint32 now = osal_GetSystemClock();
+    uint32 dwell = now - pollControl_Since;
+    uint32 polls = pollControlRate[pollControl_Level] ? dwell / pollControlRate[pollControl_Level] : 0;
+
+    zclPollControl_Stats.levelMs[pollControl_Level] += dwell;
+    zclPollControl_Stats.polls += polls;
+    if (pollControl_Level < POLL_LEVEL_NORMAL)
+    {
+        pollControl_FastMs += dwell;
+    }
+    if (level == POLL_LEVEL_SLEEP)
+    {
+        pollControl_FastMs = 0;
+    }
+    pollControl_Since = now;
+
+    if (level != pollControl_Level)
+    {
+        // new rate is also the worst case latency of a message waiting at the parent
+        DBG_TRACE(DEBUG_MODULE_POLL_CONTROL, "POLL %d->%d why %d rate %lu, %lu ms ~%lu polls\r\n",
+                  pollControl_Level, level, reason, pollControlRate[level], dwell, polls);
+        zclPollControl_Stats.transitions++;
+        pollControl_Level = level;
+#if defined(POWER_SAVING)
+        ENERGY_SET_POLL_RATE(ENERGY_MODULE_COMMISSIONING, pollControlRate[level]);
+#endif
+    }
+
+    if (level < POLL_LEVEL_SLEEP && !(pollControl_Hold && level == POLL_LEVEL_NORMAL))
+    {
+        zAppTimer_Start(pollControl_TaskId, pollControl_Event, pollControlHold[level], POLL_CONTROL_HOLD_SLACK);
+    }
+    else
+    {
+        zAppTimer_Stop(pollControl_TaskId, pollControl_Event);
+    }
+}
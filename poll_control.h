@@ -0,0 +1,43 @@
+#ifndef POLL_CONTROL_H
+#define POLL_CONTROL_H
+
+#include "hal_defs.h"
+
+/*
+ * Poll rate levels, from the fastest to the slowest. A raise moves to
+ * a faster level, each level decays to the next one after its hold time.
+ */
+#define POLL_LEVEL_FAST      0
+#define POLL_LEVEL_MEDIUM    1
+#define POLL_LEVEL_NORMAL    2
+#define POLL_LEVEL_SLEEP     3
+#define POLL_LEVEL_COUNT     4
+
+// why the level changed
+#define POLL_REASON_TIMEOUT  0
+#define POLL_REASON_KEY      1
+#define POLL_REASON_REPORT   2  // report or command expecting a response sent
+#define POLL_REASON_BINDING  3
+#define POLL_REASON_JOIN     4
+#define POLL_REASON_HOLD     5
+#define POLL_REASON_SLEEP    6
+#define POLL_REASON_CAP      7
+
+typedef struct
+{
+    uint16 transitions;
+    uint16 capped;                    // raises limited by POLL_CONTROL_FAST_MAX_MS
+    uint32 levelMs[POLL_LEVEL_COUNT]; // time spent at each level
+    uint32 polls;                     // estimated data requests sent
+} pollControlStats_t;
+
+extern pollControlStats_t zclPollControl_Stats;
+
+extern void zclPollControl_Init(void);
+extern void zclPollControl_Raise(uint8 level, uint8 reason);
+extern void zclPollControl_Hold(bool hold);
+extern void zclPollControl_Sleep(void);
+extern void zclPollControl_Step(void);
+extern uint8 zclPollControl_Level(void);
+
+#endif /* POLL_CONTROL_H */
@@ -0,0 +1,210 @@
+#include "OSAL.h"
+#include "zcl.h"
+#include "bdb_interface.h"
+#include "debug_print.h"
+#include "energy.h"
+#include "poll_control.h"
+#include "zapp_task.h"
+#include "trace.h"
+
+#include "report_batch.h"
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+typedef struct
+{
+  uint8 module;     // ENERGY_MODULE_*, REPORT_BATCH_DEFAULT_RSP
+  uint8 endpoint;
+  uint16 clusterID;
+  zclReport_t attr;
+} reportBatchEntry_t;
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#define REPORT_BATCH_NO_TASK 0xFF
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+static uint8  reportBatch_TaskId = REPORT_BATCH_NO_TASK;
+static uint16 reportBatch_Event = 0;
+
+static reportBatchEntry_t reportBatch[REPORT_BATCH_SIZE];
+static uint8 reportBatch_Count = 0;
+
+/*********************************************************************
+ * LOCAL PROTOTYPES
+ */
+static void zclReportBatch_Send(uint8 first);
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      zclReportBatch_Send
+ *
+ * @brief   Send queued attributes of the cluster and endpoint of the
+ *          given entry in one frame and remove them from the queue
+ *
+ * @param   first - index of the first queued entry of the frame
+ *
+ * @return  none
+ */
+static void zclReportBatch_Send(uint8 first)
+{
+  uint8 endpoint = reportBatch[first].endpoint;
+  uint16 clusterID = reportBatch[first].clusterID;
+  uint8 numAttr = 0;
+  uint8 disableDefaultRsp = TRUE;
+  uint8 i, j;
+  zclReportCmd_t *cmd;
+
+  for (i = first; i < reportBatch_Count; i++)
+  {
+    if (reportBatch[i].endpoint == endpoint && reportBatch[i].clusterID == clusterID)
+    {
+      numAttr++;
+      if (reportBatch[i].module & REPORT_BATCH_DEFAULT_RSP)
+        disableDefaultRsp = FALSE;
+    }
+  }
+
+  cmd = (zclReportCmd_t *)osal_mem_alloc(sizeof(zclReportCmd_t) + numAttr * sizeof(zclReport_t));
+  if (cmd != NULL)
+  {
+    afAddrType_t dstAddr = {
+      .addrMode = (afAddrMode_t)AddrNotPresent,
+      .addr.shortAddr = 0,
+      .endPoint = endpoint,
+    };
+
+#if defined(ENERGY_ACCOUNTING)
+    uint8 modules = 0;  // modules already accounted a frame
+#endif /* ENERGY_ACCOUNTING */
+
+    cmd->numAttr = 0;
+    for (i = first; i < reportBatch_Count; i++)
+    {
+      if (reportBatch[i].endpoint == endpoint && reportBatch[i].clusterID == clusterID)
+      {
+#if defined(ENERGY_ACCOUNTING)
+        uint8 module = reportBatch[i].module & ~REPORT_BATCH_DEFAULT_RSP;
+
+        ENERGY_REPORT(module, &reportBatch[i].attr, !(modules & BV(module)));
+        modules |= BV(module);
+#endif /* ENERGY_ACCOUNTING */
+        cmd->attrList[cmd->numAttr++] = reportBatch[i].attr;
+      }
+    }
+    TRACE_BEGIN(TRACE_ID_REPORT);
+    zcl_SendReportCmd(endpoint, &dstAddr, clusterID, cmd,
+                      ZCL_FRAME_SERVER_CLIENT_DIR, disableDefaultRsp, bdb_getZCLFrameCounter());
+    TRACE_END(TRACE_ID_REPORT);
+    osal_mem_free(cmd);
+    // the Default Response waits at the parent until the next poll
+    if (!disableDefaultRsp)
+      zclPollControl_Raise(POLL_LEVEL_FAST, POLL_REASON_REPORT);
+  }
+  else
+  {
+    DBG_ERROR(DEBUG_MODULE_REPORTING, "REP: no memory for 0x%04X@%d\r\n", clusterID, endpoint);
+  }
+
+  // drop the sent entries keeping the order of the rest
+  for (i = j = first; i < reportBatch_Count; i++)
+  {
+    if (reportBatch[i].endpoint != endpoint || reportBatch[i].clusterID != clusterID)
+      reportBatch[j++] = reportBatch[i];
+  }
+  reportBatch_Count = j;
+}
+
+/*********************************************************************
+ * GLOBAL FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      zclReportBatch_Init
+ *
+ * @brief   Enable batching. zclReportBatch_Add then only queues the
+ *          attribute and sets the event, the library task calls
+ *          zclReportBatch_Flush on it. Without it every queued
+ *          attribute is sent right away.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void zclReportBatch_Init(void)
+{
+  if (reportBatch_TaskId == REPORT_BATCH_NO_TASK)
+  {
+    reportBatch_TaskId = zAppTask_Id;
+    reportBatch_Event = zAppTask_AllocEvent(zclReportBatch_Flush);
+  }
+}
+
+/*********************************************************************
+ * @fn      zclReportBatch_Add
+ *
+ * @brief   Queue attribute report. The value is read when the frame
+ *          is sent, queuing the same attribute again has no effect.
+ *
+ * @param   module - ENERGY_MODULE_* the report is accounted to,
+ *                   optionally with REPORT_BATCH_DEFAULT_RSP
+ * @param   endpoint - source endpoint
+ * @param   clusterID - cluster ID
+ * @param   attrID - attribute ID
+ * @param   dataType - attribute data type
+ * @param   attrData - pointer to the attribute value
+ *
+ * @return  none
+ */
+void zclReportBatch_Add(uint8 module, uint8 endpoint, uint16 clusterID, uint16 attrID, uint8 dataType, void *attrData)
+{
+  reportBatchEntry_t *entry;
+  uint8 i;
+
+  for (i = 0; i < reportBatch_Count; i++)
+  {
+    entry = &reportBatch[i];
+    if (entry->endpoint == endpoint && entry->clusterID == clusterID && entry->attr.attrID == attrID)
+      return;
+  }
+
+  if (reportBatch_Count == REPORT_BATCH_SIZE)
+    zclReportBatch_Send(0);
+
+  entry = &reportBatch[reportBatch_Count++];
+  entry->module = module;
+  entry->endpoint = endpoint;
+  entry->clusterID = clusterID;
+  entry->attr.attrID = attrID;
+  entry->attr.dataType = dataType;
+  entry->attr.attrData = attrData;
+
+  if (reportBatch_TaskId == REPORT_BATCH_NO_TASK)
+    zclReportBatch_Flush();
+  else if (reportBatch_Count == 1)
+    osal_set_event(reportBatch_TaskId, reportBatch_Event);
+}
+
+/*********************************************************************
+ * @fn      zclReportBatch_Flush
+ *
+ * @brief   Send all queued attributes, one frame per cluster and
+ *          endpoint
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void zclReportBatch_Flush(void)
+{
+  while (reportBatch_Count > 0)
+    zclReportBatch_Send(0);
+}
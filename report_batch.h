@@ -0,0 +1,23 @@
+#ifndef REPORT_BATCH_H
+#define REPORT_BATCH_H
+
+#include "hal_defs.h"
+
+/*
+ * Attribute reports queued by any module within one wake go out as
+ * a single Report Attributes frame per cluster and endpoint. Each
+ * attribute is accounted to the ENERGY_MODULE_* that queued it, with
+ * REPORT_BATCH_DEFAULT_RSP added its frame requests Default Response.
+ */
+
+#define REPORT_BATCH_DEFAULT_RSP 0x80
+
+#ifndef REPORT_BATCH_SIZE
+#define REPORT_BATCH_SIZE    8
+#endif /* REPORT_BATCH_SIZE */
+
+extern void zclReportBatch_Init(void);
+extern void zclReportBatch_Add(uint8 module, uint8 endpoint, uint16 clusterID, uint16 attrID, uint8 dataType, void *attrData);
+extern void zclReportBatch_Flush(void);
+
+#endif /* REPORT_BATCH_H */
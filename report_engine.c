@@ -0,0 +1,442 @@
+#include "OSAL.h"
+#include "zcl.h"
+#include "debug_print.h"
+#include "report_batch.h"
+#include "zapp_task.h"
+#include "zapp_timer.h"
+
+#include "report_engine.h"
+
+/*********************************************************************
+ * TYPEDEFS
+ */
+typedef struct
+{
+  uint8 module;       // ENERGY_MODULE_* reports are accounted to
+  uint8 endpoint;
+  uint16 clusterID;
+  uint16 attrID;
+  uint8 dataType;
+  void *value;
+  uint16 minIntervalS;
+  uint16 maxIntervalS;
+  uint32 reportableChange;
+  uint32 reported;    // last reported value, sign extended
+  uint32 reportedAt;
+} reportEngineEntry_t;
+
+/*********************************************************************
+ * CONSTANTS
+ */
+
+#define REPORT_ENGINE_NO_TASK 0xFF
+#define REPORT_ENGINE_NO_WAIT 0xFFFFFFFF
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+static uint8  reportEngine_TaskId = REPORT_ENGINE_NO_TASK;
+static uint16 reportEngine_Event = 0;
+
+static reportEngineEntry_t reportEngine[REPORT_ENGINE_ATTRS];
+static uint8 reportEngine_Count = 0;
+
+/*********************************************************************
+ * LOCAL PROTOTYPES
+ */
+static reportEngineEntry_t *zclReportEngineFind(uint8 endpoint, uint16 clusterID, uint16 attrID);
+static uint32 zclReportEngineValue(const reportEngineEntry_t *entry);
+static void zclReportEngineSend(reportEngineEntry_t *entry, uint32 value, uint32 now);
+static uint32 zclReportEngineCheck(reportEngineEntry_t *entry, uint32 now);
+static uint8 zclReportEngineConfigure(uint8 endpoint, uint16 clusterID, uint16 attrID, uint8 dataType,
+                                      uint16 minIntervalS, uint16 maxIntervalS, uint32 reportableChange);
+
+/*********************************************************************
+ * LOCAL FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      zclReportEngineFind
+ *
+ * @brief   Find registered attribute
+ *
+ * @param   endpoint - endpoint
+ * @param   clusterID - cluster ID
+ * @param   attrID - attribute ID
+ *
+ * @return  registered attribute, NULL if not found
+ */
+static reportEngineEntry_t *zclReportEngineFind(uint8 endpoint, uint16 clusterID, uint16 attrID)
+{
+  uint8 i;
+
+  for (i = 0; i < reportEngine_Count; i++)
+  {
+    reportEngineEntry_t *entry = &reportEngine[i];
+
+    if (entry->endpoint == endpoint && entry->clusterID == clusterID && entry->attrID == attrID)
+      return entry;
+  }
+  return NULL;
+}
+
+/*********************************************************************
+ * @fn      zclReportEngineValue
+ *
+ * @brief   Read attribute value, signed types are sign extended
+ *
+ * @param   entry - registered attribute
+ *
+ * @return  attribute value
+ */
+static uint32 zclReportEngineValue(const reportEngineEntry_t *entry)
+{
+  uint8 len = zclGetDataTypeLength(entry->dataType);
+  uint32 value = 0;
+
+  // the target is little endian, so are ZCL values
+  osal_memcpy(&value, entry->value, len);
+  if (entry->dataType >= ZCL_DATATYPE_INT8 && entry->dataType <= ZCL_DATATYPE_INT32 &&
+      len < 4 && (value & ((uint32)1 << (len * 8 - 1))))
+  {
+    value |= (uint32)0xFFFFFFFF << (len * 8);
+  }
+  return value;
+}
+
+/*********************************************************************
+ * @fn      zclReportEngineSend
+ *
+ * @brief   Queue attribute report and restart its intervals
+ *
+ * @param   entry - registered attribute
+ * @param   value - current value
+ * @param   now - current system clock
+ *
+ * @return  none
+ */
+static void zclReportEngineSend(reportEngineEntry_t *entry, uint32 value, uint32 now)
+{
+  zclReportBatch_Add(entry->module, entry->endpoint, entry->clusterID, entry->attrID, entry->dataType, entry->value);
+  entry->reported = value;
+  entry->reportedAt = now;
+
+  DBG_TRACE(DEBUG_MODULE_REPORTING, "REP: 0x%04X/0x%04X@%d = %ld\r\n",
+            entry->clusterID, entry->attrID, entry->endpoint, value);
+}
+
+/*********************************************************************
+ * @fn      zclReportEngineCheck
+ *
+ * @brief   Queue report of the attribute if it is due
+ *
+ * @param   entry - registered attribute
+ * @param   now - current system clock
+ *
+ * @return  milliseconds until the attribute has to be checked again,
+ *          REPORT_ENGINE_NO_WAIT if there is nothing to wait for
+ */
+static uint32 zclReportEngineCheck(reportEngineEntry_t *entry, uint32 now)
+{
+  uint32 value = zclReportEngineValue(entry);
+  uint32 minMs = (uint32)entry->minIntervalS * 1000;
+  uint32 maxMs = (uint32)entry->maxIntervalS * 1000;
+  uint32 early = MIN(maxMs >> 3, REPORT_ENGINE_SLACK_MS);
+  uint32 elapsed = now - entry->reportedAt;
+  uint32 wait = REPORT_ENGINE_NO_WAIT;
+  bool changed;
+
+  if (entry->maxIntervalS == REPORT_ENGINE_OFF)
+    return REPORT_ENGINE_NO_WAIT;
+
+  if (zclAnalogDataType(entry->dataType))
+  {
+    bool up = (entry->dataType >= ZCL_DATATYPE_INT8 && entry->dataType <= ZCL_DATATYPE_INT32) ?
+              (int32)value > (int32)entry->reported : value > entry->reported;
+    uint32 delta = up ? value - entry->reported : entry->reported - value;
+
+    changed = delta != 0 && delta >= entry->reportableChange;
+  }
+  else
+  {
+    changed = value != entry->reported;
+  }
+
+  if ((changed && elapsed >= minMs) || (maxMs != 0 && elapsed + early >= maxMs))
+  {
+    zclReportEngineSend(entry, value, now);
+    elapsed = 0;
+    changed = FALSE;
+  }
+
+  if (changed)
+    wait = minMs - elapsed;
+  if (maxMs != 0 && maxMs - early - elapsed < wait)
+    wait = maxMs - early - elapsed;
+  return wait;
+}
+
+/*********************************************************************
+ * @fn      zclReportEngineConfigure
+ *
+ * @brief   Change reporting configuration of registered attribute
+ *
+ * @param   see zclReportEngine_Configure
+ *
+ * @return  ZCL status
+ */
+static uint8 zclReportEngineConfigure(uint8 endpoint, uint16 clusterID, uint16 attrID, uint8 dataType,
+                                      uint16 minIntervalS, uint16 maxIntervalS, uint32 reportableChange)
+{
+  reportEngineEntry_t *entry = zclReportEngineFind(endpoint, clusterID, attrID);
+
+  if (entry == NULL)
+    return ZCL_STATUS_UNSUPPORTED_ATTRIBUTE;
+  if (dataType != entry->dataType)
+    return ZCL_STATUS_INVALID_DATA_TYPE;
+  if (maxIntervalS != 0 && maxIntervalS != REPORT_ENGINE_OFF && maxIntervalS < minIntervalS)
+    return ZCL_STATUS_INVALID_VALUE;
+
+  entry->minIntervalS = minIntervalS;
+  entry->maxIntervalS = maxIntervalS;
+  entry->reportableChange = reportableChange;
+
+  DBG_INFO(DEBUG_MODULE_REPORTING, "REP: 0x%04X/0x%04X@%d %u..%u s\r\n",
+           clusterID, attrID, endpoint, minIntervalS, maxIntervalS);
+  return ZCL_STATUS_SUCCESS;
+}
+
+/*********************************************************************
+ * GLOBAL FUNCTIONS
+ */
+
+/*********************************************************************
+ * @fn      zclReportEngine_Init
+ *
+ * @brief   Enable timed reports. The library task then calls
+ *          zclReportEngine_Check when minimum interval of a pending
+ *          change runs out or maximum interval is due. Without it
+ *          attributes are checked only on zclReportEngine_Check calls.
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void zclReportEngine_Init(void)
+{
+  if (reportEngine_TaskId == REPORT_ENGINE_NO_TASK)
+  {
+    reportEngine_TaskId = zAppTask_Id;
+    reportEngine_Event = zAppTask_AllocEvent(zclReportEngine_Check);
+  }
+}
+
+/*********************************************************************
+ * @fn      zclReportEngine_Add
+ *
+ * @brief   Register attribute for reporting. The current value is
+ *          taken as reported, so that a change is reported right away
+ *          and the first heartbeat follows in maximum interval.
+ *
+ * @param   module - ENERGY_MODULE_* reports are accounted to
+ * @param   endpoint - source endpoint
+ * @param   clusterID - cluster ID
+ * @param   attrID - attribute ID
+ * @param   dataType - attribute data type, up to 32 bits
+ * @param   value - pointer to the attribute value, has to stay valid
+ * @param   minIntervalS - minimum reporting interval, seconds
+ * @param   maxIntervalS - maximum reporting interval, seconds,
+ *                         0 for no heartbeats, REPORT_ENGINE_OFF
+ *                         to disable
+ * @param   reportableChange - minimum change reported, analog types
+ *
+ * @return  FALSE if the data type is not supported or there is no room
+ */
+bool zclReportEngine_Add(uint8 module, uint8 endpoint, uint16 clusterID, uint16 attrID, uint8 dataType,
+                         void *value, uint16 minIntervalS, uint16 maxIntervalS, uint32 reportableChange)
+{
+  reportEngineEntry_t *entry = zclReportEngineFind(endpoint, clusterID, attrID);
+  uint8 len = zclGetDataTypeLength(dataType);
+
+  if (len == 0 || len > 4)
+    return FALSE;
+  if (entry == NULL)
+  {
+    if (reportEngine_Count == REPORT_ENGINE_ATTRS)
+    {
+      DBG_ERROR(DEBUG_MODULE_REPORTING, "REP: no room for 0x%04X/0x%04X@%d\r\n", clusterID, attrID, endpoint);
+      return FALSE;
+    }
+    entry = &reportEngine[reportEngine_Count++];
+  }
+
+  entry->module = module;
+  entry->endpoint = endpoint;
+  entry->clusterID = clusterID;
+  entry->attrID = attrID;
+  entry->dataType = dataType;
+  entry->value = value;
+  entry->minIntervalS = minIntervalS;
+  entry->maxIntervalS = maxIntervalS;
+  entry->reportableChange = reportableChange;
+  entry->reported = zclReportEngineValue(entry);
+  entry->reportedAt = osal_GetSystemClock() - (uint32)minIntervalS * 1000;
+
+  zclReportEngine_Check();
+  return TRUE;
+}
+
+/*********************************************************************
+ * @fn      zclReportEngine_Configure
+ *
+ * @brief   Change reporting configuration of registered attribute,
+ *          as Configure Reporting command does
+ *
+ * @param   endpoint - endpoint
+ * @param   clusterID - cluster ID
+ * @param   attrID - attribute ID
+ * @param   dataType - attribute data type, has to match the registered
+ * @param   minIntervalS - minimum reporting interval, seconds
+ * @param   maxIntervalS - maximum reporting interval, seconds
+ * @param   reportableChange - minimum change reported, analog types
+ *
+ * @return  ZCL status
+ */
+uint8 zclReportEngine_Configure(uint8 endpoint, uint16 clusterID, uint16 attrID, uint8 dataType,
+                                uint16 minIntervalS, uint16 maxIntervalS, uint32 reportableChange)
+{
+  uint8 status = zclReportEngineConfigure(endpoint, clusterID, attrID, dataType,
+                                          minIntervalS, maxIntervalS, reportableChange);
+
+  if (status == ZCL_STATUS_SUCCESS)
+    zclReportEngine_Check();
+  return status;
+}
+
+/*********************************************************************
+ * @fn      zclReportEngine_Force
+ *
+ * @brief   Report all registered attributes of the cluster now,
+ *          regardless of change and minimum interval
+ *
+ * @param   endpoint - endpoint
+ * @param   clusterID - cluster ID
+ *
+ * @return  none
+ */
+void zclReportEngine_Force(uint8 endpoint, uint16 clusterID)
+{
+  uint32 now = osal_GetSystemClock();
+  uint8 i;
+
+  for (i = 0; i < reportEngine_Count; i++)
+  {
+    reportEngineEntry_t *entry = &reportEngine[i];
+
+    if (entry->endpoint == endpoint && entry->clusterID == clusterID && entry->maxIntervalS != REPORT_ENGINE_OFF)
+      zclReportEngineSend(entry, zclReportEngineValue(entry), now);
+  }
+  zclReportEngine_Check();
+}
+
+/*********************************************************************
+ * @fn      zclReportEngine_Check
+ *
+ * @brief   Report registered attributes that are due, call after
+ *          updating them
+ *
+ * @param   none
+ *
+ * @return  none
+ */
+void zclReportEngine_Check(void)
+{
+  uint32 now = osal_GetSystemClock();
+  uint32 wait = REPORT_ENGINE_NO_WAIT;
+  uint8 i;
+
+  for (i = 0; i < reportEngine_Count; i++)
+  {
+    uint32 w = zclReportEngineCheck(&reportEngine[i], now);
+
+    if (w < wait)
+      wait = w;
+  }
+
+  if (reportEngine_TaskId == REPORT_ENGINE_NO_TASK)
+    return;
+  if (wait == REPORT_ENGINE_NO_WAIT)
+    zAppTimer_Stop(reportEngine_TaskId, reportEngine_Event);
+  else
+    zAppTimer_Start(reportEngine_TaskId, reportEngine_Event, wait, MIN(wait >> 3, REPORT_ENGINE_SLACK_MS));
+}
+
+#ifdef ZCL_REPORT_CONFIGURING_DEVICE
+/*********************************************************************
+ * @fn      zclReportEngine_ProcessInConfigReportCmd
+ *
+ * @brief   Apply Configure Reporting command to the registered
+ *          attributes and respond to it. Call from the application
+ *          ZCL_INCOMING_MSG handler.
+ *
+ * @param   pInMsg - incoming message
+ *
+ * @return  TRUE if the message was Configure Reporting command
+ */
+uint8 zclReportEngine_ProcessInConfigReportCmd(zclIncomingMsg_t *pInMsg)
+{
+  zclCfgReportCmd_t *cfgReportCmd = (zclCfgReportCmd_t *)pInMsg->attrCmd;
+  zclCfgReportRspCmd_t *rsp;
+  uint8 i;
+
+  if (pInMsg->zclHdr.commandID != ZCL_CMD_CONFIG_REPORT)
+    return FALSE;
+
+  rsp = (zclCfgReportRspCmd_t *)osal_mem_alloc(sizeof(zclCfgReportRspCmd_t) +
+                                               MAX(cfgReportCmd->numAttr, 1) * sizeof(zclCfgReportStatus_t));
+  if (rsp == NULL)
+  {
+    DBG_ERROR(DEBUG_MODULE_REPORTING, "REP: no memory for config response\r\n");
+    return TRUE;
+  }
+
+  // only failed records are listed, all succeeded is a single SUCCESS record
+  rsp->numAttr = 0;
+  for (i = 0; i < cfgReportCmd->numAttr; i++)
+  {
+    zclCfgReportRec_t *rec = &cfgReportCmd->attrList[i];
+    uint8 status = ZCL_STATUS_UNREPORTABLE_ATTRIBUTE;
+
+    if (rec->direction == ZCL_SEND_ATTR_REPORTS)
+    {
+      uint32 change = 0;
+
+      if (zclAnalogDataType(rec->dataType) && rec->reportableChange != NULL)
+        osal_memcpy(&change, rec->reportableChange, MIN(zclGetDataTypeLength(rec->dataType), 4));
+      status = zclReportEngineConfigure(pInMsg->endPoint, pInMsg->clusterId, rec->attrID, rec->dataType,
+                                        rec->minReportInt, rec->maxReportInt, change);
+    }
+    if (status != ZCL_STATUS_SUCCESS)
+    {
+      rsp->attrList[rsp->numAttr].status = status;
+      rsp->attrList[rsp->numAttr].direction = rec->direction;
+      rsp->attrList[rsp->numAttr].attrID = rec->attrID;
+      rsp->numAttr++;
+    }
+  }
+  if (rsp->numAttr == 0)
+  {
+    rsp->numAttr = 1;
+    rsp->attrList[0].status = ZCL_STATUS_SUCCESS;
+    rsp->attrList[0].direction = ZCL_SEND_ATTR_REPORTS;
+    rsp->attrList[0].attrID = 0;
+  }
+
+  zcl_SendConfigReportRspCmd(pInMsg->endPoint, &pInMsg->srcAddr, pInMsg->clusterId, rsp,
+                             ZCL_FRAME_SERVER_CLIENT_DIR, TRUE, pInMsg->zclHdr.transSeqNum);
+  osal_mem_free(rsp);
+
+  zclReportEngine_Check();
+  return TRUE;
+}
+#endif /* ZCL_REPORT_CONFIGURING_DEVICE */
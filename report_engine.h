@@ -0,0 +1,40 @@
+#ifndef REPORT_ENGINE_H
+#define REPORT_ENGINE_H
+
+#include "hal_defs.h"
+#include "zcl.h"
+
+/*
+ * Change-based attribute reporting for builds without BDB_REPORTING,
+ * following ZCL Configure Reporting semantics. A registered attribute is
+ * reported once its value changed, by at least reportable change for
+ * analog types, and minimum interval passed since the last report. With
+ * a nonzero maximum interval it is reported at least that often even if
+ * unchanged, maximum interval of REPORT_ENGINE_OFF stops its reports.
+ * Reports go through report_batch, attributes due together share a frame.
+ * Values up to 32 bits are supported.
+ */
+
+#ifndef REPORT_ENGINE_ATTRS
+#define REPORT_ENGINE_ATTRS     6
+#endif /* REPORT_ENGINE_ATTRS */
+
+// heartbeats may go this early to share a wakeup with other timers
+#ifndef REPORT_ENGINE_SLACK_MS
+#define REPORT_ENGINE_SLACK_MS  2000
+#endif /* REPORT_ENGINE_SLACK_MS */
+
+#define REPORT_ENGINE_OFF       0xFFFF  // maximum interval disabling reports
+
+extern void zclReportEngine_Init(void);
+extern bool zclReportEngine_Add(uint8 module, uint8 endpoint, uint16 clusterID, uint16 attrID, uint8 dataType,
+                                void *value, uint16 minIntervalS, uint16 maxIntervalS, uint32 reportableChange);
+extern uint8 zclReportEngine_Configure(uint8 endpoint, uint16 clusterID, uint16 attrID, uint8 dataType,
+                                       uint16 minIntervalS, uint16 maxIntervalS, uint32 reportableChange);
+extern void zclReportEngine_Force(uint8 endpoint, uint16 clusterID);
+extern void zclReportEngine_Check(void);
+#ifdef ZCL_REPORT_CONFIGURING_DEVICE
+extern uint8 zclReportEngine_ProcessInConfigReportCmd(zclIncomingMsg_t *pInMsg);
+#endif /* ZCL_REPORT_CONFIGURING_DEVICE */
+
+#endif /* REPORT_ENGINE_H */
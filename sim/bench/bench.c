@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+
+typedef struct
+{
+    char name[BENCH_NAME_LEN];
+    uint32 value;
+} benchMetric_t;
+
+static benchMetric_t benchMetrics[BENCH_METRICS];
+static uint8 benchMetricCount = 0;
+
+/**************************************************************************************************
+ * @fn      benchMetric
+ *
+ * @brief   Print a figure and keep it for benchCompare
+ *
+ * @param   scenario - scenario or kernel, the name prefix
+ * @param   name - figure
+ * @param   value - figure value
+ *
+ * @return  None
+ **************************************************************************************************/
+void benchMetric(const char *scenario, const char *name, uint32 value)
+{
+    benchMetric_t *metric = &benchMetrics[benchMetricCount++];
+
+    snprintf(metric->name, sizeof(metric->name), "%s.%s", scenario, name);
+    metric->value = value;
+    printf("%-24s %u\n", metric->name, value);
+}
+
+/**************************************************************************************************
+ * @fn      benchCompare
+ *
+ * @brief   Compare the figures with a baseline file
+ *
+ * @param   path - baseline, "name value" lines, others are ignored
+ *
+ * @return  number of figures above the baseline
+ **************************************************************************************************/
+uint32 benchCompare(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    char line[128];
+    char name[BENCH_NAME_LEN];
+    uint32 value;
+    uint32 worse = 0;
+    uint8 found = 0;
+
+    if (file == NULL)
+    {
+        perror(path);
+        return 1;
+    }
+    while (fgets(line, sizeof(line), file))
+    {
+        if (line[0] == '#' || sscanf(line, "%31s %u", name, &value) != 2)
+        {
+            continue;
+        }
+        for (uint8 i = 0; i < benchMetricCount; i++)
+        {
+            if (strcmp(benchMetrics[i].name, name) == 0)
+            {
+                found++;
+                if (benchMetrics[i].value > value)
+                {
+                    printf("# %s: %u, baseline %u\n", name, benchMetrics[i].value, value);
+                    worse++;
+                }
+                else if (benchMetrics[i].value < value)
+                {
+                    printf("# %s: %u, baseline %u, improved\n", name, benchMetrics[i].value, value);
+                }
+                break;
+            }
+        }
+    }
+    fclose(file);
+    if (found != benchMetricCount)
+    {
+        printf("# %s: %u of %u figures, update the baseline\n", path, found, benchMetricCount);
+    }
+    return worse;
+}
@@ -0,0 +1,19 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "hal_types.h"
+
+/*
+ * Figures of the host benchmarks. Every figure is printed as a "name
+ * value" line and compared with a stored baseline, any figure above it
+ * fails the run. Summary lines start with '#', the output of a run is a
+ * baseline as it is.
+ */
+
+#define BENCH_METRICS    64
+#define BENCH_NAME_LEN   32
+
+extern void benchMetric(const char *scenario, const char *name, uint32 value);
+extern uint32 benchCompare(const char *path);
+
+#endif /* BENCH_H */
@@ -0,0 +1,355 @@
+#include <stdio.h>
+
+// built in, for the static percentage and filter kernels
+#include "../../battery.c"
+
+#include "debug_print.h"
+#include "fixedpoint.h"
+#include "hal_mcu.h"
+#include "utils.h"
+
+/*
+ * Figures per kernel and configuration: the oversampled ADC readout of
+ * utils.c for every resolution and sample count around BAT_ADC_SAMPLES,
+ * FP_ADC2MV for every BAT_ADC_RESOLUTION, the battery percentage for
+ * every bundled profile, the battery filter for a first sample, short,
+ * hour and longest gaps, and the tokenized debug formatter for text,
+ * int, long and mixed arguments.
+ *
+ * Built for the host, the figures are the time the simulation charges
+ * ("us", the ADC conversions) and the UART bytes ("bytes", the debug
+ * records), compared with a stored baseline given as the argument, see
+ * bench.h. The host time per call is printed as a summary only.
+ *
+ * Built with SDCC and BENCH_8051 for the s51 simulator, the figures are
+ * the 8051 machine cycles ("cycles") and the stack bytes ("stack") of a
+ * call, printed on the serial port. tools/bench8051.py runs it, adds the
+ * code size of the kernel functions and compares with the baseline.
+ * HalAdcRead answers at once there, the cycles are the CPU cost of the
+ * readout around the conversions.
+ */
+
+#define BENCH_FILTER_MV  3000
+#define BENCH_RAW        0x1A2B
+
+typedef void (*benchFn_t)(void);
+
+static const uint8 benchSamples[] = { 1, 4, BAT_ADC_SAMPLES, 16 };
+static const char *const benchProfiles[] = { "aaa2s", "aa2s", "cr2032", "cr2450", "lisocl2" };
+
+// arguments of the kernel being measured
+static uint8 benchResolution;
+static uint8 benchSampleCount;
+static const bat_profile_t *benchProfile;
+static uint32 benchGapUnits;
+static uint16 benchResult;
+
+#if defined(BENCH_8051)
+/*
+ * Timer 0 counts machine cycles, timer 1 clocks the serial port. Timer 0
+ * shares its vector and enable bit with the CC2530 ADC interrupt, so the
+ * asynchronous readout is not measured and interrupts stay off.
+ */
+__sfr __at(0x81) SP;
+__sfr __at(0x89) TMOD;
+__sfr __at(0x8A) TL0;
+__sfr __at(0x8C) TH0;
+__sfr __at(0x8D) TH1;
+__sfr __at(0x98) SCON;
+__sfr __at(0x99) SBUF;
+__sbit __at(0x8C) TR0;
+__sbit __at(0x8D) TF0;
+__sbit __at(0x8E) TR1;
+__sbit __at(0x99) TI;
+
+#define BENCH_STACK_PAINT  0x5A
+#define BENCH_NAME_LEN     32
+
+static uint32 benchOverhead = 0;
+
+int putchar(int c)
+{
+    while (!TI)
+        ;
+    TI = 0;
+    SBUF = c;
+    return c;
+}
+
+// idata above the stack pointer, the kernel's stack lands there
+static void benchStackPaint(void)
+{
+    uint8 addr = SP;
+
+    while (++addr)
+    {
+        *(__idata uint8 *)addr = BENCH_STACK_PAINT;
+    }
+}
+
+static uint8 benchStackDepth(uint8 base)
+{
+    uint8 addr = 0xFF;
+
+    while (addr > base && *(__idata uint8 *)addr == BENCH_STACK_PAINT)
+    {
+        addr--;
+    }
+    return addr - base;
+}
+
+static uint32 benchCycles(benchFn_t kernel)
+{
+    TR0 = 0;
+    TF0 = 0;
+    TH0 = 0;
+    TL0 = 0;
+    TR0 = 1;
+    kernel();
+    TR0 = 0;
+    // a kernel is well below two timer periods
+    return ((uint32)TF0 << 16) | ((uint16)TH0 << 8) | TL0;
+}
+
+static void benchNone(void)
+{
+}
+#else
+#include <time.h>
+
+#include "bench.h"
+#include "sim.h"
+
+static uint32 benchHostNs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32)now.tv_sec * 1000000000u + (uint32)now.tv_nsec;
+}
+
+#define BENCH_HOST_REPEAT  1000
+#endif /* BENCH_8051 */
+
+/**************************************************************************************************
+ * @fn      benchRun
+ *
+ * @brief   Measure a kernel and print its figures
+ *
+ * @param   name - kernel and configuration
+ * @param   setup - puts the kernel state in place before each call, or NULL
+ * @param   kernel - kernel call
+ *
+ * @return  None
+ **************************************************************************************************/
+static void benchRun(const char *name, benchFn_t setup, benchFn_t kernel)
+{
+#if defined(BENCH_8051)
+    uint32 cycles;
+    uint8 base;
+
+    if (setup)
+    {
+        setup();
+    }
+    benchStackPaint();
+    base = SP;
+    cycles = benchCycles(kernel) - benchOverhead;
+    printf("%s.cycles %lu\n", name, (unsigned long)cycles);
+    printf("%s.stack %u\n", name, (unsigned)benchStackDepth(base));
+#else
+    const uint8 *data;
+    uint32 us;
+    uint32 ns = 0;
+    uint16 bytes;
+
+    sim_UartClear();
+    if (setup)
+    {
+        setup();
+    }
+    us = sim_NowUs();
+    kernel();
+    benchMetric(name, "us", sim_NowUs() - us);
+    bytes = sim_UartCapture(&data);
+    if (bytes)
+    {
+        benchMetric(name, "bytes", bytes);
+    }
+
+    for (uint16 i = 0; i < BENCH_HOST_REPEAT; i++)
+    {
+        uint32 start;
+
+        sim_UartClear();
+        if (setup)
+        {
+            setup();
+        }
+        start = benchHostNs();
+        kernel();
+        ns += benchHostNs() - start;
+    }
+    printf("# %-22s host %u ns\n", name, ns / BENCH_HOST_REPEAT);
+#endif /* BENCH_8051 */
+}
+
+/*********************************************************************
+ * KERNELS
+ */
+
+static void kernelAdc(void)
+{
+    benchResult = adcReadOversampled(HAL_ADC_CHANNEL_VDD, benchResolution, HAL_ADC_REF_125V, benchSampleCount);
+}
+
+// battery.c converts with a constant BAT_ADC_RESOLUTION
+static void kernelAdc2Mv8(void)
+{
+    benchResult = FP_ADC2MV(BENCH_RAW >> 6, ADC_VREF_MV, HAL_ADC_RESOLUTION_8);
+}
+
+static void kernelAdc2Mv10(void)
+{
+    benchResult = FP_ADC2MV(BENCH_RAW >> 4, ADC_VREF_MV, HAL_ADC_RESOLUTION_10);
+}
+
+static void kernelAdc2Mv12(void)
+{
+    benchResult = FP_ADC2MV(BENCH_RAW >> 2, ADC_VREF_MV, HAL_ADC_RESOLUTION_12);
+}
+
+static void kernelAdc2Mv14(void)
+{
+    benchResult = FP_ADC2MV(BENCH_RAW, ADC_VREF_MV, HAL_ADC_RESOLUTION_14);
+}
+
+// just below the last point, every segment is looked at
+static void kernelPercentage(void)
+{
+    benchResult = zclBatteryPercentage(benchProfile, benchProfile->points[benchProfile->count - 1].mV - 1);
+}
+
+// table squared on the first use
+static void setupFilterFirst(void)
+{
+    zclBattery_FilterK[0] = 0;
+    zclBattery_FilterQ4 = BENCH_FILTER_MV << 4;
+    zclBattery_FilterTime = osal_GetSystemClock() - BAT_FILTER_UNIT_MS;
+}
+
+static void setupFilterGap(void)
+{
+    zclBattery_FilterQ4 = BENCH_FILTER_MV << 4;
+    zclBattery_FilterTime = osal_GetSystemClock() - benchGapUnits * BAT_FILTER_UNIT_MS;
+}
+
+static void kernelFilter(void)
+{
+    benchResult = zclBatteryFilter(BENCH_FILTER_MV - 100);
+}
+
+static void kernelDbgText(void)
+{
+    DBG("BAT: bench\r\n");
+}
+
+static void kernelDbgInt(void)
+{
+    DBGF("BAT: %d ADC %d mV\r\n", benchResult, (uint16)BENCH_FILTER_MV);
+}
+
+static void kernelDbgLong(void)
+{
+    DBGF("BAT: %ld ms, interval %ld ms\r\n", (uint32)BAT_FILTER_UNIT_MS, benchGapUnits);
+}
+
+static void kernelDbgMixed(void)
+{
+    DBGF("BAT: %d mV %d %ld %d\r\n", benchResult, (uint16)BENCH_RAW, benchGapUnits, (uint16)BENCH_FILTER_MV);
+}
+
+static void benchKernels(void)
+{
+    static const uint32 gaps[] = { 1, 225, 0xFFFF };   // 16 s, an hour, the longest
+    char name[BENCH_NAME_LEN];
+    uint8 i;
+
+    for (benchResolution = HAL_ADC_RESOLUTION_8; benchResolution <= HAL_ADC_RESOLUTION_14; benchResolution++)
+    {
+        for (i = 0; i < COUNT_OF(benchSamples); i++)
+        {
+            benchSampleCount = benchSamples[i];
+            sprintf(name, "adc.r%u.s%u", (unsigned)(8 + 2 * (benchResolution - HAL_ADC_RESOLUTION_8)),
+                    (unsigned)benchSampleCount);
+            benchRun(name, NULL, kernelAdc);
+        }
+    }
+    benchRun("adc2mv.r8", NULL, kernelAdc2Mv8);
+    benchRun("adc2mv.r10", NULL, kernelAdc2Mv10);
+    benchRun("adc2mv.r12", NULL, kernelAdc2Mv12);
+    benchRun("adc2mv.r14", NULL, kernelAdc2Mv14);
+
+    for (i = 0; i < COUNT_OF(benchProfiles); i++)
+    {
+        benchProfile = &bat_profiles[i];
+        sprintf(name, "percentage.%s", benchProfiles[i]);
+        benchRun(name, NULL, kernelPercentage);
+    }
+
+    benchRun("filter.first", setupFilterFirst, kernelFilter);
+    for (i = 0; i < COUNT_OF(gaps); i++)
+    {
+        benchGapUnits = gaps[i];
+        sprintf(name, "filter.u%lu", (unsigned long)benchGapUnits);
+        benchRun(name, setupFilterGap, kernelFilter);
+    }
+
+    benchRun("dbg.text", NULL, kernelDbgText);
+    benchRun("dbg.int2", NULL, kernelDbgInt);
+    benchRun("dbg.long2", NULL, kernelDbgLong);
+    benchRun("dbg.mixed4", NULL, kernelDbgMixed);
+}
+
+#if defined(BENCH_8051)
+void main(void)
+{
+    HAL_DISABLE_INTERRUPTS();
+    // serial mode 1, timer 1 auto reload, timer 0 16 bit
+    SCON = 0x50;
+    TMOD = 0x21;
+    TH1 = 0xFF;
+    TR1 = 1;
+    TI = 1;
+
+    benchOverhead = benchCycles(benchNone);
+    printf("# kernel_bench 8051, call overhead %lu cycles\n", (unsigned long)benchOverhead);
+    benchKernels();
+
+    // s51 stops at the undefined opcode
+    __asm
+        .db 0xA5
+    __endasm;
+}
+#else
+static const char *baselinePath = NULL;
+
+// the figures stay in the boot's process, so they are compared there
+static void bootKernels(void)
+{
+    sim_InitTasks(NULL);
+    benchKernels();
+    sim_User()[0] = baselinePath != NULL ? benchCompare(baselinePath) : 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1)
+    {
+        baselinePath = argv[1];
+    }
+    sim_Reset(1);
+    SIM_CHECK(sim_Boot(bootKernels) == SIM_BOOT_OK);
+    return sim_Failures() || sim_User()[0] ? 1 : 0;
+}
+#endif /* BENCH_8051 */
@@ -0,0 +1,139 @@
+#include "OSAL.h"
+#include "OSAL_PwrMgr.h"
+#include "OnBoard.h"
+#include "hal_adc.h"
+#include "hal_uart.h"
+
+#include "report_batch.h"
+#include "report_engine.h"
+#include "zapp_task.h"
+
+/*
+ * What the kernels of kernel_bench call outside of them, for the SDCC
+ * build. The HAL answers at once and the stack calls do nothing, so the
+ * cycles counted are the kernels' own.
+ */
+
+#define BENCH_CLOCK_MS   0x01000000
+
+uint8 zAppTask_Id = 0;
+
+uint16 HalAdcRead(uint8 channel, uint8 resolution)
+{
+    (void)channel;
+    return 0x2000 >> (8 - 2 * (resolution - HAL_ADC_RESOLUTION_8));
+}
+
+void HalAdcSetReference(uint8 reference)
+{
+    (void)reference;
+}
+
+void HalUARTInit(void)
+{
+}
+
+uint8 HalUARTOpen(uint8 port, halUARTCfg_t *config)
+{
+    (void)port;
+    (void)config;
+    return HAL_UART_SUCCESS;
+}
+
+uint16 HalUARTWrite(uint8 port, uint8 *pBuffer, uint16 length)
+{
+    (void)port;
+    (void)pBuffer;
+    return length;
+}
+
+void MicroWait(uint16 timeout)
+{
+    (void)timeout;
+}
+
+uint32 osal_GetSystemClock(void)
+{
+    return BENCH_CLOCK_MS;
+}
+
+uint8 osal_set_event(uint8 task_id, uint16 event_flag)
+{
+    (void)task_id;
+    (void)event_flag;
+    return ZSUCCESS;
+}
+
+uint8 osal_pwrmgr_task_state(uint8 task_id, uint8 state)
+{
+    (void)task_id;
+    (void)state;
+    return ZSUCCESS;
+}
+
+uint8 osal_nv_item_init(uint16 id, uint16 len, void *buf)
+{
+    (void)id;
+    (void)len;
+    (void)buf;
+    return ZSUCCESS;
+}
+
+uint8 osal_nv_read(uint16 id, uint16 offset, uint16 len, void *buf)
+{
+    (void)id;
+    (void)offset;
+    (void)len;
+    (void)buf;
+    return NV_OPER_FAILED;
+}
+
+uint8 osal_nv_write(uint16 id, uint16 offset, uint16 len, void *buf)
+{
+    (void)id;
+    (void)offset;
+    (void)len;
+    (void)buf;
+    return ZSUCCESS;
+}
+
+uint16 zAppTask_AllocEvent(zAppEventHandler_t handler)
+{
+    (void)handler;
+    return 0;
+}
+
+void zclReportBatch_Add(uint8 module, uint8 endpoint, uint16 clusterID, uint16 attrID, uint8 dataType, void *attrData)
+{
+    (void)module;
+    (void)endpoint;
+    (void)clusterID;
+    (void)attrID;
+    (void)dataType;
+    (void)attrData;
+}
+
+bool zclReportEngine_Add(uint8 module, uint8 endpoint, uint16 clusterID, uint16 attrID, uint8 dataType,
+                         void *value, uint16 minIntervalS, uint16 maxIntervalS, uint32 reportableChange)
+{
+    (void)module;
+    (void)endpoint;
+    (void)clusterID;
+    (void)attrID;
+    (void)dataType;
+    (void)value;
+    (void)minIntervalS;
+    (void)maxIntervalS;
+    (void)reportableChange;
+    return TRUE;
+}
+
+void zclReportEngine_Force(uint8 endpoint, uint16 clusterID)
+{
+    (void)endpoint;
+    (void)clusterID;
+}
+
+void zclReportEngine_Check(void)
+{
+}
@@ -0,0 +1,26 @@
+#ifndef HAL_MCU_H
+#define HAL_MCU_H
+
+#include "hal_defs.h"
+#include "hal_types.h"
+#include "ioCC2530.h"
+
+/*
+ * SDCC stand-in for kernel_bench, same macros as the Z-Stack HAL.
+ */
+
+#define HAL_MCU_CC2530
+
+typedef uint8 halIntState_t;
+
+#define HAL_ENABLE_INTERRUPTS()         st( EA = 1; )
+#define HAL_DISABLE_INTERRUPTS()        st( EA = 0; )
+#define HAL_INTERRUPTS_ARE_ENABLED()    (EA)
+
+#define HAL_ENTER_CRITICAL_SECTION(x)   st( x = EA;  HAL_DISABLE_INTERRUPTS(); )
+#define HAL_EXIT_CRITICAL_SECTION(x)    st( EA = x; )
+#define HAL_CRITICAL_STATEMENT(x)       st( halIntState_t _s; HAL_ENTER_CRITICAL_SECTION(_s); x; HAL_EXIT_CRITICAL_SECTION(_s); )
+
+#define HAL_ISR_FUNCTION(f, v)          void f(void) __interrupt(v)
+
+#endif /* HAL_MCU_H */
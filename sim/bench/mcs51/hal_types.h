@@ -0,0 +1,41 @@
+#ifndef HAL_TYPES_H
+#define HAL_TYPES_H
+
+/*
+ * SDCC stand-in for kernel_bench, ahead of the host one in include/:
+ * int is 16 bits on the 8051, uint32 is a long.
+ */
+
+typedef signed   char   int8;
+typedef unsigned char   uint8;
+typedef signed   short  int16;
+typedef unsigned short  uint16;
+typedef signed   long   int32;
+typedef unsigned long   uint32;
+typedef unsigned char   bool;
+typedef uint8           halDataAlign_t;
+
+#ifndef TRUE
+#define TRUE 1
+#endif
+
+#ifndef FALSE
+#define FALSE 0
+#endif
+
+#ifndef true
+#define true 1
+#endif
+
+#ifndef false
+#define false 0
+#endif
+
+#ifndef NULL
+#define NULL ((void *)0)
+#endif
+
+#define CODE   __code
+#define XDATA  __xdata
+
+#endif /* HAL_TYPES_H */
@@ -0,0 +1,27 @@
+#ifndef IOCC2530_H
+#define IOCC2530_H
+
+#include "hal_types.h"
+
+/*
+ * SDCC stand-in for kernel_bench, the CC2530 SFRs the kernels touch at
+ * their addresses. ADC_VECTOR is the SDCC interrupt number.
+ */
+
+__sfr __at(0x95) ST0;
+__sfr __at(0x96) ST1;
+__sfr __at(0x97) ST2;
+__sfr __at(0xB4) ADCCON1;
+__sfr __at(0xB5) ADCCON2;
+__sfr __at(0xB6) ADCCON3;
+__sfr __at(0xBA) ADCL;
+__sfr __at(0xBB) ADCH;
+__sfr __at(0xF2) APCFG;
+
+__sbit __at(0x8D) ADCIF;    // TCON.5
+__sbit __at(0xA9) ADCIE;    // IEN0.1
+__sbit __at(0xAF) EA;       // IEN0.7
+
+#define ADC_VECTOR  1       // 0x0B
+
+#endif /* IOCC2530_H */
@@ -0,0 +1,151 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ZDApp.h"
+#include "battery.h"
+#include "commissioning.h"
+#include "factory_reset.h"
+#include "report_batch.h"
+#include "utils.h"
+
+#include "bench.h"
+#include "sim.h"
+
+/*
+ * Figures of merit per scenario: wakeups, radio polls, report frames,
+ * heap peak and awake time, and the boot counter NV latency. Built
+ * twice, sim_bench_nvrecord keeps the boot counter in nv_record.
+ *
+ * The simulation is deterministic, the figures are compared with a
+ * stored baseline given as the argument, see bench.h.
+ */
+
+#define BENCH_BOOTS      600     // nv_record fills a page in about 250
+#define BENCH_BOOT_MS    12000   // past the boot counter reset
+
+static void init(void)
+{
+    sim_InitTasks(NULL);
+    zclFactoryResetter_Init();
+    zclReportBatch_Init();
+    zclBattery_Init();
+    zclCommissioning_Init();
+}
+
+// a day on the network, battery measured at its own pace
+static void benchDay(void)
+{
+    uint32 left = 24 * 3600000UL;
+
+    init();
+    sim_Run(5000);
+    while (left)
+    {
+        uint32 step = zclBatteryInterval();
+
+        if (step > left)
+        {
+            step = left;
+        }
+        zclBatteryReport(FALSE);
+        sim_Run(step);
+        left -= step;
+    }
+}
+
+// two hours without the network, then it comes back
+static void benchOutage(void)
+{
+    init();
+    sim_Run(5000);
+    sim_NetPresent(FALSE);
+    sim_NetParentLost();
+    sim_Run(2 * 3600000UL);
+    sim_NetPresent(TRUE);
+    sim_Run(3600000UL);
+    SIM_CHECK(devState == DEV_END_DEVICE);
+}
+
+static void benchBoot(void)
+{
+    init();
+    sim_Run(BENCH_BOOT_MS);
+    sim_User()[sim_Stats()->boots % SIM_USER_WORDS] = zclFactoryResetter_BootNvTicks;
+}
+
+static int benchCmp(const void *a, const void *b)
+{
+    return *(const uint32 *)a < *(const uint32 *)b ? -1 : *(const uint32 *)a > *(const uint32 *)b;
+}
+
+static void benchPrint(const char *name)
+{
+    simStats_t *stats = sim_Stats();
+
+    printf("# %-8s wakeups %6u polls %6u tasks %6u reports %4u (%5u B) active %7u ms heap peak %4u NV writes %4u"
+           " compactions %u\n", name, stats->wakeups, stats->polls, stats->taskRuns, stats->reports, stats->reportBytes,
+           stats->activeMs, stats->heapPeak, stats->nvWrites, stats->nvCompactions);
+    benchMetric(name, "wakeups", stats->wakeups);
+    benchMetric(name, "polls", stats->polls);
+    benchMetric(name, "taskRuns", stats->taskRuns);
+    benchMetric(name, "reportBytes", stats->reportBytes);
+    benchMetric(name, "activeMs", stats->activeMs);
+    benchMetric(name, "heapPeak", stats->heapPeak);
+    benchMetric(name, "nvWrites", stats->nvWrites);
+    benchMetric(name, "flashWrites", stats->flashWrites);
+    benchMetric(name, "flashErases", stats->flashErases);
+}
+
+int main(int argc, char *argv[])
+{
+    uint32 ticks[BENCH_BOOTS];
+    uint32 sum = 0;
+    uint32 max = 0;
+    uint32 min = 0xFFFFFFFF;
+    uint32 failures;
+
+    sim_Reset(1);
+    SIM_CHECK(sim_Boot(benchDay) == SIM_BOOT_OK);
+    benchPrint("day");
+    failures = sim_Failures();
+
+    sim_Reset(1);
+    SIM_CHECK(sim_Boot(benchOutage) == SIM_BOOT_OK);
+    benchPrint("outage");
+    printf("# %-8s rejoins %u, full channel scans %u\n", "", sim_Stats()->rejoins, sim_Stats()->recoverCalls);
+    benchMetric("outage", "rejoins", sim_Stats()->rejoins);
+    benchMetric("outage", "recoverCalls", sim_Stats()->recoverCalls);
+    failures += sim_Failures();
+
+    sim_Reset(1);
+    for (uint16 i = 0; i < BENCH_BOOTS; i++)
+    {
+        SIM_CHECK(sim_Boot(benchBoot) == SIM_BOOT_OK);
+        ticks[i] = sim_User()[sim_Stats()->boots % SIM_USER_WORDS];
+        sum += ticks[i];
+        min = ticks[i] < min ? ticks[i] : min;
+        max = ticks[i] > max ? ticks[i] : max;
+    }
+    benchPrint("boots");
+    qsort(ticks, BENCH_BOOTS, sizeof(ticks[0]), benchCmp);
+    printf("# %-8s boot NV %s: min %u us, median %u us, avg %u us, max %u us over %u boots\n", "",
+#if defined(NV_RECORD_PAGE_BEG)
+           "nv_record",
+#else
+           "OSAL NV",
+#endif /* NV_RECORD_PAGE_BEG */
+           (uint32)((unsigned long long)min * 1000000 / SLEEP_TIMER_HZ),
+           (uint32)((unsigned long long)ticks[BENCH_BOOTS / 2] * 1000000 / SLEEP_TIMER_HZ),
+           (uint32)((unsigned long long)sum * 1000000 / SLEEP_TIMER_HZ / BENCH_BOOTS),
+           (uint32)((unsigned long long)max * 1000000 / SLEEP_TIMER_HZ), BENCH_BOOTS);
+    benchMetric("boots", "nvMedianTicks", ticks[BENCH_BOOTS / 2]);
+    benchMetric("boots", "nvSumTicks", sum);
+    benchMetric("boots", "nvMaxTicks", max);
+    failures += sim_Failures();
+
+    if (argc > 1)
+    {
+        failures += benchCompare(argv[1]);
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,59 @@
+#ifndef AF_H
+#define AF_H
+
+#include "ZComDef.h"
+#include "OSAL.h"
+
+/*
+ * Simulation stand-in, application framework message types.
+ */
+
+typedef enum
+{
+  afAddrNotPresent = 0,
+  afAddrGroup      = 1,
+  afAddr16Bit      = 2,
+  afAddr64Bit      = 3,
+  afAddrBroadcast  = 15
+} afAddrMode_t;
+
+#define AddrNotPresent  0
+
+typedef struct
+{
+  union
+  {
+    uint16      shortAddr;
+    ZLongAddr_t extAddr;
+  } addr;
+  afAddrMode_t addrMode;
+  uint8 endPoint;
+  uint16 panId;
+} afAddrType_t;
+
+typedef struct
+{
+  osal_event_hdr_t hdr;
+  uint16 groupId;
+  uint16 clusterId;
+  afAddrType_t srcAddr;
+  uint16 macDestAddr;
+  uint8 endPoint;
+  uint8 wasBroadcast;
+  uint8 LinkQuality;
+  uint8 correlation;
+  int8  rssi;
+  uint8 SecurityUse;
+  uint32 timestamp;
+  uint8 nwkSeqNum;
+} afIncomingMSGPacket_t;
+
+typedef struct
+{
+  osal_event_hdr_t hdr;
+  uint8 endpoint;
+  uint8 transID;
+  uint16 clusterID;
+} afDataConfirm_t;
+
+#endif /* AF_H */
@@ -0,0 +1,12 @@
+#ifndef DEBUGTRACE_H
+#define DEBUGTRACE_H
+
+#include "hal_types.h"
+
+/*
+ * Simulation stand-in, strings go to the captured UART output.
+ */
+
+extern void debug_str(uint8 *str_ptr);
+
+#endif /* DEBUGTRACE_H */
@@ -0,0 +1,12 @@
+#ifndef MT_H
+#define MT_H
+
+#include "hal_types.h"
+
+/*
+ * Simulation stand-in.
+ */
+
+extern uint8 debugThreshold;
+
+#endif /* MT_H */
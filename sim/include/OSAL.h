@@ -0,0 +1,53 @@
+#ifndef OSAL_H
+#define OSAL_H
+
+#include "hal_defs.h"
+#include "ZComDef.h"
+
+/*
+ * Simulation stand-in for the OSAL services the library uses. Timers run
+ * on the virtual clock, see sim_Run.
+ */
+
+#define SYS_EVENT_MSG               0x8000
+
+#define KEY_CHANGE                  0xC0
+#define ZDO_STATE_CHANGE            0xD1
+#define AF_DATA_CONFIRM_CMD         0xFD
+#define AF_INCOMING_MSG_CMD         0x1A
+#define ZCL_INCOMING_MSG            0x34
+
+typedef struct
+{
+  uint8  event;
+  uint8  status;
+} osal_event_hdr_t;
+
+extern uint8 *osal_msg_allocate(uint16 len);
+extern uint8 osal_msg_deallocate(uint8 *msg_ptr);
+extern uint8 osal_msg_send(uint8 destination_task, uint8 *msg_ptr);
+extern uint8 *osal_msg_receive(uint8 task_id);
+
+extern void *osal_mem_alloc(uint16 size);
+extern void osal_mem_free(void *ptr);
+
+extern uint8 osal_start_timerEx(uint8 task_id, uint16 event_id, uint32 timeout_value);
+extern uint8 osal_start_reload_timer(uint8 taskID, uint16 event_id, uint32 timeout_value);
+extern uint8 osal_stop_timerEx(uint8 task_id, uint16 event_id);
+extern uint32 osal_get_timeoutEx(uint8 task_id, uint16 event_id);
+extern uint32 osal_GetSystemClock(void);
+
+extern uint8 osal_set_event(uint8 task_id, uint16 event_flag);
+extern uint8 osal_clear_event(uint8 task_id, uint16 event_flag);
+
+extern uint8 osal_nv_item_init(uint16 id, uint16 len, void *buf);
+extern uint8 osal_nv_read(uint16 id, uint16 offset, uint16 len, void *buf);
+extern uint8 osal_nv_write(uint16 id, uint16 offset, uint16 len, void *buf);
+extern uint16 osal_nv_item_len(uint16 id);
+
+extern uint16 osal_rand(void);
+extern void *osal_memcpy(void *dst, const void *src, unsigned int len);
+extern void *osal_memset(void *dest, uint8 value, int len);
+extern uint8 osal_memcmp(const void *src1, const void *src2, unsigned int len);
+
+#endif /* OSAL_H */
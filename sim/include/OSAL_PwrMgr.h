@@ -0,0 +1,15 @@
+#ifndef OSAL_PWRMGR_H
+#define OSAL_PWRMGR_H
+
+#include "OSAL.h"
+
+/*
+ * Simulation stand-in, the device sleeps while no task holds power.
+ */
+
+#define PWRMGR_CONSERVE 0
+#define PWRMGR_HOLD     1
+
+extern uint8 osal_pwrmgr_task_state(uint8 task_id, uint8 state);
+
+#endif /* OSAL_PWRMGR_H */
@@ -0,0 +1,21 @@
+#ifndef ONBOARD_H
+#define ONBOARD_H
+
+#include "hal_mcu.h"
+#include "OSAL.h"
+
+/*
+ * Simulation stand-in, key presses arrive as keyChange_t messages.
+ */
+
+typedef struct
+{
+  osal_event_hdr_t hdr;
+  uint8 state;
+  uint8 keys;
+} keyChange_t;
+
+extern uint8 RegisterForKeys(uint8 task_id);
+extern void MicroWait(uint16 timeout);
+
+#endif /* ONBOARD_H */
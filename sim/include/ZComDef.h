@@ -0,0 +1,35 @@
+#ifndef ZCOMDEF_H
+#define ZCOMDEF_H
+
+#include "hal_defs.h"
+
+/*
+ * Simulation stand-in, common Z-Stack definitions.
+ */
+
+typedef uint8 ZStatus_t;
+
+#define ZSUCCESS                0x00
+#define ZFAILURE                0x01
+#define ZINVALIDPARAMETER       0x02
+#define ZMemError               0x10
+#define NV_ITEM_UNINIT          0x09
+#define NV_OPER_FAILED          0x0A
+
+#define ZCD_NV_BOOTCOUNTER      0x0401
+
+#define Z_EXTADDR_LEN           8
+
+typedef uint8 ZLongAddr_t[Z_EXTADDR_LEN];
+
+typedef struct
+{
+  union
+  {
+    uint16      shortAddr;
+    ZLongAddr_t extAddr;
+  } addr;
+  uint8 addrMode;
+} zAddrType_t;
+
+#endif /* ZCOMDEF_H */
@@ -0,0 +1,68 @@
+#ifndef ZDAPP_H
+#define ZDAPP_H
+
+#include "ZComDef.h"
+#include "bdb_interface.h"
+
+/*
+ * Simulation stand-in, device states and ZDO callbacks.
+ */
+
+#define ZG_BUILD_ENDDEVICE_TYPE     1
+#define ZSTACK_END_DEVICE_BUILD     1
+
+typedef enum
+{
+  DEV_HOLD,
+  DEV_INIT,
+  DEV_NWK_DISC,
+  DEV_NWK_JOINING,
+  DEV_NWK_SEC_REJOIN_CURR_CHANNEL,
+  DEV_END_DEVICE_UNAUTH,
+  DEV_END_DEVICE,
+  DEV_ROUTER,
+  DEV_COORD_STARTING,
+  DEV_ZB_COORD,
+  DEV_NWK_ORPHAN,
+  DEV_NWK_KA,
+  DEV_NWK_BACKOFF,
+  DEV_NWK_SEC_REJOIN_ALL_CHANNEL,
+  DEV_NWK_TC_REJOIN_CURR_CHANNEL,
+  DEV_NWK_TC_REJOIN_ALL_CHANNEL
+} devStates_t;
+
+#define ZDO_SRC_RTG_IND_CBID            0
+#define ZDO_CONCENTRATOR_IND_CBID       1
+#define ZDO_NWK_DISCOVERY_CNF_CBID      2
+#define ZDO_BEACON_NOTIFY_IND_CBID      3
+#define ZDO_JOIN_CNF_CBID               4
+#define ZDO_LEAVE_CNF_CBID              5
+#define ZDO_LEAVE_IND_CBID              6
+#define MAX_ZDO_CB_FUNC                 7
+
+typedef struct
+{
+  uint16 sourceAddr;
+  uint16 panID;
+  uint8  logicalChannel;
+  uint8  permitJoining;
+  uint8  routerCapacity;
+  uint8  deviceCapacity;
+  uint8  protocolVersion;
+  uint8  stackProfile;
+  uint8  LQI;
+  uint8  depth;
+  uint8  updateID;
+  uint8  extendedPanID[Z_EXTADDR_LEN];
+} zdoBeaconInd_t;
+
+typedef void *(*pfnZdoCb)(void *param);
+
+extern devStates_t devState;
+
+extern void ZDApp_ChangeState(devStates_t state);
+extern uint8 ZDApp_RestoreNwkKey(uint8 incrFrmCnt);
+extern uint8 ZDO_RegisterForZdoCB(uint8 indID, pfnZdoCb pFn);
+extern uint8 ZDO_DeregisterForZdoCB(uint8 indID);
+
+#endif /* ZDAPP_H */
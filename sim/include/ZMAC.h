@@ -0,0 +1,34 @@
+#ifndef ZMAC_H
+#define ZMAC_H
+
+#include "ZComDef.h"
+
+/*
+ * Simulation stand-in, CC2530 transmit power values.
+ */
+
+typedef enum
+{
+  TX_PWR_PLUS_4   = -4,
+  TX_PWR_PLUS_3   = -3,
+  TX_PWR_PLUS_2   = -2,
+  TX_PWR_PLUS_1   = -1,
+  TX_PWR_ZERO     = 0,
+  TX_PWR_MINUS_1  = 1,
+  TX_PWR_MINUS_2  = 2,
+  TX_PWR_MINUS_3  = 3,
+  TX_PWR_MINUS_4  = 4,
+  TX_PWR_MINUS_6  = 6,
+  TX_PWR_MINUS_8  = 8,
+  TX_PWR_MINUS_10 = 10,
+  TX_PWR_MINUS_12 = 12,
+  TX_PWR_MINUS_14 = 14,
+  TX_PWR_MINUS_16 = 16,
+  TX_PWR_MINUS_18 = 18,
+  TX_PWR_MINUS_20 = 20,
+  TX_PWR_MINUS_22 = 22
+} ZMacTransmitPower_t;
+
+extern uint8 ZMacSetTransmitPower(ZMacTransmitPower_t level);
+
+#endif /* ZMAC_H */
@@ -0,0 +1,20 @@
+#ifndef BDB_H
+#define BDB_H
+
+#include "ZComDef.h"
+
+/*
+ * Simulation stand-in, base device behavior attributes.
+ */
+
+typedef struct
+{
+  uint8  bdbNodeIsOnANetwork;
+  uint8  bdbCommissioningMode;
+  uint32 bdbPrimaryChannelSet;
+  uint32 bdbSecondaryChannelSet;
+} bdbAttributes_t;
+
+extern bdbAttributes_t bdbAttributes;
+
+#endif /* BDB_H */
@@ -0,0 +1,71 @@
+#ifndef BDB_INTERFACE_H
+#define BDB_INTERFACE_H
+
+#include "bdb.h"
+#include "AF.h"
+#include "zcl.h"
+#include "nwk.h"
+
+/*
+ * Simulation stand-in for the BDB application interface. Steering is
+ * modelled by sim_stack, see sim_NetSetup.
+ */
+
+#define BDB_COMMISSIONING_INITIALIZATION        0
+#define BDB_COMMISSIONING_NWK_STEERING          1
+#define BDB_COMMISSIONING_FORMATION             2
+#define BDB_COMMISSIONING_FINDING_BINDING       3
+#define BDB_COMMISSIONING_TOUCHLINK             4
+#define BDB_COMMISSIONING_PARENT_LOST           5
+
+#define BDB_COMMISSIONING_SUCCESS               0
+#define BDB_COMMISSIONING_IN_PROGRESS           1
+#define BDB_COMMISSIONING_NO_NETWORK            2
+#define BDB_COMMISSIONING_TL_TARGET_FAILURE     3
+#define BDB_COMMISSIONING_TL_NOT_AA_CAPABLE     4
+#define BDB_COMMISSIONING_TL_NO_SCAN_RESPONSE   5
+#define BDB_COMMISSIONING_TL_NOT_PERMITTED      6
+#define BDB_COMMISSIONING_TCLK_EX_FAILURE       7
+#define BDB_COMMISSIONING_FORMATION_FAILURE     8
+#define BDB_COMMISSIONING_FB_TARGET_IN_PROGRESS 9
+#define BDB_COMMISSIONING_FB_INITITATOR_IN_PROGRESS 10
+#define BDB_COMMISSIONING_FB_NO_IDENTIFY_QUERY_RESPONSE 11
+#define BDB_COMMISSIONING_FB_BINDING_TABLE_FULL 12
+#define BDB_COMMISSIONING_NETWORK_RESTORED      13
+#define BDB_COMMISSIONING_FAILURE               14
+
+#define BDB_COMMISSIONING_MODE_IDDLE            0x00
+#define BDB_COMMISSIONING_MODE_TOUCHLINK        0x01
+#define BDB_COMMISSIONING_MODE_NWK_STEERING     0x02
+#define BDB_COMMISSIONING_MODE_NWK_FORMATION    0x04
+#define BDB_COMMISSIONING_MODE_FINDING_BINDING  0x08
+#define BDB_COMMISSIONING_MODE_INITIALIZATION   0x10
+#define BDB_COMMISSIONING_MODE_PARENT_LOST      0x20
+
+typedef struct
+{
+  uint8 bdbCommissioningStatus;
+  uint8 bdbCommissioningMode;
+  uint8 bdbRemainingCommissioningModes;
+} bdbCommissioningModeMsg_t;
+
+typedef struct
+{
+  uint16 clusterId;
+  zAddrType_t dstAddr;
+  uint8 ep;
+} bdbBindNotificationData_t;
+
+typedef void (*bdbGCB_CommissioningStatus_t)(bdbCommissioningModeMsg_t *bdbCommissioningModeMsg);
+typedef void (*bdbGCB_BindNotification_t)(bdbBindNotificationData_t *bindData);
+
+extern void bdb_RegisterCommissioningStatusCB(bdbGCB_CommissioningStatus_t bdbGCB_CommissioningStatus);
+extern void bdb_RegisterBindNotificationCB(bdbGCB_BindNotification_t pfnBindNotification);
+extern void bdb_StartCommissioning(uint8 mode);
+extern ZStatus_t bdb_ZedAttemptRecoverNwk(void);
+extern uint8 bdb_getZCLFrameCounter(void);
+extern ZStatus_t bdb_RepChangedAttrValue(uint8 endpoint, uint16 cluster, uint16 attrID);
+extern void bdb_resetLocalAction(void);
+extern void bindCapacity(uint16 *maxEntries, uint16 *usedEntries);
+
+#endif /* BDB_INTERFACE_H */
@@ -0,0 +1,44 @@
+#ifndef HAL_ADC_H
+#define HAL_ADC_H
+
+#include "hal_types.h"
+
+/*
+ * Simulation stand-in, see sim_SetVdd and sim_SetAdcInput.
+ */
+
+#define HAL_ADC_RESOLUTION_8    0x01
+#define HAL_ADC_RESOLUTION_10   0x02
+#define HAL_ADC_RESOLUTION_12   0x03
+#define HAL_ADC_RESOLUTION_14   0x04
+
+#define HAL_ADC_CHANNEL_0       0x00
+#define HAL_ADC_CHANNEL_1       0x01
+#define HAL_ADC_CHANNEL_2       0x02
+#define HAL_ADC_CHANNEL_3       0x03
+#define HAL_ADC_CHANNEL_4       0x04
+#define HAL_ADC_CHANNEL_5       0x05
+#define HAL_ADC_CHANNEL_6       0x06
+#define HAL_ADC_CHANNEL_7       0x07
+#define HAL_ADC_CHANNEL_TEMP    0x0E
+#define HAL_ADC_CHANNEL_VDD     0x0F
+
+#define HAL_ADC_REF_125V        0x00
+#define HAL_ADC_REF_AIN7        0x40
+#define HAL_ADC_REF_AVDD        0x80
+#define HAL_ADC_REF_BITS        0xC0
+
+#define HAL_ADC_DEC_064         0x00
+#define HAL_ADC_DEC_128         0x10
+#define HAL_ADC_DEC_256         0x20
+#define HAL_ADC_DEC_512         0x30
+#define HAL_ADC_DEC_BITS        0x30
+
+#define HAL_ADC_CHN_BITS        0x0F
+
+extern void HalAdcInit(void);
+extern uint16 HalAdcRead(uint8 channel, uint8 resolution);
+extern void HalAdcSetReference(uint8 reference);
+extern bool HalAdcCheckVdd(uint8 vdd);
+
+#endif /* HAL_ADC_H */
@@ -0,0 +1,15 @@
+#ifndef HAL_ASSERT_H
+#define HAL_ASSERT_H
+
+#include "hal_defs.h"
+
+/*
+ * Simulation stand-in, failed assertions are counted in simStats.asserts.
+ */
+
+extern void halAssertHandler(void);
+
+#define HAL_ASSERT(expr)        st( if (!( expr )) halAssertHandler(); )
+#define HAL_ASSERT_FORCED()     halAssertHandler()
+
+#endif /* HAL_ASSERT_H */
@@ -0,0 +1,16 @@
+#ifndef HAL_BOARD_H
+#define HAL_BOARD_H
+
+#include "hal_mcu.h"
+
+/*
+ * Simulation stand-in. HalAdcCheckVdd units: (Vdd / 3) / 1.15 V x 127.
+ */
+
+#define VDD_2_0      74
+#define VDD_2_7      100
+#define VDD_MIN_RUN  (VDD_2_0 + 4)
+#define VDD_MIN_NV   (VDD_2_0 + 4)
+#define VDD_MIN_GOOD (VDD_2_0 + 8)
+
+#endif /* HAL_BOARD_H */
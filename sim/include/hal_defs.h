@@ -0,0 +1,37 @@
+#ifndef HAL_DEFS_H
+#define HAL_DEFS_H
+
+#include "hal_types.h"
+
+/*
+ * Simulation stand-in, same macros as the Z-Stack HAL.
+ */
+
+#define BV(n)      (1 << (n))
+
+#define BUILD_UINT16(loByte, hiByte) \
+          ((uint16)(((loByte) & 0x00FF) + (((hiByte) & 0x00FF) << 8)))
+
+#define BUILD_UINT32(Byte0, Byte1, Byte2, Byte3) \
+          ((uint32)((uint32)((Byte0) & 0x00FF) \
+          + ((uint32)((Byte1) & 0x00FF) << 8) \
+          + ((uint32)((Byte2) & 0x00FF) << 16) \
+          + ((uint32)((Byte3) & 0x00FF) << 24)))
+
+#define BREAK_UINT32(var, ByteNum) \
+          (uint8)((uint32)(((var) >> ((ByteNum) * 8)) & 0x00FF))
+
+#define HI_UINT16(a) (((a) >> 8) & 0xFF)
+#define LO_UINT16(a) ((a) & 0xFF)
+
+#ifndef MIN
+#define MIN(n, m)   (((n) < (m)) ? (n) : (m))
+#endif
+
+#ifndef MAX
+#define MAX(n, m)   (((n) < (m)) ? (m) : (n))
+#endif
+
+#define st(x)      do { x } while (__LINE__ == -1)
+
+#endif /* HAL_DEFS_H */
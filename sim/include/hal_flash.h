@@ -0,0 +1,19 @@
+#ifndef HAL_FLASH_H
+#define HAL_FLASH_H
+
+#include "hal_types.h"
+
+/*
+ * Simulation stand-in over a flash image that survives sim_PowerCycle.
+ * Writes only clear bits, like the real flash.
+ */
+
+#define HAL_FLASH_PAGE_SIZE     2048
+#define HAL_FLASH_WORD_SIZE     4
+#define HAL_FLASH_PAGES         128
+
+extern void HalFlashRead(uint8 pg, uint16 offset, uint8 *buf, uint16 cnt);
+extern void HalFlashWrite(uint16 addr, uint8 *buf, uint16 cnt);
+extern void HalFlashErase(uint8 pg);
+
+#endif /* HAL_FLASH_H */
@@ -0,0 +1,20 @@
+#ifndef HAL_KEY_H
+#define HAL_KEY_H
+
+#include "hal_types.h"
+
+/*
+ * Simulation stand-in, keys are pressed by sim_Key.
+ */
+
+#define HAL_KEY_PORT0   0x01
+#define HAL_KEY_PORT1   0x02
+#define HAL_KEY_PORT2   0x04
+
+#define HAL_KEY_PRESS   0x20
+#define HAL_KEY_RELEASE 0x40
+
+#define HAL_KEY_SW_1    0x01
+#define HAL_KEY_SW_2    0x02
+
+#endif /* HAL_KEY_H */
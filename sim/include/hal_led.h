@@ -0,0 +1,32 @@
+#ifndef HAL_LED_H
+#define HAL_LED_H
+
+#include "hal_types.h"
+
+/*
+ * Simulation stand-in, LED on time is accounted in simStats.ledOnMs.
+ */
+
+#define HAL_LED_1     0x01
+#define HAL_LED_2     0x02
+#define HAL_LED_3     0x04
+#define HAL_LED_4     0x08
+#define HAL_LED_ALL   (HAL_LED_1 | HAL_LED_2 | HAL_LED_3 | HAL_LED_4)
+
+#define HAL_LED_MODE_OFF     0x00
+#define HAL_LED_MODE_ON      0x01
+#define HAL_LED_MODE_BLINK   0x02
+#define HAL_LED_MODE_FLASH   0x04
+#define HAL_LED_MODE_TOGGLE  0x08
+
+#define HAL_LED_DEFAULT_MAX_LEDS      4
+#define HAL_LED_DEFAULT_DUTY_CYCLE    5
+#define HAL_LED_DEFAULT_FLASH_COUNT   50
+#define HAL_LED_DEFAULT_FLASH_TIME    1000
+
+extern void HalLedInit(void);
+extern uint8 HalLedSet(uint8 led, uint8 mode);
+extern void HalLedBlink(uint8 leds, uint8 cnt, uint8 duty, uint16 time);
+extern uint8 HalLedGetState(void);
+
+#endif /* HAL_LED_H */
@@ -0,0 +1,32 @@
+#ifndef HAL_MCU_H
+#define HAL_MCU_H
+
+#include "hal_defs.h"
+#include "hal_types.h"
+#include "ioCC2530.h"
+
+/*
+ * Simulation stand-in. An interrupt handler is also put into a vector
+ * table entry named after its vector, the simulated peripheral calls it.
+ */
+
+#define HAL_MCU_CC2530
+
+typedef uint8 halIntState_t;
+
+#define HAL_ENABLE_INTERRUPTS()         st( EA = 1; )
+#define HAL_DISABLE_INTERRUPTS()        st( EA = 0; )
+#define HAL_INTERRUPTS_ARE_ENABLED()    (EA)
+
+#define HAL_ENTER_CRITICAL_SECTION(x)   st( x = EA;  HAL_DISABLE_INTERRUPTS(); )
+#define HAL_EXIT_CRITICAL_SECTION(x)    st( EA = x; )
+#define HAL_CRITICAL_STATEMENT(x)       st( halIntState_t _s; HAL_ENTER_CRITICAL_SECTION(_s); x; HAL_EXIT_CRITICAL_SECTION(_s); )
+
+typedef void (*simIsr_t)(void);
+
+#define HAL_ISR_FUNCTION(f, v) \
+  void f(void); \
+  const simIsr_t simIsr_##v = f; \
+  void f(void)
+
+#endif /* HAL_MCU_H */
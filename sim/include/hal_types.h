@@ -0,0 +1,43 @@
+#ifndef HAL_TYPES_H
+#define HAL_TYPES_H
+
+/*
+ * Simulation stand-in, 8051 type sizes on a host compiler.
+ */
+
+typedef signed   char   int8;
+typedef unsigned char   uint8;
+typedef signed   short  int16;
+typedef unsigned short  uint16;
+typedef signed   int    int32;
+typedef unsigned int    uint32;
+typedef unsigned char   bool;
+typedef uint8           halDataAlign_t;
+
+#ifndef TRUE
+#define TRUE 1
+#endif
+
+#ifndef FALSE
+#define FALSE 0
+#endif
+
+// lower case ones come with the IAR runtime headers
+#ifndef true
+#define true 1
+#endif
+
+#ifndef false
+#define false 0
+#endif
+
+#ifndef NULL
+#define NULL ((void *)0)
+#endif
+
+#define CODE
+#define XDATA
+#define __code
+#define __xdata
+
+#endif /* HAL_TYPES_H */
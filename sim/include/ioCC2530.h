@@ -0,0 +1,24 @@
+#ifndef IOCC2530_H
+#define IOCC2530_H
+
+#include "hal_types.h"
+
+/*
+ * Simulation stand-in. SFRs the library touches are plain variables the
+ * simulated peripherals look at between task events. ST0 is a function
+ * so reading it latches ST1 and ST2 from the virtual clock.
+ */
+
+extern volatile uint8 EA;
+extern volatile uint8 ADCCON1, ADCCON2, ADCCON3, ADCL, ADCH, ADCIE, ADCIF, APCFG;
+extern volatile uint8 simST1, simST2;
+
+extern uint8 simSleepTimerLatch(void);
+
+#define ST0         simSleepTimerLatch()
+#define ST1         simST1
+#define ST2         simST2
+
+#define ADC_VECTOR  0x0B
+
+#endif /* IOCC2530_H */
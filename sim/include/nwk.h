@@ -0,0 +1,29 @@
+#ifndef NWK_H
+#define NWK_H
+
+#include "ZComDef.h"
+
+/*
+ * Simulation stand-in for the network layer and MAC interface.
+ */
+
+#define POLL_RATE 7500
+
+typedef struct
+{
+  uint16 nwkDevAddress;
+  uint16 nwkPanId;
+  uint8  nwkLogicalChannel;
+  uint16 nwkCoordAddress;
+  uint8  nwkCoordExtAddress[Z_EXTADDR_LEN];
+  uint8  extendedPANID[Z_EXTADDR_LEN];
+} nwkIB_t;
+
+extern nwkIB_t _NIB;
+extern uint32 zgDefaultChannelList;
+
+extern void NLME_SetPollRate(uint32 newRate);
+extern uint8 *NLME_GetExtAddr(void);
+extern ZStatus_t NLME_ReJoinRequest(uint8 *ExtendedPANID, uint32 channels);
+
+#endif /* NWK_H */
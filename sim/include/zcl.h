@@ -0,0 +1,140 @@
+#ifndef ZCL_H
+#define ZCL_H
+
+#include "AF.h"
+
+/*
+ * Simulation stand-in for the ZCL foundation. Sent frames are counted in
+ * simStats and the last report is kept, see sim_LastReport.
+ */
+
+#define ZCL_DATATYPE_NO_DATA        0x00
+#define ZCL_DATATYPE_BOOLEAN        0x10
+#define ZCL_DATATYPE_BITMAP8        0x18
+#define ZCL_DATATYPE_BITMAP16       0x19
+#define ZCL_DATATYPE_BITMAP32       0x1b
+#define ZCL_DATATYPE_UINT8          0x20
+#define ZCL_DATATYPE_UINT16         0x21
+#define ZCL_DATATYPE_UINT24         0x22
+#define ZCL_DATATYPE_UINT32         0x23
+#define ZCL_DATATYPE_UINT48         0x25
+#define ZCL_DATATYPE_INT8           0x28
+#define ZCL_DATATYPE_INT16          0x29
+#define ZCL_DATATYPE_INT24          0x2a
+#define ZCL_DATATYPE_INT32          0x2b
+#define ZCL_DATATYPE_INT64          0x2f
+#define ZCL_DATATYPE_ENUM8          0x30
+#define ZCL_DATATYPE_ENUM16         0x31
+#define ZCL_DATATYPE_SINGLE_PREC    0x39
+#define ZCL_DATATYPE_OCTET_STR      0x41
+#define ZCL_DATATYPE_CHAR_STR       0x42
+#define ZCL_DATATYPE_UTC            0xe2
+#define ZCL_DATATYPE_IEEE_ADDR      0xf0
+
+#define ZCL_FRAME_CLIENT_SERVER_DIR 0x00
+#define ZCL_FRAME_SERVER_CLIENT_DIR 0x01
+
+#define ZCL_CMD_READ                0x00
+#define ZCL_CMD_WRITE               0x02
+#define ZCL_CMD_CONFIG_REPORT       0x06
+#define ZCL_CMD_CONFIG_REPORT_RSP   0x07
+#define ZCL_CMD_REPORT              0x0a
+
+#define ZCL_SEND_ATTR_REPORTS       0x00
+
+#define ZCL_STATUS_SUCCESS                  0x00
+#define ZCL_STATUS_FAILURE                  0x01
+#define ZCL_STATUS_UNSUPPORTED_ATTRIBUTE    0x86
+#define ZCL_STATUS_INVALID_VALUE            0x87
+#define ZCL_STATUS_UNREPORTABLE_ATTRIBUTE   0x8c
+#define ZCL_STATUS_INVALID_DATA_TYPE        0x8d
+
+#define ACCESS_CONTROL_READ         0x01
+#define ACCESS_CONTROL_WRITE        0x02
+
+typedef struct
+{
+  uint8  fc;
+  uint16 manuCode;
+  uint8  transSeqNum;
+  uint8  commandID;
+} zclFrameHdr_t;
+
+typedef struct
+{
+  osal_event_hdr_t hdr;
+  zclFrameHdr_t    zclHdr;
+  uint16           clusterId;
+  afAddrType_t     srcAddr;
+  uint8            endPoint;
+  void             *attrCmd;
+} zclIncomingMsg_t;
+
+typedef struct
+{
+  uint16 attrId;
+  uint8  dataType;
+  uint8  accessControl;
+  void   *dataPtr;
+} zclAttribute_t;
+
+typedef struct
+{
+  uint16          clusterID;
+  zclAttribute_t  attr;
+} zclAttrRec_t;
+
+typedef struct
+{
+  uint16 attrID;
+  uint8  dataType;
+  uint8  *attrData;
+} zclReport_t;
+
+typedef struct
+{
+  uint8       numAttr;
+  zclReport_t attrList[];
+} zclReportCmd_t;
+
+typedef struct
+{
+  uint8  direction;
+  uint16 attrID;
+  uint8  dataType;
+  uint16 minReportInt;
+  uint16 maxReportInt;
+  uint16 timeoutPeriod;
+  uint8  *reportableChange;
+} zclCfgReportRec_t;
+
+typedef struct
+{
+  uint8             numAttr;
+  zclCfgReportRec_t attrList[];
+} zclCfgReportCmd_t;
+
+typedef struct
+{
+  uint8  status;
+  uint8  direction;
+  uint16 attrID;
+} zclCfgReportStatus_t;
+
+typedef struct
+{
+  uint8                numAttr;
+  zclCfgReportStatus_t attrList[];
+} zclCfgReportRspCmd_t;
+
+extern ZStatus_t zcl_SendReportCmd(uint8 srcEP, afAddrType_t *dstAddr, uint16 clusterID, zclReportCmd_t *reportCmd,
+                                   uint8 direction, uint8 disableDefaultRsp, uint8 seqNum);
+extern ZStatus_t zcl_SendConfigReportRspCmd(uint8 srcEP, afAddrType_t *dstAddr, uint16 clusterID,
+                                            zclCfgReportRspCmd_t *cfgReportRspCmd, uint8 direction,
+                                            uint8 disableDefaultRsp, uint8 seqNum);
+extern ZStatus_t zcl_registerAttrList(uint8 endpoint, uint8 numAttr, const zclAttrRec_t attrList[]);
+extern uint8 zclGetDataTypeLength(uint8 dataType);
+extern uint16 zclGetAttrDataLength(uint8 dataType, uint8 *pData);
+extern uint8 zclAnalogDataType(uint8 dataType);
+
+#endif /* ZCL_H */
@@ -0,0 +1,14 @@
+#ifndef ZCL_DIAGNOSTIC_H
+#define ZCL_DIAGNOSTIC_H
+
+#include "zcl.h"
+
+/*
+ * Simulation stand-in, diagnostics cluster attributes.
+ */
+
+#define ATTRID_DIAGNOSTIC_NUMBER_OF_RESETS      0x0000
+#define ATTRID_DIAGNOSTIC_LAST_MESSAGE_LQI      0x011D
+#define ATTRID_DIAGNOSTIC_LAST_MESSAGE_RSSI     0x011E
+
+#endif /* ZCL_DIAGNOSTIC_H */
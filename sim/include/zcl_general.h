@@ -0,0 +1,22 @@
+#ifndef ZCL_GENERAL_H
+#define ZCL_GENERAL_H
+
+#include "zcl.h"
+
+/*
+ * Simulation stand-in, general cluster IDs and attributes.
+ */
+
+#define ZCL_CLUSTER_ID_GEN_BASIC                        0x0000
+#define ZCL_CLUSTER_ID_GEN_POWER_CFG                    0x0001
+#define ZCL_CLUSTER_ID_GEN_ALARMS                       0x0009
+#define ZCL_CLUSTER_ID_GEN_POLL_CONTROL                 0x0020
+#define ZCL_CLUSTER_ID_HA_DIAGNOSTIC                    0x0B05
+
+#define ATTRID_BASIC_ALARM_MASK                         0x0013
+#define ATTRID_POWER_CFG_BATTERY_VOLTAGE                0x0020
+#define ATTRID_POWER_CFG_BATTERY_PERCENTAGE_REMAINING   0x0021
+#define ATTRID_POWER_CFG_BAT_SIZE                       0x0031
+#define ATTRID_POWER_CFG_BAT_QUANTITY                   0x0033
+
+#endif /* ZCL_GENERAL_H */
@@ -0,0 +1,133 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include "hal_types.h"
+#include "zcl.h"
+
+/*
+ * Host simulation of the Z-Stack services the library runs on.
+ *
+ * OSAL timers, messages, heap and NV, the HAL ADC, flash, keys, LEDs and
+ * UART, and a small BDB/ZDO/NWK model run on a virtual clock. Nothing
+ * runs in real time, sim_Run executes task events in OSAL priority
+ * order and jumps the clock to the next timer or ADC conversion while
+ * all tasks are idle, which is when the device would sleep.
+ *
+ * Every boot runs in a forked process, so each one starts with fresh
+ * library statics like after a reset. Flash, OSAL NV, network state and
+ * statistics live in shared memory and survive boots. A power failure
+ * can be injected at any flash operation, the boot then ends right
+ * there with the operation half done.
+ *
+ * Costs charged to the virtual clock are taken from the CC2530 datasheet:
+ * 20 us per flash word write, 20 ms per page erase, (decimation + 16) /
+ * 4 us per ADC conversion. OSAL NV is modelled as a log of item records
+ * in a 2 KB page, a write appends a header and the data, a lookup scans
+ * the headers and a full page is compacted.
+ */
+
+#define SIM_TASK_STACK          0   // BDB/ZDO model, highest priority
+#define SIM_TASK_ZAPP           1   // library task, zAppTask_Init gets this ID
+#define SIM_TASK_APP            2   // optional application task
+
+#define SIM_BOOT_OK             0
+#define SIM_BOOT_POWER_FAIL     1
+#define SIM_BOOT_FAILED         2
+
+#define SIM_FLASH_PAGES         128
+
+// flash timing, us
+#define SIM_FLASH_WORD_US       20
+#define SIM_FLASH_ERASE_US      20000
+#define SIM_FLASH_READ_NS       125     // per byte, MOVC loop at 32 MHz
+
+// OSAL NV model
+#define SIM_NV_ITEMS            16
+#define SIM_NV_ITEM_MAX         64
+#define SIM_NV_HDR_BYTES        8
+#define SIM_NV_STACK_ITEMS      40      // stack items sharing the page
+#define SIM_NV_STACK_BYTES      1024    // and their data
+
+#define SIM_ADC_REF_MV          1150
+
+#define SIM_USER_WORDS          64      // sim_User scratch
+
+typedef uint16 (*simTaskFn_t)(uint8 task_id, uint16 events);
+typedef void (*simBootFn_t)(void);
+
+typedef struct
+{
+    uint32 timeMs;          // virtual time, all boots
+    uint32 activeMs;        // time awake, tasks running or power held
+    uint32 wakeups;         // sleep to active transitions, polls included
+    uint32 taskRuns;        // task event handler calls
+    uint32 polls;           // data requests at the current poll rate
+    uint16 pollRateChanges;
+    uint32 pollRate;        // current NLME_SetPollRate value
+    uint16 reports;         // report frames sent
+    uint32 reportBytes;     // ZCL payload bytes of the frames
+    uint16 heapCur;
+    uint16 heapPeak;
+    uint16 heapFails;
+    uint16 msgs;            // OSAL messages sent
+    uint16 nvWrites;        // OSAL NV item writes
+    uint16 nvCompactions;   // OSAL NV page compactions
+    uint16 nvFailures;      // OSAL NV writes refused on low Vdd
+    uint32 flashWrites;     // flash words written
+    uint16 flashErases;
+    uint32 adcConversions;
+    uint16 asserts;
+    uint16 rejoins;         // NLME_ReJoinRequest calls
+    uint32 lastRejoinMask;  // channel mask of the last rejoin
+    uint16 recoverCalls;    // bdb_ZedAttemptRecoverNwk calls
+    uint16 factoryResets;
+    uint32 ledOnMs;
+    int8   txPower;         // last ZMacSetTransmitPower value
+    uint16 boots;
+} simStats_t;
+
+typedef struct
+{
+    uint16 clusterID;
+    uint8  numAttr;
+    uint16 attrID[8];
+    uint32 value[8];
+} simReport_t;
+
+// control, parent process
+extern void sim_Reset(uint32 seed);
+extern uint8 sim_Boot(simBootFn_t body);
+extern void sim_PowerFailAt(uint32 flashOps, uint8 tornBytes);
+extern simStats_t *sim_Stats(void);
+extern uint32 sim_Failures(void);
+extern uint32 *sim_User(void);
+
+// device and environment, any process
+extern void sim_SetVdd(uint16 mV);
+extern void sim_SetAdcNoise(uint8 lsb);
+extern void sim_SetAdcInput(uint8 channel, uint16 mV);
+extern void sim_NetSetup(bool present, uint8 channel, uint16 panId, uint32 joinMs, uint32 rejoinMs);
+extern void sim_NetPresent(bool present);
+extern uint32 sim_FlashOps(void);
+extern uint8 *sim_Flash(uint8 page);
+
+// inside a boot
+extern void sim_InitTasks(simTaskFn_t app);
+extern void sim_Run(uint32 ms);
+extern void sim_Key(uint8 portAndAction, uint8 keyCode);
+extern void sim_NetParentLost(void);
+extern void sim_NetBeacon(uint16 addr, uint8 lqi, bool capacity);
+extern bool sim_BeaconCbOwnedByApp(void);
+extern const simReport_t *sim_LastReport(void);
+extern uint32 sim_NowUs(void);
+extern bool sim_NvRead(uint16 id, uint16 len, void *buf);
+extern uint16 sim_UartCapture(const uint8 **data);
+extern void sim_UartClear(void);
+
+// test helpers
+extern void sim_Fail(const char *file, int line, const char *expr);
+
+#define SIM_CHECK(expr) \
+    do { if (!(expr)) sim_Fail(__FILE__, __LINE__, #expr); } while (0)
+
+#endif /* SIM_H */
@@ -0,0 +1,428 @@
+#include <string.h>
+
+#include "hal_adc.h"
+#include "hal_board.h"
+#include "hal_flash.h"
+#include "hal_key.h"
+#include "hal_led.h"
+#include "hal_mcu.h"
+#include "hal_uart.h"
+#include "OnBoard.h"
+
+#include "sim_internal.h"
+
+/*
+ * HAL stand-in: sleep timer, ADC with its end of conversion interrupt,
+ * flash with power failure injection, keys, LEDs and UART.
+ */
+
+#define SIM_NEVER            ((unsigned long long)-1)
+#define SIM_UART_CAPTURE     4096
+
+volatile uint8 EA = 1;
+volatile uint8 ADCCON1, ADCCON2, ADCCON3, ADCL, ADCH, ADCIE, ADCIF, APCFG;
+volatile uint8 simST1, simST2;
+
+// utils.c installs it with HAL_ISR_FUNCTION
+extern const simIsr_t simIsr_ADC_VECTOR __attribute__((weak));
+
+static unsigned long long simAdcDone = SIM_NEVER;
+static uint8 simAdcCmd;
+static uint8 simLeds = 0;
+static uint8 simKeysTask = 0xFF;
+static halUARTCBack_t simUartCb = NULL;
+static bool simUartTxPending = FALSE;
+static uint8 simUartOut[SIM_UART_CAPTURE];
+static uint16 simUartLen = 0;
+
+static int16 simAdcSample(uint8 cmd);
+static uint32 simAdcConvUs(uint8 cmd);
+
+void simHalBoot(void)
+{
+    EA = 1;
+    ADCCON3 = 0;
+    ADCIE = 0;
+    ADCIF = 0;
+}
+
+/**************************************************************************************************
+ * @fn      simHalService
+ *
+ * @brief   Start a conversion written to ADCCON3, finish the one due and
+ *          run its interrupt, deliver UART TX empty
+ *
+ * @param   None
+ *
+ * @return  TRUE if anything happened
+ **************************************************************************************************/
+bool simHalService(void)
+{
+    if (ADCCON3 && simAdcDone == SIM_NEVER)
+    {
+        simAdcCmd = ADCCON3;
+        ADCCON3 = 0;
+        simAdcDone = simNow + simAdcConvUs(simAdcCmd);
+        return TRUE;
+    }
+    if (simAdcDone <= simNow)
+    {
+        uint16 reading = (uint16)simAdcSample(simAdcCmd);
+
+        simAdcDone = SIM_NEVER;
+        ADCL = LO_UINT16(reading);
+        ADCH = HI_UINT16(reading);
+        ADCIF = 1;
+        simShared->stats.adcConversions++;
+        if (ADCIE && EA && &simIsr_ADC_VECTOR != NULL)
+        {
+            simIsr_ADC_VECTOR();
+        }
+        return TRUE;
+    }
+    if (simUartTxPending)
+    {
+        simUartTxPending = FALSE;
+        if (simUartCb)
+        {
+            simUartCb(HAL_UART_PORT_0, HAL_UART_TX_EMPTY);
+        }
+        return TRUE;
+    }
+    return FALSE;
+}
+
+unsigned long long simHalNext(void)
+{
+    return simAdcDone;
+}
+
+// LED on time
+void simHalElapse(unsigned long long from, unsigned long long to)
+{
+    if (simLeds)
+    {
+        simShared->stats.ledOnMs += (uint32)(to / 1000 - from / 1000);
+    }
+}
+
+/*********************************************************************
+ * Sleep timer
+ */
+
+uint8 simSleepTimerLatch(void)
+{
+    uint32 ticks = (uint32)(simNow * 32768 / 1000000);
+
+    simST1 = BREAK_UINT32(ticks, 1);
+    simST2 = BREAK_UINT32(ticks, 2);
+    return BREAK_UINT32(ticks, 0);
+}
+
+/*********************************************************************
+ * ADC
+ */
+
+// reference in ADCCON3 bits 7:6, decimation in 5:4, channel in 3:0
+static uint32 simAdcConvUs(uint8 cmd)
+{
+    return ((64u << ((cmd & HAL_ADC_DEC_BITS) >> 4)) + 16 + 3) / 4;
+}
+
+// left aligned two's complement result, full scale at the reference
+static int16 simAdcSample(uint8 cmd)
+{
+    uint8 channel = cmd & HAL_ADC_CHN_BITS;
+    int32 mV;
+    int32 value;
+
+    if (channel == HAL_ADC_CHANNEL_VDD)
+    {
+        mV = simShared->vddMV / 3;
+    }
+    else if (channel < 8)
+    {
+        mV = simShared->adcInput[channel];
+    }
+    else
+    {
+        mV = 0;
+    }
+    value = mV * 32767 / SIM_ADC_REF_MV;
+    if (simShared->adcNoise)
+    {
+        int32 lsb = 1 << (8 - 2 * ((cmd & HAL_ADC_DEC_BITS) >> 4));
+
+        value += ((int32)(simRandom() % (2 * simShared->adcNoise + 1)) - simShared->adcNoise) * lsb;
+    }
+    if (value > 32767)
+    {
+        value = 32767;
+    }
+    return (int16)value & (int16)(0xFFFF << (8 - 2 * ((cmd & HAL_ADC_DEC_BITS) >> 4)));
+}
+
+void HalAdcInit(void)
+{
+}
+
+void HalAdcSetReference(uint8 reference)
+{
+    (void)reference;
+}
+
+uint16 HalAdcRead(uint8 channel, uint8 resolution)
+{
+    uint8 dec = (resolution - HAL_ADC_RESOLUTION_8) << 4;
+    int16 reading;
+
+    simAdvance(simAdcConvUs(dec));
+    simShared->stats.adcConversions++;
+    reading = simAdcSample(dec | channel);
+    if (reading < 0)
+    {
+        reading = 0;
+    }
+    return (uint16)reading >> (8 - 2 * (resolution - HAL_ADC_RESOLUTION_8));
+}
+
+// 7 bit readout of Vdd / 3 against 1.15 V
+bool HalAdcCheckVdd(uint8 vdd)
+{
+    return (uint32)simShared->vddMV * 127 / 3 / SIM_ADC_REF_MV >= vdd;
+}
+
+void sim_SetVdd(uint16 mV)
+{
+    simShared->vddMV = mV;
+}
+
+void sim_SetAdcNoise(uint8 lsb)
+{
+    simShared->adcNoise = lsb;
+}
+
+void sim_SetAdcInput(uint8 channel, uint16 mV)
+{
+    simShared->adcInput[channel & 7] = mV;
+}
+
+/*********************************************************************
+ * Flash
+ */
+
+uint32 sim_FlashOps(void)
+{
+    return simShared->flashOps;
+}
+
+uint8 *sim_Flash(uint8 page)
+{
+    return simShared->flash[page];
+}
+
+static bool simFlashOp(void)
+{
+    simShared->flashOps++;
+    return simShared->failAt != 0 && simShared->flashOps == simShared->failAt;
+}
+
+void HalFlashRead(uint8 pg, uint16 offset, uint8 *buf, uint16 cnt)
+{
+    simAdvanceNs((uint32)cnt * SIM_FLASH_READ_NS);
+    memcpy(buf, &simShared->flash[pg][offset], cnt);
+}
+
+// addr is a word address, cnt counts words, programming only clears bits
+void HalFlashWrite(uint16 addr, uint8 *buf, uint16 cnt)
+{
+    uint8 *dst = &simShared->flash[0][0] + (uint32)addr * HAL_FLASH_WORD_SIZE;
+
+    for (uint16 w = 0; w < cnt; w++)
+    {
+        uint8 n = HAL_FLASH_WORD_SIZE;
+
+        if (simFlashOp())
+        {
+            n = simShared->tornBytes;
+        }
+        for (uint8 i = 0; i < n; i++)
+        {
+            dst[i] &= buf[i];
+        }
+        simAdvance(SIM_FLASH_WORD_US);
+        simShared->stats.flashWrites++;
+        if (n != HAL_FLASH_WORD_SIZE)
+        {
+            simPowerFail();
+        }
+        dst += HAL_FLASH_WORD_SIZE;
+        buf += HAL_FLASH_WORD_SIZE;
+    }
+}
+
+void HalFlashErase(uint8 pg)
+{
+    if (simFlashOp())
+    {
+        memset(simShared->flash[pg], 0xFF, HAL_FLASH_PAGE_SIZE / 2);
+        simPowerFail();
+    }
+    memset(simShared->flash[pg], 0xFF, HAL_FLASH_PAGE_SIZE);
+    simAdvance(SIM_FLASH_ERASE_US);
+    simShared->stats.flashErases++;
+}
+
+/*********************************************************************
+ * Keys
+ */
+
+uint8 RegisterForKeys(uint8 task_id)
+{
+    if (simKeysTask != 0xFF)
+    {
+        return FALSE;
+    }
+    simKeysTask = task_id;
+    return TRUE;
+}
+
+/**************************************************************************************************
+ * @fn      sim_Key
+ *
+ * @brief   Send key change to the task registered for keys
+ *
+ * @param   portAndAction - HAL_KEY_PORTx | HAL_KEY_PRESS or HAL_KEY_RELEASE
+ * @param   keyCode - key pins
+ *
+ * @return  None
+ **************************************************************************************************/
+void sim_Key(uint8 portAndAction, uint8 keyCode)
+{
+    keyChange_t *msg;
+
+    if (simKeysTask == 0xFF)
+    {
+        return;
+    }
+    msg = (keyChange_t *)osal_msg_allocate(sizeof(keyChange_t));
+    if (msg)
+    {
+        msg->hdr.event = KEY_CHANGE;
+        msg->state = portAndAction;
+        msg->keys = keyCode;
+        osal_msg_send(simKeysTask, (uint8 *)msg);
+    }
+}
+
+/*********************************************************************
+ * LEDs
+ */
+
+void HalLedInit(void)
+{
+}
+
+void HalLedBlink(uint8 leds, uint8 cnt, uint8 duty, uint16 time)
+{
+    simLeds &= ~leds;
+    simShared->stats.ledOnMs += (uint32)cnt * time * duty / 100;
+}
+
+uint8 HalLedSet(uint8 led, uint8 mode)
+{
+    switch (mode)
+    {
+    case HAL_LED_MODE_BLINK:
+        HalLedBlink(led, 1, HAL_LED_DEFAULT_DUTY_CYCLE, HAL_LED_DEFAULT_FLASH_TIME);
+        break;
+    case HAL_LED_MODE_FLASH:
+        HalLedBlink(led, HAL_LED_DEFAULT_FLASH_COUNT, HAL_LED_DEFAULT_DUTY_CYCLE, HAL_LED_DEFAULT_FLASH_TIME);
+        break;
+    case HAL_LED_MODE_ON:
+        simLeds |= led;
+        break;
+    case HAL_LED_MODE_TOGGLE:
+        simLeds ^= led;
+        break;
+    default:
+        simLeds &= ~led;
+        break;
+    }
+    return simLeds;
+}
+
+uint8 HalLedGetState(void)
+{
+    return simLeds;
+}
+
+/*********************************************************************
+ * UART, output is captured
+ */
+
+void HalUARTInit(void)
+{
+}
+
+uint8 HalUARTOpen(uint8 port, halUARTCfg_t *config)
+{
+    (void)port;
+    simUartCb = config->callBackFunc;
+    return HAL_UART_SUCCESS;
+}
+
+uint16 HalUARTRead(uint8 port, uint8 *pBuffer, uint16 length)
+{
+    (void)port;
+    (void)pBuffer;
+    (void)length;
+    return 0;
+}
+
+uint16 HalUARTWrite(uint8 port, uint8 *pBuffer, uint16 length)
+{
+    (void)port;
+    if (length > SIM_UART_CAPTURE - simUartLen)
+    {
+        length = SIM_UART_CAPTURE - simUartLen;
+    }
+    memcpy(simUartOut + simUartLen, pBuffer, length);
+    simUartLen += length;
+    simUartTxPending = TRUE;
+    return length;
+}
+
+void HalUARTPoll(void)
+{
+}
+
+uint16 Hal_UART_RxBufLen(uint8 port)
+{
+    (void)port;
+    return 0;
+}
+
+uint16 Hal_UART_TxBufLen(uint8 port)
+{
+    (void)port;
+    return 0;
+}
+
+// output written since the boot started, DEBUG_PRINT_UART and DEBUG_PRINT_TOKENIZED go here
+uint16 sim_UartCapture(const uint8 **data)
+{
+    *data = simUartOut;
+    return simUartLen;
+}
+
+// drops the capture, for a benchmark that writes more than it holds
+void sim_UartClear(void)
+{
+    simUartLen = 0;
+}
+
+void debug_str(uint8 *str_ptr)
+{
+    HalUARTWrite(HAL_UART_PORT_0, str_ptr, (uint16)strlen((char *)str_ptr));
+}
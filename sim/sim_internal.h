@@ -0,0 +1,70 @@
+#ifndef SIM_INTERNAL_H
+#define SIM_INTERNAL_H
+
+#include "hal_flash.h"
+#include "OSAL.h"
+#include "sim.h"
+
+/*
+ * State shared by the simulation modules. simShared lives in shared
+ * memory and survives boots, the rest is per boot.
+ */
+
+typedef struct
+{
+    bool   used;
+    uint16 id;
+    uint16 len;
+    uint8  data[SIM_NV_ITEM_MAX];
+} simNvItem_t;
+
+typedef struct
+{
+    bool   present;         // network reachable
+    uint8  channel;
+    uint16 panId;
+    uint8  extPanId[Z_EXTADDR_LEN];
+    uint16 parentAddr;
+    uint32 joinMs;          // steering duration
+    uint32 rejoinMs;        // rejoin duration
+    bool   joined;          // bdbNodeIsOnANetwork, kept in NV by the real stack
+} simNet_t;
+
+typedef struct
+{
+    uint8       flash[SIM_FLASH_PAGES][HAL_FLASH_PAGE_SIZE];
+    simNvItem_t nv[SIM_NV_ITEMS];
+    uint16      nvPageUsed;     // bytes used in the active OSAL NV page
+    uint16      nvRecords;      // application item records in the page
+    simNet_t    net;
+    simStats_t  stats;
+    uint32      failures;
+    uint32      user[SIM_USER_WORDS];
+    uint32      seed;
+    uint16      vddMV;
+    uint8       adcNoise;
+    uint16      adcInput[8];
+    uint32      flashOps;       // flash word writes and page erases
+    uint32      failAt;         // power fails at this flash operation, 0 never
+    uint8       tornBytes;      // bytes of the failing word write that land
+} simShared_t;
+
+extern simShared_t *simShared;
+extern unsigned long long simNow;   // us since boot
+
+extern void simAdvance(uint32 us);
+extern void simAdvanceNs(uint32 ns);
+extern void simPowerFail(void);
+extern void simPollRate(uint32 rate);
+extern bool simOnNetwork(void);
+extern uint32 simRandom(void);
+
+extern void simHalBoot(void);
+extern bool simHalService(void);
+extern unsigned long long simHalNext(void);
+extern void simHalElapse(unsigned long long from, unsigned long long to);
+
+extern void simStackInit(uint8 task_id);
+extern uint16 simStackEvents(uint8 task_id, uint16 events);
+
+#endif /* SIM_INTERNAL_H */
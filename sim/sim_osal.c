@@ -0,0 +1,794 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "OSAL.h"
+#include "OSAL_PwrMgr.h"
+#include "OnBoard.h"
+#include "hal_adc.h"
+#include "hal_board.h"
+#include "ZDApp.h"
+#include "zapp_task.h"
+
+#include "sim_internal.h"
+
+/*
+ * OSAL stand-in: task table, timers, messages, heap and NV on the
+ * virtual clock, and the boot control of the simulation.
+ */
+
+#define SIM_TASKS            3
+#define SIM_TIMERS           32
+#define SIM_MSGS             32
+#define SIM_HEAP_LEN         3072   // INT_HEAP_LEN of CC2530 end devices
+
+#define SIM_EXIT_POWER_FAIL  0x50
+
+typedef struct
+{
+    bool   used;
+    uint8  task;
+    uint16 event;
+    unsigned long long expire;
+    uint32 reload;          // ms, 0 for one shot
+} simTimer_t;
+
+typedef struct
+{
+    uint16 len;
+    uint8  task;
+} simMsgHdr_t;
+
+simShared_t *simShared = NULL;
+unsigned long long simNow = 0;
+
+static simTaskFn_t simTasks[SIM_TASKS];
+static uint16 simEvents[SIM_TASKS];
+static simTimer_t simTimers[SIM_TIMERS];
+static uint8 *simMsgs[SIM_MSGS];
+static uint8 simMsgCount = 0;
+static uint8 simHolds = 0;
+static bool simSleeping = TRUE;
+static unsigned long long simActiveUs = 0;
+static unsigned long long simPollNext = 0;
+static uint32 simNs = 0;
+static uint32 simRand;
+
+static void simBootEnd(void);
+static void simElapse(unsigned long long to);
+static uint16 simNvScan(void);
+static uint8 simNvAppend(simNvItem_t *item);
+
+/**************************************************************************************************
+ * @fn      sim_Reset
+ *
+ * @brief   Erase flash and NV, clear network and statistics
+ *
+ * @param   seed - random seed of the boots
+ *
+ * @return  None
+ **************************************************************************************************/
+void sim_Reset(uint32 seed)
+{
+    if (simShared == NULL)
+    {
+        simShared = mmap(NULL, sizeof(simShared_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (simShared == MAP_FAILED)
+        {
+            perror("mmap");
+            exit(2);
+        }
+    }
+    memset(simShared, 0, sizeof(simShared_t));
+    memset(simShared->flash, 0xFF, sizeof(simShared->flash));
+    simShared->nvPageUsed = SIM_NV_STACK_BYTES + SIM_NV_STACK_ITEMS * SIM_NV_HDR_BYTES;
+    simShared->seed = seed ? seed : 1;
+    simShared->vddMV = 3000;
+    simShared->stats.txPower = 0x7F;
+    sim_NetSetup(TRUE, 11, 0x1A62, 3000, 500);
+}
+
+/**************************************************************************************************
+ * @fn      sim_Boot
+ *
+ * @brief   Power the device up and run body in a fresh process, statics
+ *          of the library start over like after a reset
+ *
+ * @param   body - boot code, initializes the modules and calls sim_Run
+ *
+ * @return  SIM_BOOT_OK, SIM_BOOT_POWER_FAIL or SIM_BOOT_FAILED
+ **************************************************************************************************/
+uint8 sim_Boot(simBootFn_t body)
+{
+    int status;
+    pid_t pid;
+
+    fflush(NULL);
+    pid = fork();
+    if (pid < 0)
+    {
+        perror("fork");
+        exit(2);
+    }
+    if (pid == 0)
+    {
+        simShared->stats.boots++;
+        simShared->seed = simShared->seed * 1103515245 + 12345;
+        simRand = simShared->seed | 1;
+        simHalBoot();
+        body();
+        simBootEnd();
+        fflush(NULL);
+        _exit(0);
+    }
+    if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status))
+    {
+        simShared->failures++;
+        return SIM_BOOT_FAILED;
+    }
+    if (WEXITSTATUS(status) == SIM_EXIT_POWER_FAIL)
+    {
+        return SIM_BOOT_POWER_FAIL;
+    }
+    return WEXITSTATUS(status) == 0 ? SIM_BOOT_OK : SIM_BOOT_FAILED;
+}
+
+/**************************************************************************************************
+ * @fn      sim_PowerFailAt
+ *
+ * @brief   Cut the power at a flash operation, counted from sim_Reset
+ *
+ * @param   flashOps - operation number, see sim_FlashOps, 0 disarms
+ * @param   tornBytes - bytes of the interrupted word write that land,
+ *                      an interrupted erase leaves half of the page
+ *
+ * @return  None
+ **************************************************************************************************/
+void sim_PowerFailAt(uint32 flashOps, uint8 tornBytes)
+{
+    simShared->failAt = flashOps;
+    simShared->tornBytes = tornBytes;
+}
+
+simStats_t *sim_Stats(void)
+{
+    return &simShared->stats;
+}
+
+uint32 sim_Failures(void)
+{
+    return simShared->failures;
+}
+
+// results a boot passes to the parent
+uint32 *sim_User(void)
+{
+    return simShared->user;
+}
+
+uint32 sim_NowUs(void)
+{
+    return (uint32)simNow;
+}
+
+void sim_Fail(const char *file, int line, const char *expr)
+{
+    printf("%s:%d: check failed: %s\n", file, line, expr);
+    simShared->failures++;
+}
+
+/**************************************************************************************************
+ * @fn      sim_InitTasks
+ *
+ * @brief   Set up the task table like osalInitTasks, the stack model
+ *          first, the library task next and the application last
+ *
+ * @param   app - application task event loop, NULL for none
+ *
+ * @return  None
+ **************************************************************************************************/
+void sim_InitTasks(simTaskFn_t app)
+{
+    simTasks[SIM_TASK_STACK] = simStackEvents;
+    simTasks[SIM_TASK_ZAPP] = zAppTask_event_loop;
+    simTasks[SIM_TASK_APP] = app;
+    simStackInit(SIM_TASK_STACK);
+    zAppTask_Init(SIM_TASK_ZAPP);
+}
+
+/**************************************************************************************************
+ * @fn      sim_Run
+ *
+ * @brief   Run the tasks for the given virtual time
+ *
+ * @param   ms - time to run
+ *
+ * @return  None
+ **************************************************************************************************/
+void sim_Run(uint32 ms)
+{
+    unsigned long long end = simNow + (unsigned long long)ms * 1000;
+
+    for (;;)
+    {
+        unsigned long long next = end;
+        uint8 i;
+
+        if (simHalService())
+        {
+            continue;
+        }
+
+        for (i = 0; i < SIM_TIMERS; i++)
+        {
+            if (simTimers[i].used && simTimers[i].expire <= simNow)
+            {
+                simEvents[simTimers[i].task] |= simTimers[i].event;
+                if (simTimers[i].reload)
+                {
+                    simTimers[i].expire += (unsigned long long)simTimers[i].reload * 1000;
+                }
+                else
+                {
+                    simTimers[i].used = FALSE;
+                }
+            }
+        }
+
+        for (i = 0; i < SIM_TASKS; i++)
+        {
+            if (simEvents[i] && simTasks[i])
+            {
+                break;
+            }
+            simEvents[i] = 0;
+        }
+        if (i < SIM_TASKS)
+        {
+            uint16 events = simEvents[i];
+
+            if (simSleeping)
+            {
+                simSleeping = FALSE;
+                simShared->stats.wakeups++;
+            }
+            simEvents[i] = 0;
+            simEvents[i] |= simTasks[i](i, events);
+            simShared->stats.taskRuns++;
+            continue;
+        }
+
+        if (simNow >= end)
+        {
+            break;
+        }
+        for (i = 0; i < SIM_TIMERS; i++)
+        {
+            if (simTimers[i].used && simTimers[i].expire < next)
+            {
+                next = simTimers[i].expire;
+            }
+        }
+        if (simHalNext() < next)
+        {
+            next = simHalNext();
+        }
+        // nothing to do until then, the device sleeps unless power is held
+        if (simHolds == 0 && simHalNext() == (unsigned long long)-1)
+        {
+            simSleeping = TRUE;
+        }
+        simElapse(next);
+    }
+}
+
+/**************************************************************************************************
+ * @fn      simAdvance
+ *
+ * @brief   Charge busy time of an operation to the clock
+ *
+ * @param   us - time taken
+ *
+ * @return  None
+ **************************************************************************************************/
+void simAdvance(uint32 us)
+{
+    simSleeping = FALSE;
+    simElapse(simNow + us);
+}
+
+// same for operations shorter than a microsecond, the remainder carries over
+void simAdvanceNs(uint32 ns)
+{
+    simNs += ns;
+    simAdvance(simNs / 1000);
+    simNs %= 1000;
+}
+
+/**************************************************************************************************
+ * @fn      simPowerFail
+ *
+ * @brief   End the boot at an injected power failure
+ *
+ * @param   None
+ *
+ * @return  None
+ **************************************************************************************************/
+void simPowerFail(void)
+{
+    simShared->failAt = 0;
+    simBootEnd();
+    fflush(NULL);
+    _exit(SIM_EXIT_POWER_FAIL);
+}
+
+void simPollRate(uint32 rate)
+{
+    simShared->stats.pollRate = rate;
+    simShared->stats.pollRateChanges++;
+    simPollNext = simNow + (unsigned long long)rate * 1000;
+}
+
+uint32 simRandom(void)
+{
+    simRand ^= simRand << 13;
+    simRand ^= simRand >> 17;
+    simRand ^= simRand << 5;
+    return simRand;
+}
+
+static void simElapse(unsigned long long to)
+{
+    simStats_t *stats = &simShared->stats;
+
+    if (to <= simNow)
+    {
+        return;
+    }
+    if (simOnNetwork() && stats->pollRate)
+    {
+        while (simPollNext <= to)
+        {
+            stats->polls++;
+            if (simSleeping)
+            {
+                stats->wakeups++;
+            }
+            simPollNext += (unsigned long long)stats->pollRate * 1000;
+        }
+    }
+    else
+    {
+        simPollNext = to + (unsigned long long)stats->pollRate * 1000;
+    }
+    if (!simSleeping)
+    {
+        simActiveUs += to - simNow;
+    }
+    simHalElapse(simNow, to);
+    simNow = to;
+}
+
+static void simBootEnd(void)
+{
+    simShared->stats.timeMs += (uint32)(simNow / 1000);
+    simShared->stats.activeMs += (uint32)(simActiveUs / 1000);
+}
+
+/*********************************************************************
+ * Tasks and timers
+ */
+
+uint8 osal_set_event(uint8 task_id, uint16 event_flag)
+{
+    if (task_id >= SIM_TASKS)
+    {
+        return 0x03;    // INVALID_TASK
+    }
+    simEvents[task_id] |= event_flag;
+    return ZSUCCESS;
+}
+
+uint8 osal_clear_event(uint8 task_id, uint16 event_flag)
+{
+    if (task_id >= SIM_TASKS)
+    {
+        return 0x03;
+    }
+    simEvents[task_id] &= ~event_flag;
+    return ZSUCCESS;
+}
+
+static simTimer_t *simTimerFind(uint8 task_id, uint16 event_id)
+{
+    for (uint8 i = 0; i < SIM_TIMERS; i++)
+    {
+        if (simTimers[i].used && simTimers[i].task == task_id && simTimers[i].event == event_id)
+        {
+            return &simTimers[i];
+        }
+    }
+    return NULL;
+}
+
+static uint8 simTimerStart(uint8 task_id, uint16 event_id, uint32 timeout, uint32 reload)
+{
+    simTimer_t *t = simTimerFind(task_id, event_id);
+
+    for (uint8 i = 0; t == NULL && i < SIM_TIMERS; i++)
+    {
+        if (!simTimers[i].used)
+        {
+            t = &simTimers[i];
+        }
+    }
+    if (t == NULL)
+    {
+        return 0x08;    // NO_TIMER_AVAIL
+    }
+    t->used = TRUE;
+    t->task = task_id;
+    t->event = event_id;
+    t->expire = simNow + (unsigned long long)timeout * 1000;
+    t->reload = reload;
+    return ZSUCCESS;
+}
+
+uint8 osal_start_timerEx(uint8 task_id, uint16 event_id, uint32 timeout_value)
+{
+    return simTimerStart(task_id, event_id, timeout_value, 0);
+}
+
+uint8 osal_start_reload_timer(uint8 taskID, uint16 event_id, uint32 timeout_value)
+{
+    return simTimerStart(taskID, event_id, timeout_value, timeout_value);
+}
+
+uint8 osal_stop_timerEx(uint8 task_id, uint16 event_id)
+{
+    simTimer_t *t = simTimerFind(task_id, event_id);
+
+    if (t == NULL)
+    {
+        return 0x06;    // INVALID_EVENT_ID
+    }
+    t->used = FALSE;
+    return ZSUCCESS;
+}
+
+uint32 osal_get_timeoutEx(uint8 task_id, uint16 event_id)
+{
+    simTimer_t *t = simTimerFind(task_id, event_id);
+
+    return (t == NULL || t->expire <= simNow) ? 0 : (uint32)((t->expire - simNow + 999) / 1000);
+}
+
+uint32 osal_GetSystemClock(void)
+{
+    return (uint32)(simNow / 1000);
+}
+
+uint8 osal_pwrmgr_task_state(uint8 task_id, uint8 state)
+{
+    if (task_id >= SIM_TASKS)
+    {
+        return 0x03;
+    }
+    if (state == PWRMGR_HOLD)
+    {
+        simHolds |= BV(task_id);
+    }
+    else
+    {
+        simHolds &= ~BV(task_id);
+    }
+    return ZSUCCESS;
+}
+
+/*********************************************************************
+ * Messages and heap
+ */
+
+void *osal_mem_alloc(uint16 size)
+{
+    simStats_t *stats = &simShared->stats;
+    uint16 *p;
+
+    if (size == 0 || stats->heapCur + size + sizeof(uint16) > SIM_HEAP_LEN)
+    {
+        stats->heapFails++;
+        return NULL;
+    }
+    p = malloc(size + sizeof(uint32));
+    p[0] = size;
+    stats->heapCur += size + sizeof(uint16);
+    if (stats->heapCur > stats->heapPeak)
+    {
+        stats->heapPeak = stats->heapCur;
+    }
+    return (uint8 *)p + sizeof(uint32);
+}
+
+void osal_mem_free(void *ptr)
+{
+    uint16 *p;
+
+    if (ptr == NULL)
+    {
+        return;
+    }
+    p = (uint16 *)((uint8 *)ptr - sizeof(uint32));
+    simShared->stats.heapCur -= p[0] + sizeof(uint16);
+    free(p);
+}
+
+uint8 *osal_msg_allocate(uint16 len)
+{
+    simMsgHdr_t *hdr = osal_mem_alloc(sizeof(simMsgHdr_t) + len);
+
+    if (hdr == NULL)
+    {
+        return NULL;
+    }
+    hdr->len = len;
+    hdr->task = 0xFF;
+    return (uint8 *)(hdr + 1);
+}
+
+uint8 osal_msg_deallocate(uint8 *msg_ptr)
+{
+    if (msg_ptr == NULL)
+    {
+        return 0x05;    // INVALID_MSG_POINTER
+    }
+    osal_mem_free((simMsgHdr_t *)msg_ptr - 1);
+    return ZSUCCESS;
+}
+
+uint8 osal_msg_send(uint8 destination_task, uint8 *msg_ptr)
+{
+    if (destination_task >= SIM_TASKS || simTasks[destination_task] == NULL || simMsgCount == SIM_MSGS)
+    {
+        osal_msg_deallocate(msg_ptr);
+        return 0x03;
+    }
+    ((simMsgHdr_t *)msg_ptr - 1)->task = destination_task;
+    simMsgs[simMsgCount++] = msg_ptr;
+    simShared->stats.msgs++;
+    osal_set_event(destination_task, SYS_EVENT_MSG);
+    return ZSUCCESS;
+}
+
+uint8 *osal_msg_receive(uint8 task_id)
+{
+    uint8 *msg = NULL;
+    uint8 i;
+
+    for (i = 0; i < simMsgCount; i++)
+    {
+        if (((simMsgHdr_t *)simMsgs[i] - 1)->task == task_id)
+        {
+            msg = simMsgs[i];
+            break;
+        }
+    }
+    if (msg == NULL)
+    {
+        return NULL;
+    }
+    memmove(&simMsgs[i], &simMsgs[i + 1], (simMsgCount - i - 1) * sizeof(simMsgs[0]));
+    simMsgCount--;
+    for (i = 0; i < simMsgCount; i++)
+    {
+        if (((simMsgHdr_t *)simMsgs[i] - 1)->task == task_id)
+        {
+            osal_set_event(task_id, SYS_EVENT_MSG);
+            break;
+        }
+    }
+    return msg;
+}
+
+/*********************************************************************
+ * NV
+ */
+
+static simNvItem_t *simNvFind(uint16 id)
+{
+    for (uint8 i = 0; i < SIM_NV_ITEMS; i++)
+    {
+        if (simShared->nv[i].used && simShared->nv[i].id == id)
+        {
+            return &simShared->nv[i];
+        }
+    }
+    return NULL;
+}
+
+// a lookup reads the header of every record in the page
+static uint16 simNvScan(void)
+{
+    uint16 records = SIM_NV_STACK_ITEMS + simShared->nvRecords;
+
+    simAdvanceNs((uint32)records * SIM_NV_HDR_BYTES * SIM_FLASH_READ_NS);
+    return records;
+}
+
+// write a new copy of the item and invalidate the old one, compact a full page
+static uint8 simNvAppend(simNvItem_t *item)
+{
+    uint16 bytes = SIM_NV_HDR_BYTES + ((item->len + 3) & ~3);
+
+    if (!HalAdcCheckVdd(VDD_MIN_NV))
+    {
+        simShared->stats.nvFailures++;
+        return NV_OPER_FAILED;
+    }
+    if (simShared->nvPageUsed + bytes > HAL_FLASH_PAGE_SIZE)
+    {
+        uint16 live = SIM_NV_STACK_BYTES + SIM_NV_STACK_ITEMS * SIM_NV_HDR_BYTES;
+        uint16 records = 0;
+
+        for (uint8 i = 0; i < SIM_NV_ITEMS; i++)
+        {
+            if (simShared->nv[i].used && &simShared->nv[i] != item)
+            {
+                live += SIM_NV_HDR_BYTES + ((simShared->nv[i].len + 3) & ~3);
+                records++;
+            }
+        }
+        simAdvance((uint32)live / HAL_FLASH_WORD_SIZE * SIM_FLASH_WORD_US + SIM_FLASH_ERASE_US);
+        simShared->nvPageUsed = live;
+        simShared->nvRecords = records;
+        simShared->stats.nvCompactions++;
+    }
+    simAdvance((uint32)(bytes / HAL_FLASH_WORD_SIZE + 1) * SIM_FLASH_WORD_US);
+    simShared->nvPageUsed += bytes;
+    simShared->nvRecords++;
+    simShared->stats.nvWrites++;
+    return ZSUCCESS;
+}
+
+uint8 osal_nv_item_init(uint16 id, uint16 len, void *buf)
+{
+    simNvItem_t *item;
+
+    simNvScan();
+    if (simNvFind(id) != NULL)
+    {
+        return ZSUCCESS;
+    }
+    if (len > SIM_NV_ITEM_MAX)
+    {
+        return NV_OPER_FAILED;
+    }
+    for (uint8 i = 0; i < SIM_NV_ITEMS; i++)
+    {
+        item = &simShared->nv[i];
+        if (!item->used)
+        {
+            item->id = id;
+            item->len = len;
+            memset(item->data, 0xFF, len);
+            if (buf != NULL)
+            {
+                memcpy(item->data, buf, len);
+            }
+            if (simNvAppend(item) != ZSUCCESS)
+            {
+                return NV_OPER_FAILED;
+            }
+            item->used = TRUE;
+            return NV_ITEM_UNINIT;
+        }
+    }
+    return NV_OPER_FAILED;
+}
+
+uint8 osal_nv_read(uint16 id, uint16 offset, uint16 len, void *buf)
+{
+    simNvItem_t *item;
+
+    simNvScan();
+    item = simNvFind(id);
+    if (item == NULL || offset + len > item->len)
+    {
+        return NV_OPER_FAILED;
+    }
+    simAdvanceNs((uint32)len * SIM_FLASH_READ_NS);
+    memcpy(buf, item->data + offset, len);
+    return ZSUCCESS;
+}
+
+uint8 osal_nv_write(uint16 id, uint16 offset, uint16 len, void *buf)
+{
+    simNvItem_t *item;
+    simNvItem_t copy;
+
+    simNvScan();
+    item = simNvFind(id);
+    if (item == NULL)
+    {
+        return NV_ITEM_UNINIT;
+    }
+    if (offset + len > item->len)
+    {
+        return NV_OPER_FAILED;
+    }
+    copy = *item;
+    memcpy(copy.data + offset, buf, len);
+    if (simNvAppend(&copy) != ZSUCCESS)
+    {
+        return NV_OPER_FAILED;
+    }
+    *item = copy;
+    return ZSUCCESS;
+}
+
+uint16 osal_nv_item_len(uint16 id)
+{
+    simNvItem_t *item = simNvFind(id);
+
+    return item ? item->len : 0;
+}
+
+/**************************************************************************************************
+ * @fn      sim_NvRead
+ *
+ * @brief   Peek at an OSAL NV item without charging time
+ *
+ * @param   id - item ID
+ * @param   len - bytes to read
+ * @param   buf - output
+ *
+ * @return  TRUE if the item exists
+ **************************************************************************************************/
+bool sim_NvRead(uint16 id, uint16 len, void *buf)
+{
+    simNvItem_t *item = simNvFind(id);
+
+    if (item == NULL || len > item->len)
+    {
+        return FALSE;
+    }
+    memcpy(buf, item->data, len);
+    return TRUE;
+}
+
+/*********************************************************************
+ * Utilities
+ */
+
+uint16 osal_rand(void)
+{
+    return (uint16)simRandom();
+}
+
+void *osal_memcpy(void *dst, const void *src, unsigned int len)
+{
+    memcpy(dst, src, len);
+    return (uint8 *)dst + len;
+}
+
+void *osal_memset(void *dest, uint8 value, int len)
+{
+    return memset(dest, value, len);
+}
+
+uint8 osal_memcmp(const void *src1, const void *src2, unsigned int len)
+{
+    return memcmp(src1, src2, len) == 0;
+}
+
+void MicroWait(uint16 timeout)
+{
+    simAdvance(timeout);
+}
+
+void halAssertHandler(void)
+{
+    simShared->stats.asserts++;
+}
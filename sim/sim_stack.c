@@ -0,0 +1,505 @@
+#include <string.h>
+
+#include "OSAL.h"
+#include "ZDApp.h"
+#include "ZMAC.h"
+#include "bdb_interface.h"
+#include "nwk.h"
+#include "zcl.h"
+
+#include "sim_internal.h"
+
+/*
+ * Stack stand-in. Steering, network restore at boot and rejoins complete
+ * after the configured delays, when the network is present and, for a
+ * rejoin, the channel mask covers its channel. BDB takes the beacon
+ * notification callback over while steering and deregisters it when
+ * done, like bdb_nwkDiscoveryAttempt of Z-Stack 3.0.2.
+ */
+
+#define SIM_STACK_STEER_EVT      0x0001
+#define SIM_STACK_REJOIN_EVT     0x0002
+#define SIM_STACK_RESTORE_EVT    0x0004
+
+#define SIM_DEVICE_EXT_ADDR      { 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88 }
+
+nwkIB_t _NIB;
+devStates_t devState = DEV_HOLD;
+uint32 zgDefaultChannelList = 0x07FFF800;
+uint8 ZDO_UseExtendedPANID[Z_EXTADDR_LEN];
+bdbAttributes_t bdbAttributes;
+bool requestNewTrustCenterLinkKey = TRUE;
+
+static uint8 simStackTask;
+static uint8 simExtAddr[Z_EXTADDR_LEN] = SIM_DEVICE_EXT_ADDR;
+static bdbGCB_CommissioningStatus_t simBdbStatusCb = NULL;
+static pfnZdoCb simBeaconCb = NULL;
+static uint32 simRejoinMask;
+static uint8 simSteerModes;
+static uint8 simZclSeq = 0;
+static simReport_t simLastReport;
+
+static void *simBdbBeaconNotify(void *param);
+static void simBdbReport(uint8 mode, uint8 status, uint8 remaining);
+static void simNetJoined(void);
+
+void simStackInit(uint8 task_id)
+{
+    simStackTask = task_id;
+    // zgPollRate default until the application changes it
+    simShared->stats.pollRate = POLL_RATE;
+    bdbAttributes.bdbNodeIsOnANetwork = simShared->net.joined;
+    bdbAttributes.bdbPrimaryChannelSet = zgDefaultChannelList;
+}
+
+/**************************************************************************************************
+ * @fn      sim_NetSetup
+ *
+ * @brief   Configure the network the device finds
+ *
+ * @param   present - network reachable
+ * @param   channel - its channel, 11..26
+ * @param   panId - its PAN ID
+ * @param   joinMs - steering time
+ * @param   rejoinMs - rejoin and restore time
+ *
+ * @return  None
+ **************************************************************************************************/
+void sim_NetSetup(bool present, uint8 channel, uint16 panId, uint32 joinMs, uint32 rejoinMs)
+{
+    simNet_t *net = &simShared->net;
+
+    net->present = present;
+    net->channel = channel;
+    net->panId = panId;
+    for (uint8 i = 0; i < Z_EXTADDR_LEN; i++)
+    {
+        net->extPanId[i] = (uint8)(panId >> (8 * (i & 1))) ^ i;
+    }
+    net->parentAddr = 0x0000;
+    net->joinMs = joinMs;
+    net->rejoinMs = rejoinMs;
+}
+
+void sim_NetPresent(bool present)
+{
+    simShared->net.present = present;
+}
+
+bool simOnNetwork(void)
+{
+    return devState == DEV_END_DEVICE;
+}
+
+/**************************************************************************************************
+ * @fn      sim_NetParentLost
+ *
+ * @brief   Parent stopped answering polls, the device becomes an orphan
+ *          and BDB reports the loss
+ *
+ * @param   None
+ *
+ * @return  None
+ **************************************************************************************************/
+void sim_NetParentLost(void)
+{
+    ZDApp_ChangeState(DEV_NWK_ORPHAN);
+    simBdbReport(BDB_COMMISSIONING_PARENT_LOST, BDB_COMMISSIONING_NO_NETWORK, 0);
+}
+
+/**************************************************************************************************
+ * @fn      sim_NetBeacon
+ *
+ * @brief   Deliver a beacon of a router of the network to the callback
+ *          registered for ZDO_BEACON_NOTIFY_IND_CBID
+ *
+ * @param   addr - router short address
+ * @param   lqi - link quality
+ * @param   capacity - router accepts end devices
+ *
+ * @return  None
+ **************************************************************************************************/
+void sim_NetBeacon(uint16 addr, uint8 lqi, bool capacity)
+{
+    zdoBeaconInd_t beacon;
+
+    memset(&beacon, 0, sizeof(beacon));
+    beacon.sourceAddr = addr;
+    beacon.panID = simShared->net.panId;
+    beacon.logicalChannel = simShared->net.channel;
+    beacon.permitJoining = TRUE;
+    beacon.routerCapacity = capacity;
+    beacon.deviceCapacity = capacity;
+    beacon.LQI = lqi;
+    memcpy(beacon.extendedPanID, simShared->net.extPanId, Z_EXTADDR_LEN);
+    if (simBeaconCb)
+    {
+        simBeaconCb(&beacon);
+    }
+}
+
+bool sim_BeaconCbOwnedByApp(void)
+{
+    return simBeaconCb != NULL && simBeaconCb != simBdbBeaconNotify;
+}
+
+const simReport_t *sim_LastReport(void)
+{
+    return &simLastReport;
+}
+
+/**************************************************************************************************
+ * @fn      simStackEvents
+ *
+ * @brief   Stack model task, completes steering, restore and rejoin
+ *
+ * @param   task_id - task ID
+ * @param   events - pending events
+ *
+ * @return  events left
+ **************************************************************************************************/
+uint16 simStackEvents(uint8 task_id, uint16 events)
+{
+    simNet_t *net = &simShared->net;
+
+    (void)task_id;
+    if (events & SIM_STACK_STEER_EVT)
+    {
+        ZDO_DeregisterForZdoCB(ZDO_BEACON_NOTIFY_IND_CBID);
+        if (net->present)
+        {
+            simNetJoined();
+            simBdbReport(BDB_COMMISSIONING_NWK_STEERING, BDB_COMMISSIONING_SUCCESS,
+                         simSteerModes & BDB_COMMISSIONING_MODE_FINDING_BINDING);
+            if (simSteerModes & BDB_COMMISSIONING_MODE_FINDING_BINDING)
+            {
+                simBdbReport(BDB_COMMISSIONING_FINDING_BINDING, BDB_COMMISSIONING_FB_NO_IDENTIFY_QUERY_RESPONSE, 0);
+            }
+        }
+        else
+        {
+            simBdbReport(BDB_COMMISSIONING_NWK_STEERING, BDB_COMMISSIONING_NO_NETWORK, 0);
+        }
+        return events ^ SIM_STACK_STEER_EVT;
+    }
+
+    if (events & SIM_STACK_RESTORE_EVT)
+    {
+        if (net->present)
+        {
+            simNetJoined();
+            simBdbReport(BDB_COMMISSIONING_INITIALIZATION, BDB_COMMISSIONING_NETWORK_RESTORED, 0);
+        }
+        else
+        {
+            sim_NetParentLost();
+        }
+        return events ^ SIM_STACK_RESTORE_EVT;
+    }
+
+    if (events & SIM_STACK_REJOIN_EVT)
+    {
+        if (net->present && (simRejoinMask & ((uint32)1 << net->channel)))
+        {
+            simNetJoined();
+            simBdbReport(BDB_COMMISSIONING_PARENT_LOST, BDB_COMMISSIONING_NETWORK_RESTORED, 0);
+        }
+        else
+        {
+            sim_NetParentLost();
+        }
+        return events ^ SIM_STACK_REJOIN_EVT;
+    }
+    return 0;
+}
+
+static void simNetJoined(void)
+{
+    simNet_t *net = &simShared->net;
+
+    _NIB.nwkLogicalChannel = net->channel;
+    _NIB.nwkPanId = net->panId;
+    _NIB.nwkCoordAddress = net->parentAddr;
+    _NIB.nwkDevAddress = 0x4A21;
+    memcpy(_NIB.extendedPANID, net->extPanId, Z_EXTADDR_LEN);
+    memset(_NIB.nwkCoordExtAddress, 0, Z_EXTADDR_LEN);
+    net->joined = TRUE;
+    bdbAttributes.bdbNodeIsOnANetwork = TRUE;
+    ZDApp_ChangeState(DEV_END_DEVICE);
+}
+
+static void simBdbReport(uint8 mode, uint8 status, uint8 remaining)
+{
+    bdbCommissioningModeMsg_t msg;
+
+    msg.bdbCommissioningMode = mode;
+    msg.bdbCommissioningStatus = status;
+    msg.bdbRemainingCommissioningModes = remaining;
+    if (simBdbStatusCb)
+    {
+        simBdbStatusCb(&msg);
+    }
+}
+
+static void *simBdbBeaconNotify(void *param)
+{
+    (void)param;
+    return NULL;
+}
+
+/*********************************************************************
+ * ZDO
+ */
+
+// the real ZDApp notifies tasks of registered endpoints, all of them here
+void ZDApp_ChangeState(devStates_t state)
+{
+    devState = state;
+    for (uint8 task = 0; task < 3; task++)
+    {
+        osal_event_hdr_t *msg;
+
+        if (task == simStackTask)
+        {
+            continue;
+        }
+        msg = (osal_event_hdr_t *)osal_msg_allocate(sizeof(osal_event_hdr_t));
+        if (msg)
+        {
+            msg->event = ZDO_STATE_CHANGE;
+            msg->status = (uint8)state;
+            osal_msg_send(task, (uint8 *)msg);
+        }
+    }
+}
+
+uint8 ZDApp_RestoreNwkKey(uint8 incrFrmCnt)
+{
+    (void)incrFrmCnt;
+    return simShared->net.joined;
+}
+
+uint8 ZDO_RegisterForZdoCB(uint8 indID, pfnZdoCb pFn)
+{
+    if (indID == ZDO_BEACON_NOTIFY_IND_CBID)
+    {
+        simBeaconCb = pFn;
+    }
+    return ZSUCCESS;
+}
+
+uint8 ZDO_DeregisterForZdoCB(uint8 indID)
+{
+    if (indID == ZDO_BEACON_NOTIFY_IND_CBID)
+    {
+        simBeaconCb = NULL;
+    }
+    return ZSUCCESS;
+}
+
+/*********************************************************************
+ * NWK and MAC
+ */
+
+void NLME_SetPollRate(uint32 newRate)
+{
+    simPollRate(newRate);
+}
+
+uint8 *NLME_GetExtAddr(void)
+{
+    return simExtAddr;
+}
+
+ZStatus_t NLME_ReJoinRequest(uint8 *ExtendedPANID, uint32 channels)
+{
+    simShared->stats.rejoins++;
+    simShared->stats.lastRejoinMask = channels;
+    simRejoinMask = memcmp(ExtendedPANID, simShared->net.extPanId, Z_EXTADDR_LEN) == 0 ? channels : 0;
+    osal_start_timerEx(simStackTask, SIM_STACK_REJOIN_EVT, simShared->net.rejoinMs);
+    return ZSUCCESS;
+}
+
+uint8 ZMacSetTransmitPower(ZMacTransmitPower_t level)
+{
+    simShared->stats.txPower = (int8)level;
+    return ZSUCCESS;
+}
+
+/*********************************************************************
+ * BDB
+ */
+
+void bdb_RegisterCommissioningStatusCB(bdbGCB_CommissioningStatus_t bdbGCB_CommissioningStatus)
+{
+    simBdbStatusCb = bdbGCB_CommissioningStatus;
+}
+
+void bdb_RegisterBindNotificationCB(bdbGCB_BindNotification_t pfnBindNotification)
+{
+    (void)pfnBindNotification;
+}
+
+// a device on a network restores it first, others start steering
+void bdb_StartCommissioning(uint8 mode)
+{
+    if (simShared->net.joined)
+    {
+        osal_start_timerEx(simStackTask, SIM_STACK_RESTORE_EVT, simShared->net.rejoinMs);
+        return;
+    }
+    simBdbReport(BDB_COMMISSIONING_INITIALIZATION, BDB_COMMISSIONING_NO_NETWORK, mode);
+    if (mode & BDB_COMMISSIONING_MODE_NWK_STEERING)
+    {
+        simSteerModes = mode;
+        ZDO_RegisterForZdoCB(ZDO_BEACON_NOTIFY_IND_CBID, simBdbBeaconNotify);
+        ZDApp_ChangeState(DEV_NWK_DISC);
+        simBdbReport(BDB_COMMISSIONING_NWK_STEERING, BDB_COMMISSIONING_IN_PROGRESS, mode);
+        osal_start_timerEx(simStackTask, SIM_STACK_STEER_EVT, simShared->net.joinMs);
+    }
+}
+
+// rejoin on the channels BDB would use, the default channel list, BDB
+// refuses unless the parent is lost
+ZStatus_t bdb_ZedAttemptRecoverNwk(void)
+{
+    simShared->stats.recoverCalls++;
+    if (devState != DEV_NWK_ORPHAN)
+    {
+        return ZFAILURE;
+    }
+    ZDApp_ChangeState(DEV_NWK_SEC_REJOIN_CURR_CHANNEL);
+    return NLME_ReJoinRequest(simShared->net.extPanId, zgDefaultChannelList);
+}
+
+uint8 bdb_getZCLFrameCounter(void)
+{
+    return simZclSeq++;
+}
+
+ZStatus_t bdb_RepChangedAttrValue(uint8 endpoint, uint16 cluster, uint16 attrID)
+{
+    (void)endpoint;
+    (void)cluster;
+    (void)attrID;
+    return ZSUCCESS;
+}
+
+void bdb_resetLocalAction(void)
+{
+    simShared->stats.factoryResets++;
+    simShared->net.joined = FALSE;
+    bdbAttributes.bdbNodeIsOnANetwork = FALSE;
+}
+
+void bindCapacity(uint16 *maxEntries, uint16 *usedEntries)
+{
+    *maxEntries = 10;
+    *usedEntries = 0;
+}
+
+/*********************************************************************
+ * ZCL
+ */
+
+uint8 zclGetDataTypeLength(uint8 dataType)
+{
+    switch (dataType)
+    {
+    case ZCL_DATATYPE_BOOLEAN:
+    case ZCL_DATATYPE_BITMAP8:
+    case ZCL_DATATYPE_UINT8:
+    case ZCL_DATATYPE_INT8:
+    case ZCL_DATATYPE_ENUM8:
+        return 1;
+    case ZCL_DATATYPE_BITMAP16:
+    case ZCL_DATATYPE_UINT16:
+    case ZCL_DATATYPE_INT16:
+    case ZCL_DATATYPE_ENUM16:
+        return 2;
+    case ZCL_DATATYPE_UINT24:
+    case ZCL_DATATYPE_INT24:
+        return 3;
+    case ZCL_DATATYPE_BITMAP32:
+    case ZCL_DATATYPE_UINT32:
+    case ZCL_DATATYPE_INT32:
+    case ZCL_DATATYPE_SINGLE_PREC:
+    case ZCL_DATATYPE_UTC:
+        return 4;
+    case ZCL_DATATYPE_UINT48:
+        return 6;
+    case ZCL_DATATYPE_INT64:
+    case ZCL_DATATYPE_IEEE_ADDR:
+        return 8;
+    default:
+        return 0;
+    }
+}
+
+uint16 zclGetAttrDataLength(uint8 dataType, uint8 *pData)
+{
+    if (dataType == ZCL_DATATYPE_OCTET_STR || dataType == ZCL_DATATYPE_CHAR_STR)
+    {
+        return pData[0] + 1;
+    }
+    return zclGetDataTypeLength(dataType);
+}
+
+uint8 zclAnalogDataType(uint8 dataType)
+{
+    return (dataType >= ZCL_DATATYPE_UINT8 && dataType <= ZCL_DATATYPE_INT64) ||
+           dataType == ZCL_DATATYPE_SINGLE_PREC || dataType == ZCL_DATATYPE_UTC;
+}
+
+// frame header and per attribute ID, type and value
+ZStatus_t zcl_SendReportCmd(uint8 srcEP, afAddrType_t *dstAddr, uint16 clusterID, zclReportCmd_t *reportCmd,
+                            uint8 direction, uint8 disableDefaultRsp, uint8 seqNum)
+{
+    uint16 bytes = 3;
+
+    (void)srcEP;
+    (void)dstAddr;
+    (void)direction;
+    (void)disableDefaultRsp;
+    (void)seqNum;
+    memset(&simLastReport, 0, sizeof(simLastReport));
+    simLastReport.clusterID = clusterID;
+    simLastReport.numAttr = reportCmd->numAttr;
+    for (uint8 i = 0; i < reportCmd->numAttr; i++)
+    {
+        zclReport_t *attr = &reportCmd->attrList[i];
+        uint16 len = zclGetAttrDataLength(attr->dataType, attr->attrData);
+
+        bytes += 3 + len;
+        if (i < 8)
+        {
+            simLastReport.attrID[i] = attr->attrID;
+            memcpy(&simLastReport.value[i], attr->attrData, len < 4 ? len : 4);
+        }
+    }
+    simShared->stats.reports++;
+    simShared->stats.reportBytes += bytes;
+    return ZSUCCESS;
+}
+
+ZStatus_t zcl_SendConfigReportRspCmd(uint8 srcEP, afAddrType_t *dstAddr, uint16 clusterID,
+                                     zclCfgReportRspCmd_t *cfgReportRspCmd, uint8 direction,
+                                     uint8 disableDefaultRsp, uint8 seqNum)
+{
+    (void)srcEP;
+    (void)dstAddr;
+    (void)clusterID;
+    (void)cfgReportRspCmd;
+    (void)direction;
+    (void)disableDefaultRsp;
+    (void)seqNum;
+    return ZSUCCESS;
+}
+
+ZStatus_t zcl_registerAttrList(uint8 endpoint, uint8 numAttr, const zclAttrRec_t attrList[])
+{
+    (void)endpoint;
+    (void)numAttr;
+    (void)attrList;
+    return ZSUCCESS;
+}
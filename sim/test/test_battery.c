@@ -0,0 +1,86 @@
+#include <stdio.h>
+
+// custom curve with slopes computed at runtime, served before the bundled ones
+#define BAT_PMAP         { { 2000, 0 }, { 2300, 40 }, { 2750, 120 }, { 3100, 200 } }
+
+// built in, for the static curves and interpolation
+#include "../../battery.c"
+
+#include "sim.h"
+
+/*
+ * Charge curves against a double precision reference: every millivolt
+ * from below the first point to above the last one, for each profile.
+ * The Q10 slopes and rounded interpolation must stay within one unit
+ * (0.5 %) of the exact line between points, hit every point exactly and
+ * never decrease with voltage.
+ */
+
+#define MARGIN_MV        100
+
+// exact linear interpolation between the curve points, 0.5 % units
+static double reference(const bat_charge_t *p, uint8 count, uint16 mV)
+{
+    uint8 i;
+
+    if (mV <= p[0].mV)
+    {
+        return p[0].perc;
+    }
+    for (i = 1; i < count; i++)
+    {
+        if (mV < p[i].mV)
+        {
+            return p[i - 1].perc +
+                   (double)(mV - p[i - 1].mV) * (p[i].perc - p[i - 1].perc) / (p[i].mV - p[i - 1].mV);
+        }
+    }
+    return p[count - 1].perc;
+}
+
+static void checkProfile(const bat_profile_t *profile)
+{
+    const bat_charge_t *p = profile->points;
+    uint16 from = p[0].mV - MARGIN_MV;
+    uint16 to = p[profile->count - 1].mV + MARGIN_MV;
+    uint8 prev = 0;
+    double worst = 0;
+
+    for (uint8 i = 0; i < profile->count; i++)
+    {
+        SIM_CHECK(zclBatteryPercentage(profile, p[i].mV) == p[i].perc);
+    }
+    for (uint16 mV = from; mV <= to; mV++)
+    {
+        uint8 perc = zclBatteryPercentage(profile, mV);
+        double err = perc - reference(p, profile->count, mV);
+
+        if (err < 0)
+        {
+            err = -err;
+        }
+        if (err > worst)
+        {
+            worst = err;
+        }
+        SIM_CHECK(err <= 1.0);
+        SIM_CHECK(perc >= prev);
+        prev = perc;
+    }
+    printf("size %u x%u: %u..%u mV, max error %.3f (0.5 %% units)\n", profile->size, profile->quantity, from, to,
+           worst);
+}
+
+int main(void)
+{
+    sim_Reset(1);
+
+    // computes the custom curve slopes
+    SIM_CHECK(zclBatteryProfile() == &bat_profiles[0]);
+    for (uint8 i = 0; i < COUNT_OF(bat_profiles); i++)
+    {
+        checkProfile(&bat_profiles[i]);
+    }
+
+    return sim_Failures() ? 1 : 0;
+}
@@ -0,0 +1,67 @@
+#include <stdio.h>
+
+#include "ZDApp.h"
+#include "battery.h"
+#include "commissioning.h"
+#include "debug_print.h"
+#include "factory_reset.h"
+#include "report_batch.h"
+
+#include "sim.h"
+
+/*
+ * Library logging and tracing through a debug backend: join, a battery
+ * report and a parent loss with DebugInit called like an application
+ * would. With DEBUG_PRINT_STDIO the text goes to stdout. With the UART
+ * backends the UART output is written to the file given as argument,
+ * for tools/detokenize.py and tools/trace2json.py.
+ */
+
+static const char *capturePath = NULL;
+
+static void bootDebug(void)
+{
+    const uint8 *data;
+    uint16 len;
+
+    sim_InitTasks(NULL);
+    SIM_CHECK(DebugInit());
+    zclFactoryResetter_Init();
+    zclReportBatch_Init();
+    zclBattery_Init();
+    zclCommissioning_Init();
+
+    sim_Run(15000);
+    SIM_CHECK(devState == DEV_END_DEVICE);
+    zclBatteryReport(TRUE);
+    sim_Run(5000);
+    sim_NetParentLost();
+    sim_Run(60000);
+    SIM_CHECK(devState == DEV_END_DEVICE);
+    DebugFlush();
+
+    len = sim_UartCapture(&data);
+    if (capturePath != NULL)
+    {
+        FILE *file = fopen(capturePath, "wb");
+
+        SIM_CHECK(file != NULL);
+        if (file != NULL)
+        {
+            SIM_CHECK(fwrite(data, 1, len, file) == len);
+            fclose(file);
+        }
+    }
+    printf("%u bytes of UART output\n", len);
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1)
+    {
+        capturePath = argv[1];
+    }
+    sim_Reset(1);
+    SIM_CHECK(sim_Boot(bootDebug) == SIM_BOOT_OK);
+    return sim_Failures() ? 1 : 0;
+}
@@ -0,0 +1,268 @@
+#include <stdio.h>
+
+#include "hal_adc.h"
+#include "fixedpoint.h"
+#include "utils.h"
+
+#include "sim.h"
+
+/*
+ * fixedpoint kernels against the utils.h macros they replace: fpScale
+ * and FP_ADC2MV give the same result as SCALE and ADC2MV, FP_UDIV16 the
+ * same as division, fpMap is within one unit of MAP and of the exact
+ * line, saturating operations clamp where plain ones would wrap.
+ */
+
+#define RANDOM_VALUES    200000
+
+static const int16 edges16[] = { -32768, -32767, -256, -255, -181, -2, -1, 0, 1, 2, 181, 255, 256, 32766, 32767 };
+
+static uint32 lcg = 12345;
+
+static uint32 rnd(void)
+{
+    lcg = lcg * 1664525u + 1013904223u;
+    return lcg;
+}
+
+static int32 clamp16(int32 v)
+{
+    return v > 32767 ? 32767 : v < -32768 ? -32768 : v;
+}
+
+static int32 clampU16(int32 v)
+{
+    return v > 65535 ? 65535 : v < 0 ? 0 : v;
+}
+
+// SCALE wraps on overflow, fpScale saturates
+static int32 scaleReference(int32 value, int8 scale)
+{
+    long long v = value;
+    int32 out;
+
+    for (int8 s = scale; s > 0; s--)
+    {
+        v *= 10;
+        if (v > 0x7FFFFFFFLL || v < -0x80000000LL)
+        {
+            return v > 0 ? 0x7FFFFFFF : (int32)0x80000000;
+        }
+    }
+    SCALE(out, value, scale);
+    return out;
+}
+
+static void checkScale(int32 value)
+{
+    for (int8 scale = -11; scale <= 11; scale++)
+    {
+        if (fpScale(value, scale) != scaleReference(value, scale))
+        {
+            printf("fpScale(%d, %d) = %d, SCALE %d\n", value, scale, fpScale(value, scale),
+                   scaleReference(value, scale));
+            sim_Fail(__FILE__, __LINE__, "fpScale == SCALE");
+            return;
+        }
+    }
+}
+
+static void testScale(void)
+{
+    static const int32 edges[] =
+    {
+        0, 1, -1, 9, 10, 11, -9, -10, -11, 99999, 100000, 214748364, 214748365, 999999999, 1000000000,
+        -1000000000, 2147483647, -2147483647 - 1
+    };
+    long long p = 1;
+
+    for (uint8 i = 0; i < COUNT_OF(edges); i++)
+    {
+        checkScale(edges[i]);
+    }
+    // either side of every power of ten
+    for (uint8 i = 0; i < 10; i++, p *= 10)
+    {
+        for (int8 d = -1; d <= 1; d++)
+        {
+            checkScale((int32)(p + d));
+            checkScale((int32)(-p + d));
+        }
+    }
+    for (uint32 n = 0; n < RANDOM_VALUES; n++)
+    {
+        int32 v = (int32)rnd();
+
+        checkScale(n & 1 ? v >> (n % 31) : v);
+    }
+}
+
+static void testAdc2Mv(void)
+{
+    static const uint16 refs[] = { 1150, 1250, 3300 };
+
+    for (uint8 res = HAL_ADC_RESOLUTION_8; res <= HAL_ADC_RESOLUTION_14; res++)
+    {
+        for (uint8 r = 0; r < COUNT_OF(refs); r++)
+        {
+            for (uint16 raw = 0; raw < (32u << res * 2); raw++)
+            {
+                if (FP_ADC2MV(raw, refs[r], res) != ADC2MV(raw, refs[r], res))
+                {
+                    printf("FP_ADC2MV(%u, %u, %u) = %u, ADC2MV %u\n", raw, refs[r], res,
+                           FP_ADC2MV(raw, refs[r], res), ADC2MV(raw, refs[r], res));
+                    sim_Fail(__FILE__, __LINE__, "FP_ADC2MV == ADC2MV");
+                    break;
+                }
+            }
+        }
+    }
+}
+
+static void testUdiv16(void)
+{
+    static const uint16 divisors[] = { 1, 2, 3, 5, 7, 10, 60, 100, 1000, 1440, 3600, 10000, 32767, 32768 };
+
+    // every dividend for the constants in use and a few awkward ones
+    for (uint8 i = 0; i < COUNT_OF(divisors); i++)
+    {
+        uint16 d = divisors[i];
+        uint32 x;
+
+        for (x = 0; x <= 0xFFFF; x++)
+        {
+            if (FP_UDIV16(x, d) != x / d)
+            {
+                break;
+            }
+        }
+        SIM_CHECK(x == 0x10000);
+    }
+    // every divisor, dividends around its multiples and the top
+    for (uint32 d = 1; d <= 32768; d++)
+    {
+        uint32 x[] = { 0, d - 1, d, d + 1, 2 * d - 1, 0xFFFF - d, 0xFFFE, 0xFFFF, rnd() & 0xFFFF };
+
+        for (uint8 i = 0; i < COUNT_OF(x); i++)
+        {
+            if (x[i] <= 0xFFFF && FP_UDIV16(x[i], d) != x[i] / d)
+            {
+                printf("FP_UDIV16(%u, %u) = %u\n", x[i], d, FP_UDIV16(x[i], d));
+                sim_Fail(__FILE__, __LINE__, "FP_UDIV16 == x / d");
+                return;
+            }
+        }
+    }
+}
+
+static double checkMap(int16 inMin, int16 inMax, int16 outMin, int16 outMax)
+{
+    fpMap_t map;
+    int16 lo = inMin < inMax ? inMin : inMax;
+    int16 hi = inMin < inMax ? inMax : inMin;
+    uint32 step = ((uint32)(hi - lo) >> 12) + 1;
+    double worst = 0;
+
+    fpMapInit(&map, inMin, inMax, outMin, outMax);
+    for (int32 v = lo; v <= hi; v += step)
+    {
+        int32 got = fpMap(&map, (int16)v);
+        long long ref = MAP((long long)v, inMin, inMax, outMin, outMax);
+        double exact = outMin + (double)(v - inMin) * (outMax - outMin) / (inMax - inMin);
+        double err = got > exact ? got - exact : exact - got;
+
+        worst = err > worst ? err : worst;
+        SIM_CHECK(got - ref >= -1 && got - ref <= 1);
+        SIM_CHECK(err <= 1.0);
+    }
+    // clamped outside the input range
+    if (lo > -32768)
+    {
+        SIM_CHECK(fpMap(&map, lo - 1) == fpMap(&map, lo));
+    }
+    if (hi < 32767)
+    {
+        SIM_CHECK(fpMap(&map, hi + 1) == fpMap(&map, hi));
+    }
+    return worst;
+}
+
+static void testMap(void)
+{
+    static const int16 maps[][4] =
+    {
+        { 0, 2047, 0, 100 },
+        { 0, 100, 0, 2047 },
+        { 2200, 3000, 0, 200 },
+        { -40, 125, -4000, 12500 },
+        { 100, 0, 0, 255 },
+        { 0, 3, -32768, 32767 },
+        { -32768, 32767, 0, 1 },
+        { -32768, 32767, 32767, -32768 },
+    };
+    double worst = 0;
+
+    for (uint8 i = 0; i < COUNT_OF(maps); i++)
+    {
+        printf("fpMap %d..%d -> %d..%d: max error %.3f\n", maps[i][0], maps[i][1], maps[i][2], maps[i][3],
+               checkMap(maps[i][0], maps[i][1], maps[i][2], maps[i][3]));
+    }
+    for (uint16 n = 0; n < 200; n++)
+    {
+        int16 a = (int16)rnd();
+        int16 b = (int16)rnd();
+
+        if (a != b)
+        {
+            double err = checkMap(a, b, (int16)rnd(), (int16)rnd());
+
+            worst = err > worst ? err : worst;
+        }
+    }
+    printf("fpMap random ranges: max error %.3f\n", worst);
+}
+
+static void checkSat(int16 a, int16 b)
+{
+    uint16 ua = (uint16)a;
+    uint16 ub = (uint16)b;
+
+    SIM_CHECK(fpSatAdd16(a, b) == clamp16((int32)a + b));
+    SIM_CHECK(fpSatSub16(a, b) == clamp16((int32)a - b));
+    SIM_CHECK(fpSatMul16(a, b) == clamp16((int32)a * b));
+    SIM_CHECK(fpSatAddU16(ua, ub) == clampU16((int32)ua + ub));
+    SIM_CHECK(fpSatSubU16(ua, ub) == clampU16((int32)ua - ub));
+    SIM_CHECK(fpSatMulU16(ua, ub) == ((uint32)ua * ub > 0xFFFF ? 0xFFFF : ua * ub));
+}
+
+static void testSat(void)
+{
+    for (uint8 i = 0; i < COUNT_OF(edges16); i++)
+    {
+        for (uint8 j = 0; j < COUNT_OF(edges16); j++)
+        {
+            checkSat(edges16[i], edges16[j]);
+        }
+    }
+    for (uint32 n = 0; n < RANDOM_VALUES; n++)
+    {
+        uint32 r = rnd();
+
+        // small operands too, where products don't saturate
+        checkSat((int16)(r >> (n % 16)), (int16)((r >> 16) >> ((n / 16) % 16)));
+    }
+}
+
+int main(void)
+{
+    sim_Reset(1);
+
+    testScale();
+    testAdc2Mv();
+    testUdiv16();
+    testMap();
+    testSat();
+
+    printf("%u failures\n", sim_Failures());
+    return sim_Failures() ? 1 : 0;
+}
@@ -0,0 +1,97 @@
+#include <stdio.h>
+
+#include "bdb_interface.h"
+#include "commissioning.h"
+
+// plain BDB recovery on the first try, the way the link monitor rejoined before
+static bool plainRecovery = TRUE;
+#define LINK_MONITOR_REJOIN() (plainRecovery ? bdb_ZedAttemptRecoverNwk() : zclCommissioning_SwitchParent())
+
+// built in, for the bad link state
+#include "../../link_monitor.c"
+
+#include "sim.h"
+
+/*
+ * Bad parent link into a pre-emptive rejoin: the parent is barely heard
+ * for LINK_MONITOR_BAD_MS. A rejoin the stack refuses counts nothing and
+ * keeps the evidence, the retry goes through commissioning to the
+ * channel of the alternate parent heard and starts over with the new
+ * parent. Another bad link is held off.
+ */
+
+#define CHANNEL          15
+#define PAN_ID           0x1A62
+#define ALTERNATE        0x2B01
+#define LQI_BAD          20     // below LINK_MONITOR_LQI_MIN
+#define RSSI_BAD         -92
+#define SLACK_MS         5000
+
+static void badLink(void)
+{
+    for (uint8 i = 0; i < 8; i++)
+    {
+        zclLinkMonitor_Rx(LQI_BAD, RSSI_BAD);
+    }
+}
+
+static void bootBadLink(void)
+{
+    simStats_t *stats = sim_Stats();
+    uint16 rejoins;
+
+    sim_InitTasks(NULL);
+    zclCommissioning_Init();
+    sim_Run(5000);
+    SIM_CHECK(devState == DEV_END_DEVICE);
+    sim_NetBeacon(ALTERNATE, 200, TRUE);
+
+    badLink();
+    SIM_CHECK(linkMonitor_Bad);
+    SIM_CHECK(zclLinkMonitor_Stats.lqi == LQI_BAD);
+    rejoins = stats->rejoins;
+
+    // BDB refuses to recover a parent that is not lost
+    sim_Run(LINK_MONITOR_BAD_MS + SLACK_MS);
+    SIM_CHECK(stats->recoverCalls == 1);
+    SIM_CHECK(stats->rejoins == rejoins);
+    SIM_CHECK(devState == DEV_END_DEVICE);
+    SIM_CHECK(zclLinkMonitor_Stats.rejoins == 0);
+    SIM_CHECK(linkMonitor_Bad);
+    SIM_CHECK(zclLinkMonitor_Stats.lqi == LQI_BAD);
+
+    plainRecovery = FALSE;
+    sim_Run(LINK_MONITOR_REJOIN_RETRY_MS + SLACK_MS);
+    SIM_CHECK(stats->recoverCalls == 1);
+    SIM_CHECK(stats->rejoins == rejoins + 1);
+    SIM_CHECK(stats->lastRejoinMask == ((uint32)1 << CHANNEL));
+    SIM_CHECK(devState == DEV_END_DEVICE);
+    SIM_CHECK(zclLinkMonitor_Stats.rejoins == 1);
+    SIM_CHECK(!linkMonitor_Bad);
+    SIM_CHECK(zclLinkMonitor_Stats.lqi == 0xFF);
+
+    // no better parent either, wait for LINK_MONITOR_REJOIN_HOLDOFF_MS
+    badLink();
+    sim_Run(LINK_MONITOR_BAD_MS + SLACK_MS);
+    SIM_CHECK(stats->rejoins == rejoins + 1);
+    SIM_CHECK(linkMonitor_Bad);
+    sim_Run(LINK_MONITOR_REJOIN_HOLDOFF_MS);
+    SIM_CHECK(stats->rejoins == rejoins + 2);
+    SIM_CHECK(zclLinkMonitor_Stats.rejoins == 2);
+    SIM_CHECK(stats->heapCur == 0);
+}
+
+int main(void)
+{
+    simStats_t *stats;
+
+    sim_Reset(1);
+    stats = sim_Stats();
+    sim_NetSetup(TRUE, CHANNEL, PAN_ID, 3000, 500);
+
+    SIM_CHECK(sim_Boot(bootBadLink) == SIM_BOOT_OK);
+
+    printf("%u ms, %u wakeups, %u rejoins, %u failures\n", stats->timeMs, stats->wakeups, stats->rejoins,
+           sim_Failures());
+    return sim_Failures() ? 1 : 0;
+}
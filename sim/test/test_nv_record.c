@@ -0,0 +1,247 @@
+#include <stdio.h>
+
+// built in, for the active page offset
+#include "../../nv_record.c"
+
+#include "utils.h"
+
+#include "sim.h"
+
+/*
+ * nv_record across resets: power cut at every flash operation of a
+ * record write, of the first format and of a compaction, with the
+ * interrupted word landing partly. The next boot must read either the
+ * old or the new value of the record being written, the others intact,
+ * and further writes and compactions must keep working. Low supply
+ * defers writes and compaction instead of starting them.
+ */
+
+#define IDS_USED         3
+#define DEFAULT          0xDEF0
+#define VDD_LOW_MV       1900   // below VDD_MIN_NV
+#define VDD_MV           3000
+
+static uint16 expect[IDS_USED];
+static uint32 failures = 0;     // of the runs before the last sim_Reset
+static bool started = FALSE;
+
+// for the boot that runs next, forked with the parent's copy
+static uint8 writeId;
+static uint16 writeValue;
+
+static void bootRead(void)
+{
+    for (uint8 id = 0; id < IDS_USED; id++)
+    {
+        sim_User()[id] = zAppNvRecord_Read(id, DEFAULT);
+    }
+}
+
+static void bootWrite(void)
+{
+    zAppNvRecord_Write(writeId, writeValue);
+    SIM_CHECK(zAppNvRecord_Read(writeId, DEFAULT) == writeValue);
+}
+
+// the next write starts a compaction
+static void bootFill(void)
+{
+    uint16 value = zAppNvRecord_Read(IDS_USED - 1, DEFAULT);
+
+    while (nvRecord_Offset < NV_RECORD_PAGE_WORDS)
+    {
+        zAppNvRecord_Write(IDS_USED - 1, ++value);
+    }
+    sim_User()[IDS_USED - 1] = value;
+}
+
+static void bootWriteLowVdd(void)
+{
+    uint16 erases = sim_Stats()->flashErases;
+
+    sim_SetVdd(VDD_LOW_MV);
+    zAppNvRecord_Write(writeId, writeValue);
+    // kept in RAM
+    SIM_CHECK(zAppNvRecord_Read(writeId, DEFAULT) == writeValue);
+    SIM_CHECK(zAppNvRecord_Stats.lowVdd > 0);
+    SIM_CHECK(sim_Stats()->flashErases == erases);
+    sim_SetVdd(VDD_MV);
+}
+
+static void checkStored(void)
+{
+    SIM_CHECK(sim_Boot(bootRead) == SIM_BOOT_OK);
+    for (uint8 id = 0; id < IDS_USED; id++)
+    {
+        if (sim_User()[id] != expect[id])
+        {
+            printf("record %u: %04X, expected %04X\n", id, sim_User()[id], expect[id]);
+            sim_Fail(__FILE__, __LINE__, "stored == expected");
+        }
+    }
+}
+
+static void write(uint8 id, uint16 value)
+{
+    writeId = id;
+    writeValue = value;
+    SIM_CHECK(sim_Boot(bootWrite) == SIM_BOOT_OK);
+    expect[id] = value;
+    checkStored();
+}
+
+static void fill(void)
+{
+    SIM_CHECK(sim_Boot(bootFill) == SIM_BOOT_OK);
+    expect[IDS_USED - 1] = sim_User()[IDS_USED - 1];
+    checkStored();
+}
+
+static void start(void)
+{
+    if (started)
+    {
+        failures += sim_Failures();
+    }
+    started = TRUE;
+    sim_Reset(1);
+    for (uint8 id = 0; id < IDS_USED; id++)
+    {
+        expect[id] = DEFAULT;
+    }
+}
+
+/**************************************************************************************************
+ * @fn      interrupted
+ *
+ * @brief   Write a record in a boot cut at its op'th flash operation, then
+ *          check the next boot reads the old or the new value and the
+ *          record can still be written
+ *
+ * @param   id - record ID
+ * @param   value - value to write
+ * @param   op - flash operation to fail, 1 is the first of the write
+ * @param   torn - bytes of the interrupted word that land
+ *
+ * @return  SIM_BOOT_POWER_FAIL if the write reached the operation
+ **************************************************************************************************/
+static uint8 interrupted(uint8 id, uint16 value, uint32 op, uint8 torn)
+{
+    uint16 old = expect[id];
+    uint8 result;
+
+    writeId = id;
+    writeValue = value;
+    sim_PowerFailAt(sim_FlashOps() + op, torn);
+    result = sim_Boot(bootWrite);
+    sim_PowerFailAt(0, 0);
+    SIM_CHECK(result == SIM_BOOT_POWER_FAIL || result == SIM_BOOT_OK);
+
+    SIM_CHECK(sim_Boot(bootRead) == SIM_BOOT_OK);
+    if (sim_User()[id] != old && sim_User()[id] != value)
+    {
+        printf("record %u: %04X after reset at op %u, torn %u, expected %04X or %04X\n", id, sim_User()[id], op, torn,
+               old, value);
+        sim_Fail(__FILE__, __LINE__, "old or new value");
+    }
+    if (result == SIM_BOOT_OK)
+    {
+        SIM_CHECK(sim_User()[id] == value);
+    }
+    expect[id] = sim_User()[id];
+    checkStored();
+
+    write(id, value ^ 0x5A5A);
+    return result;
+}
+
+static void testTornRecord(void)
+{
+    static const uint16 values[] = { 0x0000, 0x00FF, 0xFF00, 0xFFFF, 0x1234, 0xFF12, 0x12FF };
+
+    for (uint8 torn = 0; torn < HAL_FLASH_WORD_SIZE; torn++)
+    {
+        start();
+        for (uint8 id = 0; id < IDS_USED; id++)
+        {
+            write(id, 0x1111 * (id + 1));
+        }
+        for (uint8 i = 0; i < COUNT_OF(values); i++)
+        {
+            for (uint8 id = 0; id < IDS_USED; id++)
+            {
+                SIM_CHECK(interrupted(id, values[i], 1, torn) == SIM_BOOT_POWER_FAIL);
+            }
+        }
+    }
+}
+
+// erase and header
+static void testTornFormat(void)
+{
+    for (uint32 op = 1; op <= 2; op++)
+    {
+        for (uint8 torn = 0; torn < HAL_FLASH_WORD_SIZE; torn++)
+        {
+            start();
+            SIM_CHECK(interrupted(0, 0x0001, op, torn) == SIM_BOOT_POWER_FAIL);
+        }
+    }
+}
+
+// erase, one word per record, header
+static void testTornCompaction(void)
+{
+    for (uint32 op = 1; op <= IDS_USED + 2; op++)
+    {
+        for (uint8 torn = 0; torn < HAL_FLASH_WORD_SIZE; torn++)
+        {
+            start();
+            for (uint8 id = 0; id < IDS_USED; id++)
+            {
+                write(id, 0x2222 * (id + 1));
+            }
+            fill();
+            SIM_CHECK(interrupted(0, 0xFFFF - op, op, torn) == SIM_BOOT_POWER_FAIL);
+
+            // and through the next compaction
+            fill();
+            write(1, 0x0102);
+        }
+    }
+}
+
+static void testLowVdd(void)
+{
+    start();
+    write(0, 0x0A0A);
+
+    writeId = 0;
+    writeValue = 0x0B0B;
+    SIM_CHECK(sim_Boot(bootWriteLowVdd) == SIM_BOOT_OK);
+    checkStored();
+    write(0, 0x0B0B);
+
+    // compaction deferred as well
+    fill();
+    writeValue = 0x0C0C;
+    SIM_CHECK(sim_Boot(bootWriteLowVdd) == SIM_BOOT_OK);
+    checkStored();
+    write(0, 0x0C0C);
+}
+
+int main(void)
+{
+    simStats_t *stats;
+
+    testTornRecord();
+    testTornFormat();
+    testTornCompaction();
+    testLowVdd();
+
+    stats = sim_Stats();
+    failures += sim_Failures();
+    printf("last run %u boots, %u flash words, %u erases; %u failures\n", stats->boots, stats->flashWrites,
+           stats->flashErases, failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,239 @@
+#include <stdio.h>
+
+// built in, for a look at the parent cache
+#include "../../commissioning.c"
+
+#include "zcl_general.h"
+#include "alarm_reporting.h"
+#include "battery.h"
+#include "factory_reset.h"
+#include "hal_key.h"
+#include "poll_control.h"
+#include "report_batch.h"
+#include "utils.h"
+
+#include "sim.h"
+
+/*
+ * End device life: join, battery and alarm reports, parent loss with a
+ * targeted rejoin, the network moving to the channel an alternate parent
+ * was heard on and then to another one, network restore after reboot,
+ * factory reset by quick reboots, and a long outage across a reboot with
+ * the rejoin budget spent.
+ */
+
+#define CHANNEL_LIST     0x07FFF800
+#define CHANNEL          11
+#define CHANNEL_MOVED    20
+#define CHANNEL_LAST     25
+#define PAN_ID           0x1A62
+#define ALTERNATE        0x2B01
+#define ALTERNATE_MOVED  0x3C02
+#define FAST_POLL_RATE   250      // POLL_CONTROL_FAST_RATE default
+#define HOUR_MS          ((uint32)60 * 60 * 1000)
+
+static uint8 alarm = 0;
+static const zclAlarmAttr_t alarmAttrs[] =
+{
+    {
+        .endpoint = 1,
+        .clusterID = ZCL_CLUSTER_ID_GEN_BASIC,
+        .attrID = ATTRID_BASIC_ALARM_MASK,
+        .dataType = ZCL_DATATYPE_BITMAP8,
+        .value = &alarm,
+        .debounceMs = 500,
+    }
+};
+static zclAlarmState_t alarmState[COUNT_OF(alarmAttrs)];
+
+static void init(void)
+{
+    sim_InitTasks(NULL);
+    zclFactoryResetter_Init();
+    zclReportBatch_Init();
+    zclBattery_Init();
+    zclAlarm_Init(alarmAttrs, alarmState, COUNT_OF(alarmAttrs));
+    zclCommissioning_Init();
+}
+
+static void bootJoinAndRecover(void)
+{
+    const simReport_t *report = sim_LastReport();
+    simStats_t *stats = sim_Stats();
+    uint16 reports;
+    uint16 rejoins;
+
+    init();
+    sim_Run(5000);
+    SIM_CHECK(devState == DEV_END_DEVICE);
+    SIM_CHECK(bdbAttributes.bdbNodeIsOnANetwork);
+    SIM_CHECK(zclCommissioning_Telemetry.joins == 1);
+    SIM_CHECK(parentCache.channel == CHANNEL);
+    // steering dropped BDB's beacon callback, ours is back
+    SIM_CHECK(sim_BeaconCbOwnedByApp());
+
+    zclBatteryReport(TRUE);
+    sim_Run(1000);
+    SIM_CHECK(report->clusterID == ZCL_CLUSTER_ID_GEN_POWER_CFG);
+    SIM_CHECK(zclBattery_mV >= 2990 && zclBattery_mV <= 3010);
+    SIM_CHECK(zclBattery_Voltage == 30);
+    SIM_CHECK(zclBattery_PercentageRemainig >= 188 && zclBattery_PercentageRemainig <= 189);
+
+    reports = stats->reports;
+    alarm = 0x01;
+    zclAlarmReport();
+    sim_Run(200);
+    SIM_CHECK(stats->reports == reports);
+    sim_Run(1000);
+    SIM_CHECK(stats->reports == reports + 1);
+    SIM_CHECK(report->clusterID == ZCL_CLUSTER_ID_GEN_BASIC);
+    SIM_CHECK(report->attrID[0] == ATTRID_BASIC_ALARM_MASK && report->value[0] == 0x01);
+    // alarms ask for a Default Response, poll fast to collect it
+    SIM_CHECK(zclPollControl_Level() == POLL_LEVEL_FAST);
+    SIM_CHECK(stats->pollRate == FAST_POLL_RATE);
+
+    sim_NetBeacon(ALTERNATE, 180, TRUE);
+    SIM_CHECK(parentCache.alternateAddr[0] == ALTERNATE);
+    SIM_CHECK(parentCache.alternateChannel[0] == CHANNEL);
+
+    // parent gone, the network is still there on the cached channel
+    sim_NetParentLost();
+    SIM_CHECK(devState == DEV_NWK_ORPHAN);
+    sim_Run(40000);
+    SIM_CHECK(devState == DEV_END_DEVICE);
+    SIM_CHECK(stats->rejoins == 1);
+    SIM_CHECK(stats->lastRejoinMask == ((uint32)1 << CHANNEL));
+    SIM_CHECK(stats->recoverCalls == 0);
+    SIM_CHECK(zgDefaultChannelList == CHANNEL_LIST);
+    SIM_CHECK(zclCommissioning_Telemetry.recoveries == 1);
+    SIM_CHECK(sim_BeaconCbOwnedByApp());
+
+    // the network moved where a better router was heard, the cached channel
+    // fails and the alternate's channel is scanned before all channels
+    sim_NetSetup(TRUE, CHANNEL_MOVED, PAN_ID, 3000, 500);
+    sim_NetBeacon(ALTERNATE_MOVED, 220, TRUE);
+    rejoins = stats->rejoins;
+    sim_NetParentLost();
+    sim_Run(15 * 60000);
+    SIM_CHECK(devState == DEV_END_DEVICE);
+    SIM_CHECK(stats->rejoins == rejoins + APP_COMMISSIONING_TARGETED_REJOIN_TRIES + 1);
+    SIM_CHECK(stats->lastRejoinMask == ((uint32)1 << CHANNEL_MOVED));
+    SIM_CHECK(stats->recoverCalls == 0);
+    SIM_CHECK(parentCache.channel == CHANNEL_MOVED);
+    SIM_CHECK(zclCommissioning_Telemetry.recoveries == 2);
+
+    // and again, no router was heard there, BDB scans all channels
+    sim_NetSetup(TRUE, CHANNEL_LAST, PAN_ID, 3000, 500);
+    rejoins = stats->rejoins;
+    sim_NetParentLost();
+    sim_Run(15 * 60000);
+    SIM_CHECK(devState == DEV_END_DEVICE);
+    SIM_CHECK(stats->rejoins == rejoins + APP_COMMISSIONING_TARGETED_REJOIN_TRIES + 2);
+    SIM_CHECK(stats->recoverCalls == 1);
+    SIM_CHECK(stats->lastRejoinMask == CHANNEL_LIST);
+    SIM_CHECK(zgDefaultChannelList == CHANNEL_LIST);
+    SIM_CHECK(parentCache.channel == CHANNEL_LAST);
+    SIM_CHECK(zclCommissioning_Telemetry.recoveries == 3);
+    SIM_CHECK(stats->heapCur == 0);
+    SIM_CHECK(stats->asserts == 0);
+}
+
+static void bootRestore(void)
+{
+    init();
+    sim_Run(3000);
+    SIM_CHECK(devState == DEV_END_DEVICE);
+    SIM_CHECK(zclCommissioning_Telemetry.joins == 0);
+    SIM_CHECK(parentCache.channel == CHANNEL_LAST);
+}
+
+static void bootShort(void)
+{
+    init();
+    sim_Run(1000);
+}
+
+static void bootLong(void)
+{
+    init();
+    sim_Run(6000);
+}
+
+static void bootJoin(void)
+{
+    init();
+    sim_Run(5000);
+    SIM_CHECK(devState == DEV_END_DEVICE);
+    SIM_CHECK(zclCommissioning_Telemetry.joins == 1);
+}
+
+// every attempt is a single rejoin request while the network is away
+static void bootOutage(void)
+{
+    simStats_t *stats = sim_Stats();
+    uint16 rejoins;
+
+    init();
+    sim_Run(3000);
+    SIM_CHECK(devState == DEV_END_DEVICE);
+    sim_NetPresent(FALSE);
+    rejoins = stats->rejoins;
+    sim_NetParentLost();
+    sim_Run(20 * HOUR_MS);
+    SIM_CHECK(devState == DEV_NWK_ORPHAN);
+    SIM_CHECK(stats->rejoins == rejoins + APP_COMMISSIONING_END_DEVICE_REJOIN_BUDGET);
+    SIM_CHECK(rejoinState.windowAttempts > APP_COMMISSIONING_END_DEVICE_REJOIN_BUDGET);
+}
+
+// the spent budget survives the reboot, the wait starts over and the
+// next window opens after it, a key press still rejoins
+static void bootOutageReboot(void)
+{
+    simStats_t *stats = sim_Stats();
+    uint16 rejoins = stats->rejoins;
+
+    init();
+    sim_Run(6 * HOUR_MS);
+    SIM_CHECK(devState == DEV_NWK_ORPHAN);
+    SIM_CHECK(stats->rejoins == rejoins);
+    SIM_CHECK(rejoinState.windowAttempts > APP_COMMISSIONING_END_DEVICE_REJOIN_BUDGET);
+    sim_Run(20 * HOUR_MS);
+    SIM_CHECK(stats->rejoins > rejoins);
+    SIM_CHECK(rejoinState.windowAttempts <= APP_COMMISSIONING_END_DEVICE_REJOIN_BUDGET);
+    rejoins = stats->rejoins;
+
+    sim_NetPresent(TRUE);
+    sim_Key(HAL_KEY_PORT0 | HAL_KEY_PRESS, HAL_KEY_SW_1);
+    sim_Run(1000);
+    SIM_CHECK(devState == DEV_END_DEVICE);
+    SIM_CHECK(stats->rejoins == rejoins + 1);
+    SIM_CHECK(rejoinState.windowAttempts == 0);
+}
+
+int main(void)
+{
+    simStats_t *stats;
+
+    sim_Reset(1);
+    stats = sim_Stats();
+    sim_NetSetup(TRUE, CHANNEL, PAN_ID, 3000, 500);
+
+    SIM_CHECK(sim_Boot(bootJoinAndRecover) == SIM_BOOT_OK);
+    SIM_CHECK(sim_Boot(bootRestore) == SIM_BOOT_OK);
+
+    // boot counter is at 1, the fifth boot in a row resets
+    for (uint8 i = 0; i < 3; i++)
+    {
+        SIM_CHECK(sim_Boot(bootShort) == SIM_BOOT_OK);
+    }
+    SIM_CHECK(stats->factoryResets == 0);
+    SIM_CHECK(sim_Boot(bootLong) == SIM_BOOT_OK);
+    SIM_CHECK(stats->factoryResets == 1);
+    SIM_CHECK(sim_Boot(bootJoin) == SIM_BOOT_OK);
+    SIM_CHECK(sim_Boot(bootOutage) == SIM_BOOT_OK);
+    SIM_CHECK(sim_Boot(bootOutageReboot) == SIM_BOOT_OK);
+
+    printf("%u boots, %u ms, %u wakeups, %u reports, %u failures\n", stats->boots, stats->timeMs, stats->wakeups,
+           stats->reports, sim_Failures());
+    return sim_Failures() ? 1 : 0;
+}
@@ -0,0 +1,113 @@
+#!/usr/bin/env python3
+"""Run the SDCC build of sim/bench/kernel_bench.c in the s51 simulator.
+
+The figures it prints on the serial port, machine cycles and stack bytes
+per kernel and configuration, are merged with the code size of the
+kernel functions taken from the SDCC debug file (--debug), then compared
+with a baseline of "name value" lines. A figure above the baseline
+fails, lines starting with '#' are summaries and the output of a run is
+a baseline as it is.
+
+    bench8051.py --s51 s51 --cdb kernel_bench.cdb kernel_bench.ihx baseline_8051.txt
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+
+FUNCTIONS = [
+    'adcReadOversampled', 'sleepTimerRead',
+    'zclBatteryPercentage', 'zclBatteryFilter',
+    'fpDivPow2M1',
+    'DebugTokenized', 'DebugRingReserve', 'DebugRingCommit', 'DebugRingKick',
+]
+
+# function entry and end labels, G$ global, F<module>$ static
+LABEL_RE = re.compile(r'^L:(X?)(?:G|F[^$]*)\$([^$]+)\$[^:]*:([0-9A-Fa-f]+)\s*$')
+FIGURE_RE = re.compile(r'^(\S+)\s+(\d+)\s*$')
+
+
+def run_s51(s51, ihx, uart, timeout):
+    cmd = [s51, '-t', '8052', '-S', 'in=/dev/null,out=' + uart, ihx]
+    # the program ends on the undefined opcode 0xA5, s51 stops there
+    subprocess.run(cmd, input='run\nquit\n', stdout=subprocess.DEVNULL, stderr=subprocess.STDOUT,
+                   universal_newlines=True, timeout=timeout, check=False)
+    with open(uart, encoding='latin-1') as out:
+        return out.read().splitlines()
+
+
+def code_sizes(cdb, functions):
+    start = {}
+    end = {}
+    with open(cdb, encoding='latin-1') as debug:
+        for line in debug:
+            m = LABEL_RE.match(line)
+            if m:
+                (end if m.group(1) else start)[m.group(2)] = int(m.group(3), 16)
+    return [('code.' + f, end[f] - start[f] + 1) for f in functions if f in start and f in end]
+
+
+def read_figures(lines):
+    figures = []
+    for line in lines:
+        m = FIGURE_RE.match(line)
+        if m and not line.startswith('#'):
+            figures.append((m.group(1), int(m.group(2))))
+    return figures
+
+
+def compare(figures, path):
+    with open(path) as f:
+        baseline = dict(read_figures(f.read().splitlines()))
+    worse = 0
+    found = 0
+    for name, value in figures:
+        if name not in baseline:
+            continue
+        found += 1
+        if value > baseline[name]:
+            print('# %s: %d, baseline %d' % (name, value, baseline[name]))
+            worse += 1
+        elif value < baseline[name]:
+            print('# %s: %d, baseline %d, improved' % (name, value, baseline[name]))
+    if found != len(figures):
+        print('# %s: %d of %d figures, update the baseline' % (path, found, len(figures)))
+    return worse
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument('--s51', default='s51', help='ucsim 8051 simulator')
+    ap.add_argument('--cdb', help='SDCC debug file of the build, for the code sizes')
+    ap.add_argument('--function', action='append', help='function to report the code size of, repeatable')
+    ap.add_argument('--timeout', type=int, default=120, help='simulation time limit, seconds')
+    ap.add_argument('ihx', help='kernel_bench Intel HEX image')
+    ap.add_argument('baseline', nargs='?', help='baseline to compare with')
+    args = ap.parse_args()
+
+    lines = run_s51(args.s51, args.ihx, os.path.splitext(args.ihx)[0] + '.uart', args.timeout)
+    figures = read_figures(lines)
+    if not figures:
+        print('no figures from %s, see %s.uart' % (args.ihx, os.path.splitext(args.ihx)[0]))
+        return 1
+    if args.cdb:
+        figures += code_sizes(args.cdb, args.function or FUNCTIONS)
+
+    for line in lines:
+        if line.startswith('#'):
+            print(line)
+    for name, value in figures:
+        print('%-24s %d' % (name, value))
+
+    if args.baseline is None:
+        return 0
+    if not os.path.exists(args.baseline):
+        print('# %s: no baseline, store this output there' % args.baseline)
+        return 0
+    return 1 if compare(figures, args.baseline) else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,180 @@
+#!/usr/bin/env python3
+"""Decode DEBUG_PRINT_TOKENIZED output back into text.
+
+The token database is built by scanning C sources for DBG()/DBGF() and
+DBG_ERROR()..DBG_TRACE() string literals and hashing them the same way
+debug_token.h does.
+
+    detokenize.py -s path/to/app -s path/to/zApp capture.bin
+    detokenize.py -s path/to/app --port /dev/ttyUSB0 --baud 115200
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+SYNC = 0xA5
+HASH_LEN = 64
+HASH_K = 65599
+TRACE_TOKEN = 0xFFFF  # trace.h records, see trace2json.py
+
+CALL_RE = re.compile(r'\b(?:DBG|DBGF|DBG_(?:ERROR|WARN|INFO|TRACE))\s*\(\s*(?:\w+\s*,\s*)?((?:"(?:[^"\\]|\\.)*"\s*)+)')
+LITERAL_RE = re.compile(r'"((?:[^"\\]|\\.)*)"')
+CONV_RE = re.compile(r'%([-+ #0]*)(\d*|\*)(?:\.(\d*|\*))?(hh|h|ll|l)?([diouxXcsp%])')
+
+
+def c_unescape(text):
+    out = bytearray()
+    i = 0
+    simple = {'n': 10, 'r': 13, 't': 9, '0': 0, 'a': 7, 'b': 8, 'f': 12, 'v': 11,
+              '\\': 92, '"': 34, "'": 39, '?': 63}
+    while i < len(text):
+        c = text[i]
+        if c != '\\':
+            out += c.encode('latin-1')
+            i += 1
+            continue
+        e = text[i + 1]
+        if e == 'x':
+            m = re.match(r'[0-9a-fA-F]+', text[i + 2:])
+            out.append(int(m.group(0), 16) & 0xFF)
+            i += 2 + len(m.group(0))
+        elif e in '01234567':
+            m = re.match(r'[0-7]{1,3}', text[i + 1:])
+            out.append(int(m.group(0), 8) & 0xFF)
+            i += 1 + len(m.group(0))
+        else:
+            out.append(simple.get(e, ord(e)))
+            i += 2
+    return bytes(out)
+
+
+def token(fmt):
+    h = len(fmt) & 0xFFFFFFFF
+    for i in range(HASH_LEN):
+        c = fmt[i] if i < len(fmt) else 0
+        h = (h * HASH_K + c) & 0xFFFFFFFF
+    return (h ^ (h >> 16)) & 0xFFFF
+
+
+def build_database(paths):
+    db = {}
+    for root in paths:
+        files = [root] if os.path.isfile(root) else [
+            os.path.join(d, f) for d, _, fs in os.walk(root) for f in fs if f.endswith(('.c', '.h'))]
+        for path in files:
+            with open(path, encoding='latin-1') as src:
+                for m in CALL_RE.finditer(src.read()):
+                    fmt = b''.join(c_unescape(l) for l in LITERAL_RE.findall(m.group(1)))
+                    tok = token(fmt)
+                    if tok == TRACE_TOKEN:
+                        print('warning: %r hashes to the trace token' % fmt, file=sys.stderr)
+                    if tok in db and db[tok] != fmt:
+                        print('warning: token 0x%04X collision: %r vs %r' % (tok, db[tok], fmt), file=sys.stderr)
+                    db[tok] = fmt
+    return db
+
+
+def render(fmt, payload, int_size, long_size):
+    fmt = fmt.decode('latin-1')
+    out = []
+    pos = 0
+    last = 0
+    for m in CONV_RE.finditer(fmt):
+        out.append(fmt[last:m.start()])
+        last = m.end()
+        flags, width, prec, length, conv = m.groups()
+        if conv == '%':
+            out.append('%')
+            continue
+        size = long_size if length in ('l', 'll') else int_size
+        raw = payload[pos:pos + size]
+        pos += size
+        if len(raw) < size:
+            out.append('<?>')
+            continue
+        value = int.from_bytes(raw, 'little')
+        if conv in 'di':
+            if value & (1 << (size * 8 - 1)):
+                value -= 1 << (size * 8)
+        elif conv == 'c':
+            value &= 0xFF
+        elif conv in 'sp':
+            out.append('<0x%X>' % value)
+            continue
+        out.append(('%' + flags + (width or '') + ('.' + prec if prec is not None else '') + conv) % value)
+    out.append(fmt[last:])
+    return ''.join(out)
+
+
+def decode(stream, db, int_size, long_size, out):
+    buf = bytearray()
+    for chunk in stream:
+        buf += chunk
+        while True:
+            start = buf.find(bytes([SYNC]))
+            if start < 0:
+                buf.clear()
+                break
+            del buf[:start]
+            if len(buf) < 4:
+                break
+            size = buf[1]
+            tok = struct.unpack_from('<H', buf, 2)[0]
+            if tok == TRACE_TOKEN:
+                if len(buf) < 4 + size:
+                    break
+                del buf[:4 + size]
+                continue
+            if tok not in db:
+                # not a record start, resync on the next marker
+                del buf[:1]
+                continue
+            if len(buf) < 4 + size:
+                break
+            out.write(render(db[tok], bytes(buf[4:4 + size]), int_size, long_size))
+            out.flush()
+            del buf[:4 + size]
+
+
+def file_chunks(f):
+    while True:
+        chunk = f.read(256)
+        if not chunk:
+            return
+        yield chunk
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument('-s', '--source', action='append', required=True,
+                    help='source file or directory to collect format strings from')
+    ap.add_argument('--int-size', type=int, default=2, help='target sizeof(int), 2 for IAR 8051')
+    ap.add_argument('--long-size', type=int, default=4, help='target sizeof(long)')
+    ap.add_argument('--port', help='read from serial port (requires pyserial)')
+    ap.add_argument('--baud', type=int, default=115200)
+    ap.add_argument('--dump', action='store_true', help='print token database and exit')
+    ap.add_argument('capture', nargs='?', help='binary capture file, stdin if omitted')
+    args = ap.parse_args()
+
+    db = build_database(args.source)
+    if args.dump:
+        for tok, fmt in sorted(db.items()):
+            print('0x%04X %r' % (tok, fmt.decode('latin-1')))
+        return
+
+    if args.port:
+        import serial
+        port = serial.Serial(args.port, args.baud, timeout=0.1)
+        stream = iter(lambda: port.read(256) or b'', None)
+    elif args.capture:
+        stream = file_chunks(open(args.capture, 'rb'))
+    else:
+        stream = file_chunks(sys.stdin.buffer)
+    decode(stream, db, args.int_size, args.long_size, sys.stdout)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+"""Convert ZAPP_TRACE records from a debug UART capture to Chrome trace JSON.
+
+The output opens in chrome://tracing and https://ui.perfetto.dev. Event
+names are taken from TRACE_ID_* defines found in the given sources, the
+capture may be DEBUG_PRINT_UART text or DEBUG_PRINT_TOKENIZED output,
+everything but trace records is skipped.
+
+    trace2json.py -s path/to/zApp -s path/to/app capture.bin > trace.json
+"""
+
+import argparse
+import json
+import os
+import re
+import struct
+import sys
+
+SYNC = 0xA5
+TRACE_TOKEN = 0xFFFF
+RECORD_LEN = 8
+
+SLEEP_TIMER_HZ = 32768
+TICKS_WRAP = 1 << 24
+EPOCH_MS = 1 << 16
+EPOCH_WRAP = 256
+
+TYPES = {0: 'b', 1: 'e', 2: 'i', 3: 'C'}
+
+DEFINE_RE = re.compile(r'#define\s+TRACE_ID_(\w+)\s+(0[xX][0-9a-fA-F]+|\d+)')
+
+
+def build_names(paths):
+    names = {}
+    for root in paths:
+        files = [root] if os.path.isfile(root) else [
+            os.path.join(d, f) for d, _, fs in os.walk(root) for f in fs if f.endswith(('.c', '.h'))]
+        for path in files:
+            with open(path, encoding='latin-1') as src:
+                for m in DEFINE_RE.finditer(src.read()):
+                    names.setdefault(int(m.group(2), 0), m.group(1).lower())
+    return names
+
+
+def records(data):
+    pos = 0
+    while True:
+        pos = data.find(bytes([SYNC, RECORD_LEN]), pos)
+        if pos < 0 or pos + 4 + RECORD_LEN > len(data):
+            return
+        if struct.unpack_from('<H', data, pos + 2)[0] != TRACE_TOKEN:
+            pos += 1
+            continue
+        rec = data[pos + 4:pos + 4 + RECORD_LEN]
+        pos += 4 + RECORD_LEN
+        kind, ident = rec[0], rec[1]
+        if kind not in TYPES:
+            continue
+        ticks = rec[2] | rec[3] << 8 | rec[4] << 16
+        yield kind, ident, ticks, rec[5], struct.unpack_from('<H', rec, 6)[0]
+
+
+class Clock:
+    """Unwraps the 24 bit sleep timer with the help of the coarse epoch."""
+
+    def __init__(self):
+        self.epochs = 0
+        self.last_epoch = None
+
+    def us(self, ticks, epoch):
+        if self.last_epoch is not None and epoch < self.last_epoch:
+            self.epochs += EPOCH_WRAP
+        self.last_epoch = epoch
+        coarse = (self.epochs + epoch + 0.5) * EPOCH_MS * SLEEP_TIMER_HZ / 1000
+        # the epoch is good to +-32.8 s, much less than the timer wrap period
+        wraps = round((coarse - ticks) / TICKS_WRAP)
+        return (ticks + wraps * TICKS_WRAP) * 1e6 / SLEEP_TIMER_HZ
+
+
+def convert(data, names):
+    clock = Clock()
+    events = []
+    for kind, ident, ticks, epoch, arg in records(data):
+        ev = {
+            'name': names.get(ident, 'id_%d' % ident),
+            'ph': TYPES[kind],
+            'ts': round(clock.us(ticks, epoch), 1),
+            'pid': 0,
+            'tid': 0,
+            'cat': 'zapp',
+        }
+        if kind in (0, 1):
+            # async spans may overlap, e.g. ADC readout during a rejoin
+            ev['id'] = ident
+        elif kind == 2:
+            ev['s'] = 'g'
+            ev['args'] = {'arg': arg}
+        else:
+            ev['args'] = {ev['name']: arg}
+        events.append(ev)
+    return {'traceEvents': events, 'displayTimeUnit': 'ms'}
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument('-s', '--source', action='append', default=[],
+                    help='source file or directory to collect TRACE_ID_* names from')
+    ap.add_argument('capture', nargs='?', help='binary capture file, stdin if omitted')
+    args = ap.parse_args()
+
+    data = open(args.capture, 'rb').read() if args.capture else sys.stdin.buffer.read()
+    json.dump(convert(data, build_names(args.source)), sys.stdout, indent=1)
+    sys.stdout.write('\n')
+
+
+if __name__ == '__main__':
+    main()
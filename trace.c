@@ -0,0 +1,126 @@
+#if defined(ZAPP_TRACE)
+#include "OSAL.h"
+#include "hal_mcu.h"
+#include "debug_print.h"
+#include "utils.h"
+#include "zapp_task.h"
+
+#include "trace.h"
+
+#if !defined(DEBUG_PRINT_UART) && !defined(DEBUG_PRINT_TOKENIZED)
+#error ZAPP_TRACE requires DEBUG_PRINT_UART or DEBUG_PRINT_TOKENIZED
+#endif
+
+// buffered events, power of two
+#ifndef TRACE_RECORDS
+#define TRACE_RECORDS 16
+#endif /* TRACE_RECORDS */
+
+// retry delay when the debug ring is full
+#ifndef TRACE_DRAIN_RETRY_MS
+#define TRACE_DRAIN_RETRY_MS 5
+#endif /* TRACE_DRAIN_RETRY_MS */
+
+#if (TRACE_RECORDS) > 128 || ((TRACE_RECORDS) & ((TRACE_RECORDS) - 1))
+#error TRACE_RECORDS should be a power of two not greater than 128
+#endif
+
+#define TRACE_MASK ((TRACE_RECORDS) - 1)
+
+traceStats_t zAppTrace_Stats;
+
+/*
+ * Events may be recorded from interrupts, the ring is filled in a
+ * critical section and drained from the library task only, which keeps
+ * the debug ring single producer.
+ */
+static uint8 traceRing[TRACE_RECORDS][TRACE_RECORD_LEN];
+static uint8 traceHead = 0;
+static uint8 traceTail = 0;
+static uint16 traceEvent = 0;
+
+static void zAppTrace_Drain(void);
+
+/**************************************************************************************************
+ * @fn      zAppTrace_Init
+ *
+ * @brief   Initialize tracing, called by zAppTask_Init
+ *
+ * @param   None
+ *
+ * @return  None
+ **************************************************************************************************/
+void zAppTrace_Init(void)
+{
+    traceEvent = zAppTask_AllocEvent(zAppTrace_Drain);
+}
+
+/**************************************************************************************************
+ * @fn      zAppTrace_Record
+ *
+ * @brief   Record event, use TRACE_* macros instead
+ *
+ * @param   type - TRACE_TYPE_*
+ * @param   id - TRACE_ID_*
+ * @param   arg - event argument
+ *
+ * @return  None
+ **************************************************************************************************/
+void zAppTrace_Record(uint8 type, uint8 id, uint16 arg)
+{
+    halIntState_t intState;
+    uint32 ticks;
+    uint8 epoch;
+    uint8 *rec;
+
+    // stamped inside, so records from interrupts stay in time order
+    HAL_ENTER_CRITICAL_SECTION(intState);
+    ticks = sleepTimerRead();
+    epoch = (uint8)(osal_GetSystemClock() >> 16);
+    if (((traceHead + 1) & TRACE_MASK) == traceTail)
+    {
+        zAppTrace_Stats.dropped++;
+        HAL_EXIT_CRITICAL_SECTION(intState);
+        return;
+    }
+    rec = traceRing[traceHead];
+    rec[0] = type;
+    rec[1] = id;
+    rec[2] = (uint8)ticks;
+    rec[3] = (uint8)(ticks >> 8);
+    rec[4] = (uint8)(ticks >> 16);
+    rec[5] = epoch;
+    rec[6] = LO_UINT16(arg);
+    rec[7] = HI_UINT16(arg);
+    traceHead = (traceHead + 1) & TRACE_MASK;
+    zAppTrace_Stats.records++;
+    HAL_EXIT_CRITICAL_SECTION(intState);
+
+    if (traceEvent != 0)
+    {
+        osal_set_event(zAppTask_Id, traceEvent);
+    }
+}
+
+/**************************************************************************************************
+ * @fn      zAppTrace_Drain
+ *
+ * @brief   Move buffered events to the debug stream
+ *
+ * @param   None
+ *
+ * @return  None
+ **************************************************************************************************/
+static void zAppTrace_Drain(void)
+{
+    while (traceTail != traceHead)
+    {
+        if (!DebugRecord(TRACE_TOKEN, traceRing[traceTail], TRACE_RECORD_LEN))
+        {
+            osal_start_timerEx(zAppTask_Id, traceEvent, TRACE_DRAIN_RETRY_MS);
+            return;
+        }
+        traceTail = (traceTail + 1) & TRACE_MASK;
+    }
+}
+#endif /* ZAPP_TRACE */
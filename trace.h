@@ -0,0 +1,64 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "hal_defs.h"
+
+/*
+ * Span and instant event tracing, enabled with ZAPP_TRACE. Events are
+ * stamped with the 32 kHz sleep timer, buffered as fixed size records
+ * and drained by the library task into the debug UART stream, so
+ * DEBUG_PRINT_UART or DEBUG_PRINT_TOKENIZED is required. Draining starts
+ * with zAppTask_Init, events recorded before stay buffered.
+ * tools/trace2json.py converts a capture to Chrome trace / Perfetto JSON.
+ *
+ * On the wire each event is a debug_token record with token TRACE_TOKEN
+ * and TRACE_RECORD_LEN bytes of payload:
+ *   type, id, sleep timer (24 bit, LSB first), epoch, arg LSB, arg MSB
+ * epoch is the system clock in 65.536 s units and lets the host unwrap
+ * the sleep timer, it wraps every 512 s.
+ */
+
+#define TRACE_TOKEN            0xFFFF
+#define TRACE_RECORD_LEN       8
+
+#define TRACE_TYPE_BEGIN       0
+#define TRACE_TYPE_END         1
+#define TRACE_TYPE_INSTANT     2
+#define TRACE_TYPE_COUNTER     3
+
+// library event IDs, tools/trace2json.py takes the names from here
+#define TRACE_ID_ADC           1   // battery ADC readout
+#define TRACE_ID_REPORT        2   // report frame send
+#define TRACE_ID_NV            3   // boot counter NV access
+#define TRACE_ID_NV_COMPACT    4   // nv_record page compaction
+#define TRACE_ID_JOIN          5   // start to network steering success or restore
+#define TRACE_ID_RECOVER       6   // parent loss to network restore
+#define TRACE_ID_NWK_STATE     7   // arg - devState
+#define TRACE_ID_REJOIN        8   // rejoin attempt, arg - attempt number
+#define TRACE_ID_USER          0x80 // 0x80..0xFF are free for the application
+
+#if defined(ZAPP_TRACE)
+typedef struct
+{
+    uint16 records;  // events recorded
+    uint16 dropped;  // events lost to a full buffer
+} traceStats_t;
+
+extern traceStats_t zAppTrace_Stats;
+
+extern void zAppTrace_Init(void);  // called by zAppTask_Init
+extern void zAppTrace_Record(uint8 type, uint8 id, uint16 arg);
+
+#define TRACE_BEGIN(id)              zAppTrace_Record(TRACE_TYPE_BEGIN, id, 0)
+#define TRACE_END(id)                zAppTrace_Record(TRACE_TYPE_END, id, 0)
+#define TRACE_INSTANT(id, arg)       zAppTrace_Record(TRACE_TYPE_INSTANT, id, arg)
+#define TRACE_COUNTER(id, value)     zAppTrace_Record(TRACE_TYPE_COUNTER, id, value)
+#else /* ZAPP_TRACE */
+#define zAppTrace_Init()
+#define TRACE_BEGIN(id)
+#define TRACE_END(id)
+#define TRACE_INSTANT(id, arg)
+#define TRACE_COUNTER(id, value)
+#endif /* !ZAPP_TRACE */
+
+#endif /* TRACE_H */
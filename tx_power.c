@@ -0,0 +1,141 @@
+#include "ZComDef.h"
+#include "ZDApp.h"
+#include "utils.h"
+#include "debug_print.h"
+
+#include "tx_power.h"
+
+/*
+ * TX_POWER_LADDER lists ZMacTransmitPower_t values from the highest power
+ * down, its last entry is the power floor. Power passed to zclTxPower_Init
+ * goes first, followed by the entries below it. ZMacTransmitPower_t grows
+ * with attenuation, so a lower power is a greater value.
+ */
+#ifndef TX_POWER_LADDER
+    #define TX_POWER_LADDER {TX_PWR_PLUS_4, TX_PWR_PLUS_1, TX_PWR_MINUS_4, TX_PWR_MINUS_8, TX_PWR_MINUS_12}
+#endif
+
+// acked data requests in a row with LQI at or above TX_POWER_LQI_DOWN to step down
+#ifndef TX_POWER_DOWN_AFTER
+    #define TX_POWER_DOWN_AFTER 16
+#endif
+
+#ifndef TX_POWER_LQI_DOWN
+    #define TX_POWER_LQI_DOWN 120
+#endif
+
+// LQI below this steps up, between the two thresholds power holds
+#ifndef TX_POWER_LQI_UP
+    #define TX_POWER_LQI_UP 80
+#endif
+
+// steps taken up on a failed ack
+#ifndef TX_POWER_UP_STEPS
+    #define TX_POWER_UP_STEPS 2
+#endif
+
+static const ZMacTransmitPower_t txPowerDefault[] = TX_POWER_LADDER;
+static ZMacTransmitPower_t txPowerLadder[COUNT_OF(txPowerDefault) + 1];
+static uint8 txPower_Steps = 0;
+
+txPowerStats_t zclTxPower_Stats;
+
+static uint8 txPower_Good = 0;      // qualifying acks since the last change
+static uint8 txPower_Needed = TX_POWER_DOWN_AFTER;
+static bool txPower_Enabled = FALSE;
+
+static void zclTxPower_Set(uint8 step);
+
+/**************************************************************************************************
+ * @fn      zclTxPower_Init
+ *
+ * @brief   Start transmit power control at the given power
+ *
+ * @param   power - the highest power used
+ *
+ * @return  None
+ **************************************************************************************************/
+void zclTxPower_Init(ZMacTransmitPower_t power)
+{
+    txPower_Steps = 0;
+    txPowerLadder[txPower_Steps++] = power;
+    for (uint8 i = 0; i < COUNT_OF(txPowerDefault); i++)
+    {
+        // only strictly lower powers, out of order entries are skipped
+        if (txPowerDefault[i] > txPowerLadder[txPower_Steps - 1])
+        {
+            txPowerLadder[txPower_Steps++] = txPowerDefault[i];
+        }
+    }
+    txPower_Enabled = TRUE;
+    zclTxPower_Stats.step = 0xFF;
+    zclTxPower_Set(0);
+}
+
+/**************************************************************************************************
+ * @fn      zclTxPower_Tx
+ *
+ * @brief   Adjust power on data request outcome
+ *
+ * @param   acked - TRUE if the parent acknowledged the frame
+ * @param   lqi - parent link quality
+ *
+ * @return  None
+ **************************************************************************************************/
+void zclTxPower_Tx(bool acked, uint8 lqi)
+{
+    uint8 step = zclTxPower_Stats.step;
+
+    if (!txPower_Enabled)
+    {
+        return;
+    }
+
+    if (!acked || lqi < TX_POWER_LQI_UP)
+    {
+        // failed ack steps up fast, low LQI alone one step
+        uint8 up = acked ? 1 : TX_POWER_UP_STEPS;
+
+        if (step > 0)
+        {
+            zclTxPower_Stats.ups++;
+            // after stepping up it takes twice as long to step down again
+            txPower_Needed = 2 * TX_POWER_DOWN_AFTER;
+            zclTxPower_Set(step > up ? step - up : 0);
+        }
+        txPower_Good = 0;
+        return;
+    }
+
+    if (lqi < TX_POWER_LQI_DOWN || step == txPower_Steps - 1)
+    {
+        return;
+    }
+    if (++txPower_Good >= txPower_Needed)
+    {
+        zclTxPower_Stats.downs++;
+        txPower_Needed = TX_POWER_DOWN_AFTER;
+        zclTxPower_Set(step + 1);
+    }
+}
+
+/**************************************************************************************************
+ * @fn      zclTxPower_Set
+ *
+ * @brief   Apply ladder step
+ *
+ * @param   step - ladder step
+ *
+ * @return  None
+ **************************************************************************************************/
+static void zclTxPower_Set(uint8 step)
+{
+    txPower_Good = 0;
+    if (step == zclTxPower_Stats.step)
+    {
+        return;
+    }
+    DBG_TRACE(DEBUG_MODULE_TX_POWER, "TXPWR: step %d -> %d\r\n", zclTxPower_Stats.step, step);
+    zclTxPower_Stats.step = step;
+    ZMacSetTransmitPower(txPowerLadder[step]);
+}
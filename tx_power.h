@@ -0,0 +1,25 @@
+#ifndef TX_POWER_H
+#define TX_POWER_H
+
+#include "hal_defs.h"
+#include "ZMAC.h"
+
+/*
+ * Closed-loop transmit power control. Power steps down the ladder while
+ * data requests keep being acknowledged with good parent LQI, and steps
+ * up right away when acks fail or LQI drops.
+ */
+
+typedef struct
+{
+    uint8 step;      // current ladder step, 0 is the highest power
+    uint16 ups;
+    uint16 downs;
+} txPowerStats_t;
+
+extern txPowerStats_t zclTxPower_Stats;
+
+extern void zclTxPower_Init(ZMacTransmitPower_t power);
+extern void zclTxPower_Tx(bool acked, uint8 lqi);
+
+#endif /* TX_POWER_H */
@@ -1,11 +1,34 @@
+#include "OSAL.h"
+#include "OSAL_PwrMgr.h"
 #include "hal_adc.h"
+#include "hal_mcu.h"
 
 #include "utils.h"
 
+/*********************************************************************
+ * GLOBAL VARIABLES
+ */
+uint32 adcConversionTicks = 0;
+
+/*********************************************************************
+ * LOCAL VARIABLES
+ */
+static volatile bool adcAsyncBusy = FALSE;
+static uint8 adcAsyncCmd;         // ADCCON3 value starting a conversion
+static uint8 adcAsyncShift;       // resolution shift of the left aligned result
+static uint8 adcAsyncCount;
+static volatile uint8 adcAsyncLeft;
+static volatile uint32 adcAsyncSum;
+static uint32 adcAsyncStart;
+static uint8 adcAsyncTaskId;
+static uint16 adcAsyncEvent;
+
 /**************************************************************************************************
  * @fn      adcReadOversampled
  *
- * @brief   Get oversampled value from ADC
+ * @brief   Get oversampled value from ADC. Waits for a readout started
+ *          with adcReadOversampledAsync() to finish first, as its interrupt
+ *          would take the samples of this one.
  *
  * @param   channel - ADC channel
  * @param   resolution - ADC resolution
@@ -16,11 +39,174 @@
  **************************************************************************************************/
 uint16 adcReadOversampled(uint8 channel, uint8 resolution, uint8 reference, uint8 samplesCount)
 {
+    while (adcAsyncBusy)
+        ;
+    uint32 start = sleepTimerRead();
     HalAdcSetReference(reference);
     uint32 samplesSum = 0;
     for (uint8 i = 0; i < samplesCount; i++)
     {
         samplesSum += HalAdcRead(channel, resolution);
     }
+    adcConversionTicks = SLEEP_TIMER_ELAPSED(start, sleepTimerRead());
     return (samplesSum / samplesCount);
 }
+
+/**************************************************************************************************
+ * @fn      adcReadOversampledAsync
+ *
+ * @brief   Start oversampled ADC readout driven by end of conversion interrupt.
+ *          Conversions run back to back while the CPU is free to process other tasks,
+ *          power saving is held off for the task meanwhile since ADC stops in PM1-3.
+ *          Completion is signaled by setting event on task, the result is picked up
+ *          with adcReadOversampledResult().
+ *
+ * @param   channel - ADC channel
+ * @param   resolution - ADC resolution
+ * @param   reference - reference to use
+ * @param   samplesCount - sample count
+ * @param   task_id - task to notify
+ * @param   event - event to set on completion
+ *
+ * @return  TRUE if started, FALSE if another readout is in progress
+ **************************************************************************************************/
+bool adcReadOversampledAsync(uint8 channel, uint8 resolution, uint8 reference, uint8 samplesCount,
+                             uint8 task_id, uint16 event)
+{
+    uint8 decimation;
+
+    if (adcAsyncBusy || samplesCount == 0)
+        return FALSE;
+
+    switch (resolution)
+    {
+    case HAL_ADC_RESOLUTION_8:
+        decimation = HAL_ADC_DEC_064;
+        adcAsyncShift = 8;
+        break;
+    case HAL_ADC_RESOLUTION_10:
+        decimation = HAL_ADC_DEC_128;
+        adcAsyncShift = 6;
+        break;
+    case HAL_ADC_RESOLUTION_12:
+        decimation = HAL_ADC_DEC_256;
+        adcAsyncShift = 4;
+        break;
+    case HAL_ADC_RESOLUTION_14:
+    default:
+        decimation = HAL_ADC_DEC_512;
+        adcAsyncShift = 2;
+        break;
+    }
+
+    // connect the pin to the ADC, same as HalAdcRead() does
+    if (channel < 8)
+        APCFG |= BV(channel);
+
+    adcAsyncCmd = reference | decimation | channel;
+    adcAsyncCount = samplesCount;
+    adcAsyncLeft = samplesCount;
+    adcAsyncSum = 0;
+    adcAsyncTaskId = task_id;
+    adcAsyncEvent = event;
+    adcAsyncBusy = TRUE;
+    osal_pwrmgr_task_state(task_id, PWRMGR_HOLD);
+
+    adcAsyncStart = sleepTimerRead();
+    (void)ADCL;   // clear stale end of conversion
+    (void)ADCH;
+    ADCIF = 0;
+    ADCIE = 1;
+    ADCCON3 = adcAsyncCmd;
+    return TRUE;
+}
+
+/**************************************************************************************************
+ * @fn      adcReadOversampledBusy
+ *
+ * @brief   Check for asynchronous readout in progress. The end of conversion interrupt
+ *          takes every conversion meanwhile, so HalAdcRead() must not be called until
+ *          it is done, it would never see its conversion end.
+ *
+ * @param   None
+ *
+ * @return  TRUE if readout started with adcReadOversampledAsync() is in progress
+ **************************************************************************************************/
+bool adcReadOversampledBusy(void)
+{
+    return adcAsyncBusy;
+}
+
+/**************************************************************************************************
+ * @fn      adcReadOversampledResult
+ *
+ * @brief   Get result of readout started with adcReadOversampledAsync()
+ *          and release power saving hold of the task
+ *
+ * @param   None
+ *
+ * @return  oversampled ADC readout
+ **************************************************************************************************/
+uint16 adcReadOversampledResult(void)
+{
+    osal_pwrmgr_task_state(adcAsyncTaskId, PWRMGR_CONSERVE);
+    return (adcAsyncSum / adcAsyncCount);
+}
+
+/**************************************************************************************************
+ * @fn      adcAsyncIsr
+ *
+ * @brief   ADC end of conversion interrupt, accumulates sample and starts next conversion
+ *
+ * @param   None
+ *
+ * @return  None
+ **************************************************************************************************/
+HAL_ISR_FUNCTION(adcAsyncIsr, ADC_VECTOR)
+{
+    int16 reading;
+
+    ADCIF = 0;
+    reading = (int16)ADCL;
+    reading |= (int16)((uint16)ADCH << 8);
+    // treat small negative as 0
+    if (reading < 0)
+        reading = 0;
+    adcAsyncSum += (uint16)reading >> adcAsyncShift;
+
+    if (--adcAsyncLeft)
+    {
+        ADCCON3 = adcAsyncCmd;
+        return;
+    }
+
+    ADCIE = 0;
+    adcConversionTicks = SLEEP_TIMER_ELAPSED(adcAsyncStart, sleepTimerRead());
+    adcAsyncBusy = FALSE;
+    osal_set_event(adcAsyncTaskId, adcAsyncEvent);
+}
+
+
+/**************************************************************************************************
+ * @fn      sleepTimerRead
+ *
+ * @brief   Read 24-bit sleep timer, runs at 32 kHz in all power modes
+ *
+ * @param   None
+ *
+ * @return  sleep timer value
+ **************************************************************************************************/
+uint32 sleepTimerRead(void)
+{
+    halIntState_t intState;
+    uint32 ticks;
+
+    // ST0 has to be read first, it latches ST1 and ST2, an interrupt
+    // reading the timer in between would latch them again
+    HAL_ENTER_CRITICAL_SECTION(intState);
+    ticks = ST0;
+    ticks |= (uint32)ST1 << 8;
+    ticks |= (uint32)ST2 << 16;
+    HAL_EXIT_CRITICAL_SECTION(intState);
+    return ticks;
+}
@@ -32,7 +32,8 @@
 /*********************************************************************
  * @fn          MAP
  *
- * @brief       maps a number from one range to another
+ * @brief       maps a number from one range to another,
+ *              fixedpoint.h fpMap avoids the division
  *
  * @param       value - input value from the first range
  * @param       in_min - first range minimum
@@ -46,7 +47,8 @@
 /*********************************************************************
  * @fn          SCALE
  *
- * @brief       scales input value to a given power of ten scale
+ * @brief       scales input value to a given power of ten scale,
+ *              fixedpoint.h fpScale doesn't loop
  *
  * @param       output - output variable
  * @param       value - input value
@@ -69,7 +71,8 @@
 /*********************************************************************
  * @fn          ADC2MV
  *
- * @brief       converts raw ADC value to input milliVolts
+ * @brief       converts raw ADC value to input milliVolts,
+ *              fixedpoint.h FP_ADC2MV gives the same without division
  *
  * @param       raw - raw ADC value
  * @param       reference - reference voltage in milliVolts
@@ -78,6 +81,32 @@
 #define ADC2MV(raw, reference, resolution)       \
     ((uint32)(raw) * (reference) * 3 / ((32 << (resolution) * 2) - 1))
 
+/*********************************************************************
+ * @fn          SLEEP_TIMER_ELAPSED
+ *
+ * @brief       evaluates to sleep timer ticks elapsed between two readouts
+ *
+ * @param       start - first sleepTimerRead() value
+ * @param       end - second sleepTimerRead() value
+ */
+#define SLEEP_TIMER_ELAPSED(start, end) (((end) - (start)) & 0x00FFFFFF)
+
+#define SLEEP_TIMER_HZ 32768
+
+extern uint32 adcConversionTicks;  // sleep timer ticks spent in the last oversampled readout
+
+/*
+ * While adcReadOversampledAsync() readout is in progress its interrupt
+ * takes every ADC conversion. adcReadOversampled() waits for it to end,
+ * other ADC users have to check adcReadOversampledBusy() before calling
+ * HalAdcRead(), which would otherwise wait for its conversion forever.
+ */
+
 extern uint16 adcReadOversampled(uint8 channel, uint8 resolution, uint8 reference, uint8 samplesCount);
+extern bool adcReadOversampledAsync(uint8 channel, uint8 resolution, uint8 reference, uint8 samplesCount,
+                                    uint8 task_id, uint16 event);
+extern bool adcReadOversampledBusy(void);
+extern uint16 adcReadOversampledResult(void);
+extern uint32 sleepTimerRead(void);
 
 #endif /* UTILS_H */
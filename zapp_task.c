@@ -0,0 +1,188 @@
+#include "OSAL.h"
+#include "OnBoard.h"
+#include "zcl.h"
+#include "hal_key.h"
+#include "hal_assert.h"
+#include "debug_print.h"
+#include "trace.h"
+
+#include "zapp_task.h"
+
+#define ZAPP_TASK_EVENTS 15 // SYS_EVENT_MSG excluded
+
+typedef struct
+{
+    uint8 event;
+    zAppMsgHandler_t handler;
+} zAppMsgEntry_t;
+
+uint8 zAppTask_Id = 0;
+
+static zAppEventHandler_t zAppTask_Events[ZAPP_TASK_EVENTS];
+static uint16 zAppTask_Allocated = 0;
+static zAppMsgEntry_t zAppTask_Msgs[ZAPP_TASK_MSG_HANDLERS];
+static uint8 zAppTask_MsgCount = 0;
+static zAppKeyHandler_t zAppTask_Keys[ZAPP_TASK_KEY_HANDLERS];
+static uint8 zAppTask_KeyCount = 0;
+
+static void zAppTask_ProcessMsg(osal_event_hdr_t *msg);
+
+/**************************************************************************************************
+ * @fn      zAppTask_Init
+ *
+ * @brief   Initialize library task
+ *
+ * @param   task_id - ID of this task
+ *
+ * @return  None
+ **************************************************************************************************/
+void zAppTask_Init(uint8 task_id)
+{
+    zAppTask_Id = task_id;
+    zAppTrace_Init();
+}
+
+/**************************************************************************************************
+ * @fn      zAppTask_event_loop
+ *
+ * @brief   Task event loop, dispatches messages, keys and events to the
+ *          registered handlers
+ *
+ * @param   task_id - ID of the task
+ * @param   events - pending events
+ *
+ * @return  pending events still active after completion
+ **************************************************************************************************/
+uint16 zAppTask_event_loop(uint8 task_id, uint16 events)
+{
+    if (events & SYS_EVENT_MSG)
+    {
+        osal_event_hdr_t *msg;
+        uint8 budget = ZAPP_TASK_MSGS_PER_RUN;
+
+        // osal_msg_receive sets SYS_EVENT_MSG again while more messages are queued
+        while (budget-- && (msg = (osal_event_hdr_t *)osal_msg_receive(zAppTask_Id)))
+        {
+            zAppTask_ProcessMsg(msg);
+            osal_msg_deallocate((uint8 *)msg);
+        }
+        return (events ^ SYS_EVENT_MSG);
+    }
+
+    for (uint8 i = 0; i < ZAPP_TASK_EVENTS; i++)
+    {
+        uint16 event = BV(i);
+
+        if (events & event)
+        {
+            if (zAppTask_Events[i] != NULL)
+            {
+                zAppTask_Events[i]();
+            }
+            return (events ^ event);
+        }
+    }
+
+    // Discard unknown events
+    return 0;
+}
+
+/**************************************************************************************************
+ * @fn      zAppTask_AllocEvent
+ *
+ * @brief   Allocate event bit of the library task
+ *
+ * @param   handler - function to call when the event is set
+ *
+ * @return  event bit to pass to osal_set_event and osal_start_timerEx
+ **************************************************************************************************/
+uint16 zAppTask_AllocEvent(zAppEventHandler_t handler)
+{
+    for (uint8 i = 0; i < ZAPP_TASK_EVENTS; i++)
+    {
+        if (!(zAppTask_Allocated & BV(i)))
+        {
+            zAppTask_Allocated |= BV(i);
+            zAppTask_Events[i] = handler;
+            return BV(i);
+        }
+    }
+    HAL_ASSERT(FALSE);
+    return 0;
+}
+
+/**************************************************************************************************
+ * @fn      zAppTask_RegisterMsg
+ *
+ * @brief   Register handler of OSAL messages. Message is deallocated,
+ *          and ZCL_INCOMING_MSG command payload freed, after all handlers
+ *          of its event ran.
+ *
+ * @param   event - message event, e.g. ZDO_STATE_CHANGE
+ * @param   handler - function to call with the message
+ *
+ * @return  None
+ **************************************************************************************************/
+void zAppTask_RegisterMsg(uint8 event, zAppMsgHandler_t handler)
+{
+    HAL_ASSERT(zAppTask_MsgCount < ZAPP_TASK_MSG_HANDLERS);
+    zAppTask_Msgs[zAppTask_MsgCount].event = event;
+    zAppTask_Msgs[zAppTask_MsgCount].handler = handler;
+    zAppTask_MsgCount++;
+}
+
+/**************************************************************************************************
+ * @fn      zAppTask_RegisterKeys
+ *
+ * @brief   Register key handler, the library task takes key events on
+ *          the first call
+ *
+ * @param   handler - function to call on key change
+ *
+ * @return  None
+ **************************************************************************************************/
+void zAppTask_RegisterKeys(zAppKeyHandler_t handler)
+{
+    HAL_ASSERT(zAppTask_KeyCount < ZAPP_TASK_KEY_HANDLERS);
+    // only one task gets key events, the application must not take them
+    if (zAppTask_KeyCount == 0 && !RegisterForKeys(zAppTask_Id))
+    {
+        HAL_ASSERT(FALSE);
+    }
+    zAppTask_Keys[zAppTask_KeyCount++] = handler;
+}
+
+/**************************************************************************************************
+ * @fn      zAppTask_ProcessMsg
+ *
+ * @brief   Dispatch message to the registered handlers
+ *
+ * @param   msg - OSAL message
+ *
+ * @return  None
+ **************************************************************************************************/
+static void zAppTask_ProcessMsg(osal_event_hdr_t *msg)
+{
+    uint8 i;
+
+    if (msg->event == KEY_CHANGE)
+    {
+        for (i = 0; i < zAppTask_KeyCount; i++)
+        {
+            zAppTask_Keys[i](((keyChange_t *)msg)->state, ((keyChange_t *)msg)->keys);
+        }
+    }
+
+    for (i = 0; i < zAppTask_MsgCount; i++)
+    {
+        if (zAppTask_Msgs[i].event == msg->event)
+        {
+            zAppTask_Msgs[i].handler(msg);
+        }
+    }
+
+    if (msg->event == ZCL_INCOMING_MSG && ((zclIncomingMsg_t *)msg)->attrCmd)
+    {
+        osal_mem_free(((zclIncomingMsg_t *)msg)->attrCmd);
+    }
+}
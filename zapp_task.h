@@ -0,0 +1,40 @@
+#ifndef ZAPP_TASK_H
+#define ZAPP_TASK_H
+
+#include "hal_defs.h"
+#include "OSAL.h"
+
+/*
+ * Shared OSAL task of the library modules. Add zAppTask_event_loop to
+ * the application tasksArr and call zAppTask_Init from osalInitTasks
+ * before initializing any library module. Modules allocate their event
+ * bits and register message and key handlers here, so the library takes
+ * a single task slot and keys don't have to be forwarded by hand.
+ */
+
+#ifndef ZAPP_TASK_MSG_HANDLERS
+#define ZAPP_TASK_MSG_HANDLERS   4
+#endif /* ZAPP_TASK_MSG_HANDLERS */
+
+#ifndef ZAPP_TASK_KEY_HANDLERS
+#define ZAPP_TASK_KEY_HANDLERS   4
+#endif /* ZAPP_TASK_KEY_HANDLERS */
+
+// messages processed per task invocation, the rest waits for the next run
+#ifndef ZAPP_TASK_MSGS_PER_RUN
+#define ZAPP_TASK_MSGS_PER_RUN   4
+#endif /* ZAPP_TASK_MSGS_PER_RUN */
+
+typedef void (*zAppEventHandler_t)(void);
+typedef void (*zAppMsgHandler_t)(osal_event_hdr_t *msg);
+typedef void (*zAppKeyHandler_t)(uint8 portAndAction, uint8 keyCode);
+
+extern uint8 zAppTask_Id;
+
+extern void zAppTask_Init(uint8 task_id);
+extern uint16 zAppTask_event_loop(uint8 task_id, uint16 events);
+extern uint16 zAppTask_AllocEvent(zAppEventHandler_t handler);
+extern void zAppTask_RegisterMsg(uint8 event, zAppMsgHandler_t handler);
+extern void zAppTask_RegisterKeys(zAppKeyHandler_t handler);
+
+#endif /* ZAPP_TASK_H */
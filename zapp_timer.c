@@ -0,0 +1,191 @@
+#include "OSAL.h"
+#include "debug_print.h"
+#include "zapp_task.h"
+
+#include "zapp_timer.h"
+
+#define ZAPP_TIMER_FREE 0
+
+typedef struct
+{
+    uint16 event;   // ZAPP_TIMER_FREE for unused slot
+    uint8 task_id;
+    uint32 earliest;
+    uint32 latest;
+} zAppTimer_t;
+
+zAppTimerStats_t zAppTimer_Stats;
+
+static zAppTimer_t zAppTimer_Slots[ZAPP_TIMER_SLOTS];
+static uint16 zAppTimer_Event = 0;
+
+static zAppTimer_t *zAppTimer_Find(uint8 task_id, uint16 event);
+static void zAppTimer_Expired(void);
+static void zAppTimer_Schedule(void);
+
+/**************************************************************************************************
+ * @fn      zAppTimer_Start
+ *
+ * @brief   Set the event after timeout, allowing up to slack milliseconds
+ *          of delay to share a wakeup with other timers. Restarts the
+ *          timer if it is already running.
+ *
+ * @param   task_id - task to notify
+ * @param   event - event to set
+ * @param   timeout - milliseconds until the deadline
+ * @param   slack - acceptable delay past the deadline, milliseconds
+ *
+ * @return  None
+ **************************************************************************************************/
+void zAppTimer_Start(uint8 task_id, uint16 event, uint32 timeout, uint32 slack)
+{
+    zAppTimer_t *timer = zAppTimer_Find(task_id, event);
+    uint32 now = osal_GetSystemClock();
+
+    if (timer == NULL && slack != 0)
+    {
+        timer = zAppTimer_Find(0, ZAPP_TIMER_FREE);
+    }
+    if (timer == NULL || slack == 0)
+    {
+        if (timer != NULL)
+        {
+            timer->event = ZAPP_TIMER_FREE;
+            zAppTimer_Schedule();
+        }
+        osal_start_timerEx(task_id, event, timeout);
+        return;
+    }
+    if (zAppTimer_Event == 0)
+    {
+        zAppTimer_Event = zAppTask_AllocEvent(zAppTimer_Expired);
+    }
+    // drop a plain timer left from the fallback above
+    osal_stop_timerEx(task_id, event);
+
+    timer->task_id = task_id;
+    timer->event = event;
+    timer->earliest = now + timeout;
+    timer->latest = now + timeout + slack;
+    zAppTimer_Schedule();
+}
+
+/**************************************************************************************************
+ * @fn      zAppTimer_Stop
+ *
+ * @brief   Stop timer started with zAppTimer_Start
+ *
+ * @param   task_id - task of the timer
+ * @param   event - event of the timer
+ *
+ * @return  None
+ **************************************************************************************************/
+void zAppTimer_Stop(uint8 task_id, uint16 event)
+{
+    zAppTimer_t *timer = zAppTimer_Find(task_id, event);
+
+    osal_stop_timerEx(task_id, event);
+    if (timer != NULL)
+    {
+        timer->event = ZAPP_TIMER_FREE;
+        zAppTimer_Schedule();
+    }
+}
+
+/**************************************************************************************************
+ * @fn      zAppTimer_Find
+ *
+ * @brief   Find slot of the timer
+ *
+ * @param   task_id - task of the timer
+ * @param   event - event of the timer, ZAPP_TIMER_FREE to find a free slot
+ *
+ * @return  slot or NULL
+ **************************************************************************************************/
+static zAppTimer_t *zAppTimer_Find(uint8 task_id, uint16 event)
+{
+    for (uint8 i = 0; i < ZAPP_TIMER_SLOTS; i++)
+    {
+        zAppTimer_t *timer = &zAppTimer_Slots[i];
+
+        if (timer->event == event && (event == ZAPP_TIMER_FREE || timer->task_id == task_id))
+        {
+            return timer;
+        }
+    }
+    return NULL;
+}
+
+/**************************************************************************************************
+ * @fn      zAppTimer_Expired
+ *
+ * @brief   Fire every timer whose window has opened
+ *
+ * @param   None
+ *
+ * @return  None
+ **************************************************************************************************/
+static void zAppTimer_Expired(void)
+{
+    uint32 now = osal_GetSystemClock();
+    uint8 fired = 0;
+
+    for (uint8 i = 0; i < ZAPP_TIMER_SLOTS; i++)
+    {
+        zAppTimer_t *timer = &zAppTimer_Slots[i];
+
+        if (timer->event != ZAPP_TIMER_FREE && (int32)(now - timer->earliest) >= 0)
+        {
+            osal_set_event(timer->task_id, timer->event);
+            timer->event = ZAPP_TIMER_FREE;
+            fired++;
+        }
+    }
+    if (fired)
+    {
+        zAppTimer_Stats.wakeups++;
+        zAppTimer_Stats.expirations += fired;
+        DBG_TRACE(DEBUG_MODULE_TIMER, "zAppTimer: fired %d\r\n", fired);
+    }
+    zAppTimer_Schedule();
+}
+
+/**************************************************************************************************
+ * @fn      zAppTimer_Schedule
+ *
+ * @brief   Arm the wakeup at the latest moment the most urgent timer allows
+ *
+ * @param   None
+ *
+ * @return  None
+ **************************************************************************************************/
+static void zAppTimer_Schedule(void)
+{
+    uint32 now = osal_GetSystemClock();
+    bool pending = FALSE;
+    int32 wait = 0;
+
+    for (uint8 i = 0; i < ZAPP_TIMER_SLOTS; i++)
+    {
+        zAppTimer_t *timer = &zAppTimer_Slots[i];
+
+        if (timer->event != ZAPP_TIMER_FREE && (!pending || (int32)(timer->latest - now) < wait))
+        {
+            wait = (int32)(timer->latest - now);
+            pending = TRUE;
+        }
+    }
+    if (!pending)
+    {
+        osal_stop_timerEx(zAppTask_Id, zAppTimer_Event);
+    }
+    else if (wait <= 0)
+    {
+        osal_stop_timerEx(zAppTask_Id, zAppTimer_Event);
+        osal_set_event(zAppTask_Id, zAppTimer_Event);
+    }
+    else
+    {
+        osal_start_timerEx(zAppTask_Id, zAppTimer_Event, (uint32)wait);
+    }
+}
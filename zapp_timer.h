@@ -0,0 +1,31 @@
+#ifndef ZAPP_TIMER_H
+#define ZAPP_TIMER_H
+
+#include "hal_defs.h"
+
+/*
+ * Coalescing timers on top of osal_start_timerEx. Each timer fires at
+ * its deadline or up to slack milliseconds later, all timers whose
+ * windows overlap are fired from a single wakeup of the library task.
+ * Any task event can be used, e.g. the battery report timer:
+ *   zAppTimer_Start(task_id, APP_REPORT_EVT, zclBatteryInterval(), zclBatteryInterval() / 8);
+ * With zero slack or when all slots are taken it is a plain
+ * osal_start_timerEx call.
+ */
+
+#ifndef ZAPP_TIMER_SLOTS
+#define ZAPP_TIMER_SLOTS   6
+#endif /* ZAPP_TIMER_SLOTS */
+
+typedef struct
+{
+    uint16 wakeups;     // library task wakeups firing timers
+    uint16 expirations; // timers fired, wakeups saved = expirations - wakeups
+} zAppTimerStats_t;
+
+extern zAppTimerStats_t zAppTimer_Stats;
+
+extern void zAppTimer_Start(uint8 task_id, uint16 event, uint32 timeout, uint32 slack);
+extern void zAppTimer_Stop(uint8 task_id, uint16 event);
+
+#endif /* ZAPP_TIMER_H */